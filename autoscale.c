@@ -0,0 +1,299 @@
+#include "autoscale.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "plugins/stage_load.h"
+
+#define AUTOSCALE_MAX_STAGES 64
+#define HOT_PRESSURE   0.5  // queue at least half full, or producers blocked half the time
+#define COLD_PRESSURE  0.1
+#define HOT_BUSY       0.5  // and its threads are mostly serving, not waiting themselves
+#define COLD_BUSY      0.5  // replicas below this share of busy time are surplus
+#define COLD_TICKS     3    // quiet samples in a row before a replica is retired
+
+// What the controller remembers about a stage between two samples
+typedef struct {
+    void*        handle;     // stage identity (dlopen handle), NULL = free slot
+    stage_load_t last;       // previous sample
+    uint64_t     last_ns;    // when it was taken
+    int          cold_ticks; // consecutive quiet samples
+    int          present;    // still in the chain at this sample
+} stage_track_t;
+
+// One stage's load over the last interval
+typedef struct {
+    int    valid;     // sampled twice, and scalable
+    double occupancy; // queued / capacity
+    double blocked;   // share of the interval producers waited for space
+    double busy;      // share of the interval each consumer thread was serving
+    double pressure;  // max(occupancy, blocked)
+    int    threads;
+    int    max_threads;
+} stage_view_t;
+
+static struct {
+    pthread_t          tid;
+    int                started;
+    int                stop;
+    pthread_mutex_t    lock;
+    pthread_cond_t     cond;
+    pipeline_t*        pl;
+    autoscale_config_t cfg;
+    int                capped; // budget used up, reported once until it frees up
+    stage_track_t      track[AUTOSCALE_MAX_STAGES];
+} g_as = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+// Small strdup to avoid non-portable prototypes
+static char* dup_cstr(const char* s) {
+    if (!s) return NULL;
+    size_t n = strlen(s);
+    char* p = (char*)malloc(n + 1);
+    if (!p) return NULL;
+    memcpy(p, s, n + 1);
+    return p;
+}
+
+static char* fmt_error(const char* what, const char* value) {
+    size_t need = strlen(what) + strlen(value) + 4;
+    char* p = (char*)malloc(need);
+    if (p) snprintf(p, need, "%s '%s'", what, value);
+    return p;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int parse_uint(const char* s, unsigned long lo, unsigned long hi, unsigned* out) {
+    if (!s || !*s || *s == '-') return -1;
+    errno = 0;
+    char* endp = NULL;
+    unsigned long v = strtoul(s, &endp, 10);
+    if (endp == s || *endp != '\0' || errno == ERANGE || v < lo || v > hi) return -1;
+    *out = (unsigned)v;
+    return 0;
+}
+
+int autoscale_parse(const char* spec, autoscale_config_t* cfg, char** failed_msg) {
+    *failed_msg = NULL;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    // one core is taken by the stages' own threads already
+    *cfg = (autoscale_config_t){ .cores = cpus > 1 ? (unsigned)cpus - 1 : 0, .interval_ms = 200 };
+
+    char* buf = dup_cstr(spec ? spec : "");
+    if (!buf) { *failed_msg = dup_cstr("alloc failed"); return -1; }
+
+    int rc = 0;
+    char* save = NULL;
+    for (char* item = strtok_r(buf, ",", &save); item && rc == 0; item = strtok_r(NULL, ",", &save)) {
+        char* eq = strchr(item, '=');
+        if (!eq) { *failed_msg = fmt_error("malformed autoscale option", item); rc = -1; break; }
+        *eq = '\0';
+        const char* key = item;
+        const char* val = eq + 1;
+
+        if (strcmp(key, "cores") == 0) {
+            rc = parse_uint(val, 0, 1024, &cfg->cores);
+        } else if (strcmp(key, "interval") == 0) {
+            rc = parse_uint(val, 10, 60000, &cfg->interval_ms);
+        } else {
+            *failed_msg = fmt_error("unknown autoscale option", key);
+            rc = -1;
+            break;
+        }
+        if (rc != 0) *failed_msg = fmt_error("invalid value for autoscale option", key);
+    }
+    free(buf);
+    return rc;
+}
+
+static stage_track_t* track_for(void* handle) {
+    stage_track_t* free_slot = NULL;
+    for (int i = 0; i < AUTOSCALE_MAX_STAGES; ++i) {
+        if (g_as.track[i].handle == handle) return &g_as.track[i];
+        if (!g_as.track[i].handle && !free_slot) free_slot = &g_as.track[i];
+    }
+    if (free_slot) *free_slot = (stage_track_t){ .handle = handle };
+    return free_slot;
+}
+
+static double clamp01(double v) {
+    return v < 0.0 ? 0.0 : (v > 1.0 ? 1.0 : v);
+}
+
+// Sample one stage; v->valid once there is an earlier sample to compare with
+static void sample_stage(const plugin_handle_t* h, stage_view_t* v) {
+    *v = (stage_view_t){0};
+    stage_load_t now;
+    if (!h->sample_load || !h->set_threads || h->sample_load(&now) != NULL) return;
+    stage_track_t* t = track_for(h->handle);
+    if (!t) return;
+
+    uint64_t at = now_ns();
+    int first = (t->last_ns == 0);
+    stage_load_t prev = t->last;
+    uint64_t dt = at - t->last_ns;
+    t->last = now;
+    t->last_ns = at;
+    t->present = 1;
+    v->threads = now.threads;
+    v->max_threads = now.max_threads;
+    if (first || dt == 0 || now.threads < 1) return;
+
+    int cap = now.capacity > 0 ? now.capacity : 64; // byte-bounded queue: count 64 items as full
+    v->occupancy = clamp01((double)now.queued / (double)cap);
+    v->blocked   = clamp01((double)(now.blocked_ns - prev.blocked_ns) / (double)dt);
+    v->busy      = clamp01((double)(now.busy_ns - prev.busy_ns) / ((double)dt * now.threads));
+    v->pressure  = v->occupancy > v->blocked ? v->occupancy : v->blocked;
+    v->valid     = 1;
+}
+
+static void log_change(const char* name, int from, int to, const stage_view_t* v, const char* why) {
+    fprintf(stderr, "autoscale: %s %d -> %d threads (%s: queue %.0f%%, blocked %.0f%%, busy %.0f%%)\n",
+            name ? name : "(unknown)", from, to, why, 100.0 * v->occupancy, 100.0 * v->blocked,
+            100.0 * v->busy);
+}
+
+static int resize(plugin_handle_t* h, stage_view_t* v, int to, const char* why) {
+    if (h->set_threads(to) != NULL) return -1; // e.g. the stage has just finished
+    log_change(h->name, v->threads, to, v, why);
+    v->threads = to;
+    return 0;
+}
+
+// One controller step (caller holds pl->ctl_lock, so the chain cannot change)
+static void tick(pipeline_t* pl) {
+    size_t n = pl->count < AUTOSCALE_MAX_STAGES ? pl->count : AUTOSCALE_MAX_STAGES;
+    stage_view_t views[AUTOSCALE_MAX_STAGES];
+    unsigned extra = 0;
+
+    for (int i = 0; i < AUTOSCALE_MAX_STAGES; ++i) g_as.track[i].present = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sample_stage(&pl->plugs[i], &views[i]);
+        if (views[i].threads > 1) extra += (unsigned)(views[i].threads - 1);
+    }
+    for (int i = 0; i < AUTOSCALE_MAX_STAGES; ++i) { // stages removed or swapped out
+        if (!g_as.track[i].present) g_as.track[i].handle = NULL;
+    }
+
+    // retire replicas that stayed idle for a while
+    for (size_t i = 0; i < n; ++i) {
+        stage_view_t* v = &views[i];
+        stage_track_t* t = v->valid ? track_for(pl->plugs[i].handle) : NULL;
+        if (!t) continue;
+        int cold = v->threads > 1 && v->pressure < COLD_PRESSURE && v->busy < COLD_BUSY;
+        t->cold_ticks = cold ? t->cold_ticks + 1 : 0;
+        if (t->cold_ticks >= COLD_TICKS && resize(&pl->plugs[i], v, v->threads - 1, "idle") == 0) {
+            t->cold_ticks = 0;
+            extra--;
+        }
+    }
+
+    // the most downstream saturated stage that can take another thread. One
+    // whose output queue (the next stage's input) is full is held up by its
+    // successor: another thread there would only wait as well.
+    size_t hot = (size_t)-1;
+    for (size_t i = n; i-- > 0;) {
+        const stage_view_t* v = &views[i];
+        if (!v->valid || v->threads >= v->max_threads || v->pressure < HOT_PRESSURE || v->busy < HOT_BUSY) {
+            continue;
+        }
+        if (i + 1 < n && views[i + 1].occupancy >= 1.0) continue;
+        hot = i;
+        break;
+    }
+    if (hot == (size_t)-1) return;
+
+    if (extra < g_as.cfg.cores) {
+        if (resize(&pl->plugs[hot], &views[hot], views[hot].threads + 1, "bottleneck") == 0) g_as.capped = 0;
+        return;
+    }
+
+    // budget used up: move a thread over from the least loaded replicated stage
+    size_t donor = (size_t)-1;
+    for (size_t i = 0; i < n; ++i) {
+        const stage_view_t* v = &views[i];
+        if (i == hot || !v->valid || v->threads < 2 || v->pressure >= HOT_PRESSURE / 2 || v->busy >= COLD_BUSY) {
+            continue;
+        }
+        if (donor == (size_t)-1 || v->pressure < views[donor].pressure) donor = i;
+    }
+    if (donor != (size_t)-1 && resize(&pl->plugs[donor], &views[donor], views[donor].threads - 1, "reassigned") == 0) {
+        (void)resize(&pl->plugs[hot], &views[hot], views[hot].threads + 1, "bottleneck");
+    } else if (!g_as.capped) {
+        fprintf(stderr, "autoscale: %s is the bottleneck but all %u extra threads are in use\n",
+                pl->plugs[hot].name ? pl->plugs[hot].name : "(unknown)", g_as.cfg.cores);
+        g_as.capped = 1;
+    }
+}
+
+static void* autoscale_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&g_as.lock);
+    while (!g_as.stop) {
+        struct timespec until;
+        clock_gettime(CLOCK_MONOTONIC, &until);
+        uint64_t ns = (uint64_t)until.tv_nsec + (uint64_t)g_as.cfg.interval_ms * 1000000ull;
+        until.tv_sec += (time_t)(ns / 1000000000ull);
+        until.tv_nsec = (long)(ns % 1000000000ull);
+        while (!g_as.stop && pthread_cond_timedwait(&g_as.cond, &g_as.lock, &until) != ETIMEDOUT) { }
+        if (g_as.stop) break;
+        pthread_mutex_unlock(&g_as.lock);
+
+        pthread_mutex_lock(&g_as.pl->ctl_lock);
+        tick(g_as.pl);
+        pthread_mutex_unlock(&g_as.pl->ctl_lock);
+
+        pthread_mutex_lock(&g_as.lock);
+    }
+    pthread_mutex_unlock(&g_as.lock);
+    return NULL;
+}
+
+int autoscale_start(pipeline_t* pl, const autoscale_config_t* cfg, char** failed_msg) {
+    *failed_msg = NULL;
+    if (g_as.started) {
+        *failed_msg = dup_cstr("autoscale already started");
+        return -1;
+    }
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int rc = pthread_cond_init(&g_as.cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (rc != 0) {
+        *failed_msg = dup_cstr("cond init failed");
+        return -1;
+    }
+
+    g_as.pl = pl;
+    g_as.cfg = *cfg;
+    g_as.stop = 0;
+    g_as.capped = 0;
+    memset(g_as.track, 0, sizeof(g_as.track));
+    if (pthread_create(&g_as.tid, NULL, autoscale_thread, NULL) != 0) {
+        pthread_cond_destroy(&g_as.cond);
+        *failed_msg = dup_cstr("pthread_create failed");
+        return -1;
+    }
+    g_as.started = 1;
+    return 0;
+}
+
+void autoscale_stop(void) {
+    if (!g_as.started) return;
+    pthread_mutex_lock(&g_as.lock);
+    g_as.stop = 1;
+    pthread_cond_signal(&g_as.cond);
+    pthread_mutex_unlock(&g_as.lock);
+    (void)pthread_join(g_as.tid, NULL);
+    pthread_cond_destroy(&g_as.cond);
+    g_as.started = 0;
+}
@@ -0,0 +1,34 @@
+#ifndef AUTOSCALE_H
+#define AUTOSCALE_H
+
+#include "plugin_runtime.h"
+
+// Elastic replicas for the bottleneck stage (--autoscale[=...]). A background
+// thread samples every stage's load each interval: queue occupancy, the share
+// of time producers were blocked on the full queue, and how busy its consumer
+// threads were. The most downstream saturated stage whose output queue is not
+// full gets one more consumer thread while the budget lasts; when it is used up, a thread is moved over
+// from an idle replicated stage instead. Replicas of a stage that stays idle
+// are retired again. Only stages that export plugin_set_threads and declare a
+// reentrant transform are scaled; their results keep queue order. Every
+// decision is logged to stderr.
+typedef struct {
+    unsigned cores;       // replica threads added in total, at most (default: online CPUs - 1)
+    unsigned interval_ms; // sampling period
+} autoscale_config_t;
+
+// Parse "key=value,..." (cores, interval); an empty spec gives the defaults
+// On success: return 0
+// On failure: return -1 and set *failed_msg to a heap-allocated error string (caller frees)
+int autoscale_parse(const char* spec, autoscale_config_t* cfg, char** failed_msg);
+
+// Start the controller thread for pl
+// On success: return 0
+// On failure: return -1 and set *failed_msg to a heap-allocated error string (caller frees)
+int autoscale_start(pipeline_t* pl, const autoscale_config_t* cfg, char** failed_msg);
+
+// Stop the controller and wait for it (no-op if it was not started). Call
+// before the stages are finalized.
+void autoscale_stop(void);
+
+#endif // AUTOSCALE_H
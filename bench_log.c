@@ -0,0 +1,95 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_ring.h"
+
+// Microbenchmark for the plugins' log path (log_ring), driven directly: the
+// cost of one log_ring_write for a message that repeats the previous one
+// (collapsed) and for distinct messages (rate limited past the burst).
+// Results go to stdout as one JSON object; the log lines themselves go to
+// stderr as they would from a plugin, ending with the collapsed and
+// suppressed counts. --hold keeps the process alive with counts pending.
+
+#define BENCH_NAME "bench_log"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static double per_call_duplicate(unsigned long long n) {
+    uint64_t t0 = now_ns();
+    for (unsigned long long i = 0; i < n; ++i) log_ring_write("INFO", BENCH_NAME, "duplicate");
+    return (double)(now_ns() - t0) / (double)n;
+}
+
+static double per_call_distinct(unsigned long long n) {
+    char msg[64];
+    uint64_t t0 = now_ns();
+    for (unsigned long long i = 0; i < n; ++i) {
+        snprintf(msg, sizeof(msg), "distinct %llu", i);
+        log_ring_write("INFO", BENCH_NAME, msg);
+    }
+    return (double)(now_ns() - t0) / (double)n;
+}
+
+static void print_usage(FILE* out) {
+    fprintf(out, "Usage: bench_log [options]\n");
+    fprintf(out, "  --messages=N  Calls per run (default 100000)\n");
+    fprintf(out, "  --hold=MS     Sleep this long before shutdown, with the suppressed count\n");
+    fprintf(out, "                still pending (default 0)\n");
+    fprintf(out, "Prints one JSON object to stdout, the log lines to stderr.\n");
+}
+
+static int parse_ull(const char* s, unsigned long long* out) {
+    if (!s || !*s || *s == '-') return -1;
+    errno = 0;
+    char* endp = NULL;
+    unsigned long long v = strtoull(s, &endp, 10);
+    if (endp == s || *endp != '\0' || errno == ERANGE) return -1;
+    *out = v;
+    return 0;
+}
+
+static int bad_value(const char* arg) {
+    fprintf(stderr, "error: invalid value in '%s'\n", arg);
+    print_usage(stderr);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    unsigned long long messages = 100000, hold_ms = 0;
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (strncmp(opt, "--messages=", 11) == 0) {
+            if (parse_ull(opt + 11, &messages) || messages == 0) return bad_value(opt);
+        } else if (strncmp(opt, "--hold=", 7) == 0) {
+            if (parse_ull(opt + 7, &hold_ms) || hold_ms > 60000) return bad_value(opt);
+        } else if (strcmp(opt, "--help") == 0) {
+            print_usage(stdout);
+            return 0;
+        } else {
+            fprintf(stderr, "error: unknown option '%s'\n", opt);
+            print_usage(stderr);
+            return 1;
+        }
+    }
+
+    double duplicate = per_call_duplicate(messages);
+    double distinct = per_call_distinct(messages);
+    if (hold_ms) {
+        struct timespec ts = {(time_t)(hold_ms / 1000), (long)(hold_ms % 1000) * 1000000L};
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR) { }
+    }
+    log_ring_shutdown();
+
+    printf("{\n  \"bench\": \"log\",\n  \"messages\": %llu,\n", messages);
+    printf("  \"duplicate_ns_per_call\": %.1f,\n", duplicate);
+    printf("  \"distinct_ns_per_call\": %.1f\n}\n", distinct);
+    return 0;
+}
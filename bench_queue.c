@@ -0,0 +1,473 @@
+#define _GNU_SOURCE // pthread_setaffinity_np
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "consumer_producer.h"
+#include "monitor.h"
+
+// Microbenchmarks for the queue and monitor primitives, driven directly
+// (no plugins, no analyzer). Results go to stdout as one JSON object:
+// - pingpong: one item bounced between two threads through two queues of
+//   capacity 1, and the same handshake on two bare monitors; per hop times
+// - throughput: one producer, one consumer, for each queue capacity
+// - oscillation: every cycle fills the queue to capacity and drains it, so
+//   the producer blocks on full and the consumer on empty each time
+// - signal_finished: consumers blocked in get on an empty queue, the cost of
+//   the call and the time until every one of them has returned
+
+#define MAX_LIST 16
+
+typedef struct
+{
+    unsigned long long items;        // throughput: items per capacity
+    unsigned long long rounds;       // pingpong round trips, finish repetitions x 10
+    int capacities[MAX_LIST];
+    int ncap;
+    int waiters[MAX_LIST];
+    int nwait;
+    int osc_capacity;
+    int cpus[MAX_LIST];              // --pin: thread i runs on cpus[i % ncpu]
+    int ncpu;
+    unsigned only;                   // BENCH_* bits to run
+} bench_config_t;
+
+enum { BENCH_PINGPONG = 1, BENCH_THROUGHPUT = 2, BENCH_OSCILLATION = 4, BENCH_FINISH = 8 };
+
+static bench_config_t g_cfg;
+
+// Every item is this one string: the queue never frees an item it hands
+// out, so nothing is allocated per item and only the queue is measured
+static char g_item[] = "x";
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void pin_self(int slot) {
+    if (g_cfg.ncpu == 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(g_cfg.cpus[slot % g_cfg.ncpu], &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        fprintf(stderr, "error: cannot pin to cpu %d: %s\n", g_cfg.cpus[slot % g_cfg.ncpu], strerror(rc));
+        exit(1);
+    }
+}
+
+static consumer_producer_t* new_queue(int capacity) {
+    consumer_producer_t* q = (consumer_producer_t*)calloc(1, sizeof(*q));
+    const char* err = q ? consumer_producer_init(q, capacity) : "alloc failed";
+    if (err) {
+        fprintf(stderr, "error: queue: %s\n", err);
+        exit(1);
+    }
+    return q;
+}
+
+static void free_queue(consumer_producer_t* q) {
+    consumer_producer_destroy(q);
+    free(q);
+}
+
+static void put(consumer_producer_t* q) {
+    const char* err = consumer_producer_put(q, g_item);
+    if (err) {
+        fprintf(stderr, "error: put: %s\n", err);
+        exit(1);
+    }
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts v
+static uint64_t percentile(uint64_t* v, size_t n, double p) {
+    if (n == 0) return 0;
+    qsort(v, n, sizeof(*v), cmp_u64);
+    size_t k = (size_t)(p * (double)(n - 1) + 0.5);
+    return v[k];
+}
+
+// ---------------------------------------------------------------- pingpong
+
+typedef struct
+{
+    consumer_producer_t* q[2];
+    monitor_t m[2];
+    int use_monitor;
+    unsigned long long rounds;
+} pingpong_t;
+
+static void* pong_main(void* arg) {
+    pingpong_t* pp = (pingpong_t*)arg;
+    pin_self(1);
+    for (unsigned long long r = 0; r < pp->rounds; ++r) {
+        if (pp->use_monitor) {
+            monitor_wait(&pp->m[0]);
+            monitor_reset(&pp->m[0]);
+            monitor_signal(&pp->m[1]);
+        } else {
+            (void)consumer_producer_get(pp->q[0]);
+            put(pp->q[1]);
+        }
+    }
+    return NULL;
+}
+
+static void print_pingpong(const char* name, int use_monitor, int last) {
+    pingpong_t pp;
+    memset(&pp, 0, sizeof(pp));
+    pp.use_monitor = use_monitor;
+    pp.rounds = g_cfg.rounds;
+    if (use_monitor) {
+        if (monitor_init(&pp.m[0]) || monitor_init(&pp.m[1])) {
+            fprintf(stderr, "error: monitor_init failed\n");
+            exit(1);
+        }
+    } else {
+        pp.q[0] = new_queue(1);
+        pp.q[1] = new_queue(1);
+    }
+    uint64_t* rtt = (uint64_t*)malloc(pp.rounds * sizeof(uint64_t));
+    if (!rtt) exit(1);
+
+    pthread_t t;
+    pthread_create(&t, NULL, pong_main, &pp);
+    uint64_t t0 = now_ns();
+    for (unsigned long long r = 0; r < pp.rounds; ++r) {
+        uint64_t s = now_ns();
+        if (use_monitor) {
+            monitor_signal(&pp.m[0]);
+            monitor_wait(&pp.m[1]);
+            monitor_reset(&pp.m[1]);
+        } else {
+            put(pp.q[0]);
+            (void)consumer_producer_get(pp.q[1]);
+        }
+        rtt[r] = now_ns() - s;
+    }
+    uint64_t total = now_ns() - t0;
+    pthread_join(t, NULL);
+
+    // a round trip is two hops
+    printf("    \"%s\": {\"round_trips\": %llu, \"hop_ns_mean\": %.1f, \"hop_ns_p50\": %.1f, \"hop_ns_p99\": %.1f}%s\n",
+           name, pp.rounds, (double)total / (2.0 * (double)pp.rounds),
+           percentile(rtt, pp.rounds, 0.50) / 2.0, percentile(rtt, pp.rounds, 0.99) / 2.0, last ? "" : ",");
+    free(rtt);
+    if (use_monitor) {
+        monitor_destroy(&pp.m[0]);
+        monitor_destroy(&pp.m[1]);
+    } else {
+        free_queue(pp.q[0]);
+        free_queue(pp.q[1]);
+    }
+}
+
+// ---------------------------------------------------------------- throughput
+
+typedef struct
+{
+    consumer_producer_t* q;
+    unsigned long long items;
+} flow_t;
+
+static void* drain_main(void* arg) {
+    flow_t* f = (flow_t*)arg;
+    pin_self(1);
+    for (unsigned long long i = 0; i < f->items; ++i) (void)consumer_producer_get(f->q);
+    return NULL;
+}
+
+static void print_throughput(int capacity, int last) {
+    flow_t f = {new_queue(capacity), g_cfg.items};
+    pthread_t t;
+    pthread_create(&t, NULL, drain_main, &f);
+    uint64_t t0 = now_ns();
+    for (unsigned long long i = 0; i < f.items; ++i) put(f.q);
+    pthread_join(t, NULL);
+    double secs = (double)(now_ns() - t0) / 1e9;
+    cp_stats_t st;
+    consumer_producer_get_stats(f.q, &st);
+    printf("    {\"capacity\": %d, \"items\": %llu, \"seconds\": %.6f, \"items_per_sec\": %.0f, "
+           "\"producer_blocked_ns\": %llu}%s\n",
+           capacity, f.items, secs, (double)f.items / secs, (unsigned long long)st.blocked_ns, last ? "" : ",");
+    free_queue(f.q);
+}
+
+// ---------------------------------------------------------------- oscillation
+
+// Per cycle the producer waits for the queue to be drained, puts capacity + 1
+// items (the queue is full), tells the consumer, and puts one more, which
+// blocks on full. The consumer takes one item, blocking on the empty queue
+// until the cycle starts, waits until the queue is full, then drains it.
+typedef struct
+{
+    consumer_producer_t* q;
+    monitor_t full, drained;
+    int capacity;
+    unsigned long long cycles;
+} osc_t;
+
+static void* osc_consumer(void* arg) {
+    osc_t* o = (osc_t*)arg;
+    pin_self(1);
+    for (unsigned long long c = 0; c < o->cycles; ++c) {
+        (void)consumer_producer_get(o->q);
+        monitor_wait(&o->full);
+        monitor_reset(&o->full);
+        for (int i = 0; i <= o->capacity; ++i) (void)consumer_producer_get(o->q);
+        monitor_signal(&o->drained);
+    }
+    return NULL;
+}
+
+static void print_oscillation(void) {
+    osc_t o;
+    memset(&o, 0, sizeof(o));
+    o.capacity = g_cfg.osc_capacity;
+    o.q = new_queue(o.capacity);
+    o.cycles = g_cfg.items / (unsigned long long)(o.capacity + 2);
+    if (o.cycles == 0) o.cycles = 1;
+    if (monitor_init(&o.full) || monitor_init(&o.drained)) {
+        fprintf(stderr, "error: monitor_init failed\n");
+        exit(1);
+    }
+    monitor_signal(&o.drained);
+
+    pthread_t t;
+    pthread_create(&t, NULL, osc_consumer, &o);
+    uint64_t t0 = now_ns();
+    for (unsigned long long c = 0; c < o.cycles; ++c) {
+        monitor_wait(&o.drained);
+        monitor_reset(&o.drained);
+        for (int i = 0; i <= o.capacity; ++i) put(o.q);
+        monitor_signal(&o.full);
+        put(o.q);
+    }
+    pthread_join(t, NULL);
+    double secs = (double)(now_ns() - t0) / 1e9;
+    cp_stats_t st;
+    consumer_producer_get_stats(o.q, &st);
+    unsigned long long items = o.cycles * (unsigned long long)(o.capacity + 2);
+    printf("  \"oscillation\": {\"capacity\": %d, \"cycles\": %llu, \"items\": %llu, \"seconds\": %.6f, "
+           "\"items_per_sec\": %.0f, \"cycles_per_sec\": %.0f, \"producer_blocked_ns\": %llu}",
+           o.capacity, o.cycles, items, secs, (double)items / secs, (double)o.cycles / secs,
+           (unsigned long long)st.blocked_ns);
+    monitor_destroy(&o.full);
+    monitor_destroy(&o.drained);
+    free_queue(o.q);
+}
+
+// ---------------------------------------------------------------- signal_finished
+
+typedef struct
+{
+    consumer_producer_t* q;
+    int slot;
+    pthread_barrier_t* started;
+    uint64_t returned_ns;
+} waiter_t;
+
+static void* waiter_main(void* arg) {
+    waiter_t* w = (waiter_t*)arg;
+    pin_self(w->slot);
+    pthread_barrier_wait(w->started);
+    (void)consumer_producer_get(w->q); // blocks: the queue stays empty
+    w->returned_ns = now_ns();
+    return NULL;
+}
+
+static void print_finish(int nwaiters, int last) {
+    unsigned long long reps = g_cfg.rounds / 10 ? g_cfg.rounds / 10 : 1;
+    if (reps > 200) reps = 200;
+    uint64_t* call = (uint64_t*)malloc(reps * sizeof(uint64_t));
+    uint64_t* wake = (uint64_t*)malloc(reps * sizeof(uint64_t));
+    pthread_t* t = (pthread_t*)malloc((size_t)nwaiters * sizeof(pthread_t));
+    waiter_t* w = (waiter_t*)malloc((size_t)nwaiters * sizeof(waiter_t));
+    if (!call || !wake || !t || !w) exit(1);
+
+    for (unsigned long long r = 0; r < reps; ++r) {
+        consumer_producer_t* q = new_queue(1);
+        pthread_barrier_t started;
+        pthread_barrier_init(&started, NULL, (unsigned)nwaiters + 1);
+        for (int i = 0; i < nwaiters; ++i) {
+            w[i] = (waiter_t){q, i + 1, &started, 0};
+            pthread_create(&t[i], NULL, waiter_main, &w[i]);
+        }
+        pthread_barrier_wait(&started);
+        usleep(2000); // let every waiter reach its wait in get
+
+        uint64_t t0 = now_ns();
+        consumer_producer_signal_finished(q);
+        call[r] = now_ns() - t0;
+        uint64_t end = t0;
+        for (int i = 0; i < nwaiters; ++i) {
+            pthread_join(t[i], NULL);
+            if (w[i].returned_ns > end) end = w[i].returned_ns;
+        }
+        wake[r] = end - t0;
+        pthread_barrier_destroy(&started);
+        free_queue(q);
+    }
+    printf("    {\"waiters\": %d, \"reps\": %llu, \"call_ns_p50\": %llu, \"call_ns_p99\": %llu, "
+           "\"wake_all_ns_p50\": %llu, \"wake_all_ns_p99\": %llu}%s\n",
+           nwaiters, reps, (unsigned long long)percentile(call, reps, 0.50),
+           (unsigned long long)percentile(call, reps, 0.99), (unsigned long long)percentile(wake, reps, 0.50),
+           (unsigned long long)percentile(wake, reps, 0.99), last ? "" : ",");
+    free(call);
+    free(wake);
+    free(t);
+    free(w);
+}
+
+// ---------------------------------------------------------------- options
+
+static void print_usage(FILE* out) {
+    fprintf(out, "Usage: bench_queue [options]\n");
+    fprintf(out, "  --items=N          Items per throughput run and for the oscillation run (default 200000)\n");
+    fprintf(out, "  --rounds=N         Ping-pong round trips (default 20000); signal_finished runs N/10, at most 200\n");
+    fprintf(out, "  --capacities=LIST  Queue capacities for the throughput runs (default 1,2,64,4096)\n");
+    fprintf(out, "  --oscillate=N      Queue capacity for the oscillation run (default 16)\n");
+    fprintf(out, "  --waiters=LIST     Blocked consumers for the signal_finished runs (default 1,4,16)\n");
+    fprintf(out, "  --pin=LIST         Pin threads to CPUs: the driving thread to the first, the\n");
+    fprintf(out, "                     other side to the second (or the same one), waiters round robin\n");
+    fprintf(out, "  --only=LIST        Run some of pingpong, throughput, oscillation, finish\n");
+    fprintf(out, "Prints one JSON object to stdout.\n");
+}
+
+static int parse_ull(const char* s, unsigned long long* out) {
+    if (!s || !*s || *s == '-') return -1;
+    errno = 0;
+    char* endp = NULL;
+    unsigned long long v = strtoull(s, &endp, 10);
+    if (endp == s || *endp != '\0' || errno == ERANGE) return -1;
+    *out = v;
+    return 0;
+}
+
+// Comma separated integers in [lo, hi]
+static int parse_list(const char* s, int* out, int* n, int lo, int hi) {
+    *n = 0;
+    while (*s) {
+        char* endp = NULL;
+        errno = 0;
+        long v = strtol(s, &endp, 10);
+        if (endp == s || errno == ERANGE || v < lo || v > hi || *n == MAX_LIST) return -1;
+        out[(*n)++] = (int)v;
+        if (*endp == ',' && endp[1]) s = endp + 1;
+        else if (*endp == '\0') s = endp;
+        else return -1;
+    }
+    return *n ? 0 : -1;
+}
+
+static int parse_only(const char* s, unsigned* out) {
+    static const char* names[] = {"pingpong", "throughput", "oscillation", "finish"};
+    *out = 0;
+    while (*s) {
+        size_t n = strcspn(s, ",");
+        int hit = 0;
+        for (int i = 0; i < 4; ++i) {
+            if (strlen(names[i]) == n && strncmp(s, names[i], n) == 0) {
+                *out |= 1u << i;
+                hit = 1;
+            }
+        }
+        if (!hit) return -1;
+        s += n;
+        if (*s) s++;
+    }
+    return *out ? 0 : -1;
+}
+
+static int bad_value(const char* arg) {
+    fprintf(stderr, "error: invalid value in '%s'\n", arg);
+    print_usage(stderr);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    g_cfg.items = 200000;
+    g_cfg.rounds = 20000;
+    g_cfg.ncap = 4;
+    memcpy(g_cfg.capacities, (int[]){1, 2, 64, 4096}, 4 * sizeof(int));
+    g_cfg.nwait = 3;
+    memcpy(g_cfg.waiters, (int[]){1, 4, 16}, 3 * sizeof(int));
+    g_cfg.osc_capacity = 16;
+    g_cfg.only = BENCH_PINGPONG | BENCH_THROUGHPUT | BENCH_OSCILLATION | BENCH_FINISH;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (strncmp(opt, "--items=", 8) == 0) {
+            if (parse_ull(opt + 8, &g_cfg.items) || g_cfg.items == 0) return bad_value(opt);
+        } else if (strncmp(opt, "--rounds=", 9) == 0) {
+            if (parse_ull(opt + 9, &g_cfg.rounds) || g_cfg.rounds == 0) return bad_value(opt);
+        } else if (strncmp(opt, "--capacities=", 13) == 0) {
+            if (parse_list(opt + 13, g_cfg.capacities, &g_cfg.ncap, 1, 1 << 20)) return bad_value(opt);
+        } else if (strncmp(opt, "--oscillate=", 12) == 0) {
+            int n = 0;
+            if (parse_list(opt + 12, &g_cfg.osc_capacity, &n, 1, 1 << 20) || n != 1) return bad_value(opt);
+        } else if (strncmp(opt, "--waiters=", 10) == 0) {
+            if (parse_list(opt + 10, g_cfg.waiters, &g_cfg.nwait, 1, 1024)) return bad_value(opt);
+        } else if (strncmp(opt, "--pin=", 6) == 0) {
+            if (parse_list(opt + 6, g_cfg.cpus, &g_cfg.ncpu, 0, CPU_SETSIZE - 1)) return bad_value(opt);
+        } else if (strncmp(opt, "--only=", 7) == 0) {
+            if (parse_only(opt + 7, &g_cfg.only)) return bad_value(opt);
+        } else if (strcmp(opt, "--help") == 0) {
+            print_usage(stdout);
+            return 0;
+        } else {
+            fprintf(stderr, "error: unknown option '%s'\n", opt);
+            print_usage(stderr);
+            return 1;
+        }
+    }
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (g_cfg.ncpu && sched_getaffinity(0, sizeof(allowed), &allowed) != 0) CPU_ZERO(&allowed);
+    for (int i = 0; i < g_cfg.ncpu; ++i) {
+        if (!CPU_ISSET(g_cfg.cpus[i], &allowed)) {
+            fprintf(stderr, "error: cpu %d is not available to this process\n", g_cfg.cpus[i]);
+            return 1;
+        }
+    }
+    pin_self(0);
+
+    printf("{\n  \"bench\": \"queue\",\n  \"cpus_online\": %ld,\n  \"pin\": [", sysconf(_SC_NPROCESSORS_ONLN));
+    for (int i = 0; i < g_cfg.ncpu; ++i) printf("%s%d", i ? ", " : "", g_cfg.cpus[i]);
+    printf("]");
+    if (g_cfg.only & BENCH_PINGPONG) {
+        printf(",\n  \"pingpong\": {\n");
+        print_pingpong("queue", 0, 0);
+        print_pingpong("monitor", 1, 1);
+        printf("  }");
+    }
+    if (g_cfg.only & BENCH_THROUGHPUT) {
+        printf(",\n  \"throughput\": [\n");
+        for (int i = 0; i < g_cfg.ncap; ++i) print_throughput(g_cfg.capacities[i], i == g_cfg.ncap - 1);
+        printf("  ]");
+    }
+    if (g_cfg.only & BENCH_OSCILLATION) {
+        printf(",\n");
+        print_oscillation();
+    }
+    if (g_cfg.only & BENCH_FINISH) {
+        printf(",\n  \"signal_finished\": [\n");
+        for (int i = 0; i < g_cfg.nwait; ++i) print_finish(g_cfg.waiters[i], i == g_cfg.nwait - 1);
+        printf("  ]");
+    }
+    printf("\n}\n");
+    return 0;
+}
@@ -20,27 +20,57 @@ mkdir -p "$OUT"
 
 CC=${CC:-gcc}
 
-CFLAGS_MAIN="-Wall -Wextra -O2 -Iplugins -Iplugins/sync"
-LDFLAGS_MAIN="-ldl"
+# zlib is optional: without it gzip input and filesink format=gzip are
+# refused at run time (zstd needs no headers, libzstd is loaded when used)
+ZLIB_CFLAGS=""; ZLIB_LIBS=""
+if printf '#include <zlib.h>\nint main(void) { return zlibVersion() == 0; }\n' \
+     | $CC -x c - -o /dev/null -lz >/dev/null 2>&1; then
+  ZLIB_CFLAGS="-DHAVE_ZLIB"; ZLIB_LIBS="-lz"
+else
+  warn "zlib not found, building without gzip support"
+fi
 
-PLUGIN_LIST=(logger uppercaser rotator flipper expander typewriter)
+CFLAGS_MAIN="-Wall -Wextra -O2 -Iplugins -Iplugins/sync $ZLIB_CFLAGS"
+LDFLAGS_MAIN="-ldl -lpthread -lm -lrt $ZLIB_LIBS"
+
+PLUGIN_LIST=(logger uppercaser rotator flipper expander typewriter nullsink countsink shmout netsend grep splitter aggregate filesink tokenizer cut jsonpick)
 
 ok "Compiling analyzer"
 $CC $CFLAGS_MAIN \
-  main.c plugin_loader.c plugin_runtime.c \
+  main.c plugin_loader.c plugin_runtime.c control.c signals.c daemon.c generator.c autoscale.c trace.c decompress.c plugins/sync/mem_budget.c plugins/sync/shm_ring.c plugins/net_link.c plugins/zstd_shim.c \
   -o "$OUT/analyzer" \
   $LDFLAGS_MAIN
 ok "Analyzer ready at $OUT/analyzer"
 
+ok "Compiling bench_queue"
+$CC $CFLAGS_MAIN \
+  bench_queue.c plugins/sync/consumer_producer.c plugins/sync/monitor.c plugins/sync/mem_budget.c plugins/sync/spill.c \
+  -o "$OUT/bench_queue" \
+  $LDFLAGS_MAIN
+
+ok "Compiling bench_log"
+$CC $CFLAGS_MAIN \
+  bench_log.c plugins/log_ring.c \
+  -o "$OUT/bench_log" \
+  $LDFLAGS_MAIN
+
 for plugin_name in "${PLUGIN_LIST[@]}"; do
   ok "Building plugin: $plugin_name"
 
-  gcc -fPIC -shared -o "output/${plugin_name}.so" \
+  gcc -fPIC -shared $ZLIB_CFLAGS -o "output/${plugin_name}.so" \
     "plugins/${plugin_name}.c" \
     "plugins/plugin_common.c" \
+    "plugins/memo_cache.c" \
+    "plugins/log_ring.c" \
+    "plugins/chain_kernel.c" \
     "plugins/sync/monitor.c" \
     "plugins/sync/consumer_producer.c" \
-    -ldl -lpthread
+    "plugins/sync/mem_budget.c" \
+    "plugins/sync/shm_ring.c" \
+    "plugins/sync/spill.c" \
+    "plugins/net_link.c" \
+    "plugins/zstd_shim.c" \
+    -ldl -lpthread -lm -lrt $ZLIB_LIBS
 done
 
 echo -e "${GREEN}✔ Build finished successfully.${NC}"
@@ -0,0 +1,196 @@
+#include "control.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "signals.h"
+
+static struct {
+    int         started;
+    pthread_t   tid;
+    int         fd;      // the FIFO, opened read-write
+    int         wake[2]; // control_stop writes a byte to end the thread
+    char*       created; // path to unlink on stop, when we made the FIFO
+    pipeline_t* pl;
+} g_ctl;
+
+// Small strdup to avoid non-portable prototypes
+static char* dup_cstr(const char* s) {
+    if (!s) return NULL;
+    size_t n = strlen(s);
+    char* p = (char*)malloc(n + 1);
+    if (!p) return NULL;
+    memcpy(p, s, n + 1);
+    return p;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+// ctl_lock rather than lock, so "list" answers even while ingestion is blocked
+static void print_chain(pipeline_t* pl) {
+    pthread_mutex_lock(&pl->ctl_lock);
+    fprintf(stderr, "control: chain:");
+    for (size_t i = 0; i < pl->count; ++i) {
+        fprintf(stderr, " [%zu]%s", i, pl->plugs[i].name ? pl->plugs[i].name : "(unknown)");
+    }
+    fprintf(stderr, "\n");
+    pthread_mutex_unlock(&pl->ctl_lock);
+}
+
+// Parse and run one command line, report the outcome on stderr
+static void run_command(pipeline_t* pl, char* line) {
+    char* save = NULL;
+    const char* cmd = strtok_r(line, " \t\r\n", &save);
+    const char* a1  = cmd ? strtok_r(NULL, " \t\r\n", &save) : NULL;
+    const char* a2  = a1  ? strtok_r(NULL, " \t\r\n", &save) : NULL;
+    if (!cmd) return; // blank line
+
+    char* err = NULL;
+    int rc = -1;
+    double t0 = now_ms();
+
+    if (strcmp(cmd, "list") == 0) {
+        print_chain(pl);
+        return;
+    } else if (strcmp(cmd, "stats") == 0 || strcmp(cmd, "flush") == 0 ||
+               strcmp(cmd, "drain") == 0 || strcmp(cmd, "stop") == 0) {
+        // control lane: same path as the signals, never queued behind data
+        signals_request(strcmp(cmd, "stats") == 0 ? 's'
+                      : strcmp(cmd, "flush") == 0 ? 'f'
+                      : strcmp(cmd, "drain") == 0 ? 'd' : 'x');
+        fprintf(stderr, "control: %s requested\n", cmd);
+        return;
+    } else if (strcmp(cmd, "swap") == 0 && a1) {
+        rc = pipeline_swap_stage(pl, a1, a2 ? a2 : a1, &err);
+    } else if (strcmp(cmd, "insert") == 0 && a1 && a2) {
+        char* endp = NULL;
+        errno = 0;
+        unsigned long pos = strtoul(a1, &endp, 10);
+        if (endp == a1 || *endp != '\0' || errno == ERANGE) {
+            fprintf(stderr, "control: error: invalid position '%s'\n", a1);
+            return;
+        }
+        rc = pipeline_insert_stage(pl, (size_t)pos, a2, &err);
+    } else if (strcmp(cmd, "remove") == 0 && a1) {
+        rc = pipeline_remove_stage(pl, a1, &err);
+    } else {
+        fprintf(stderr, "control: error: unknown command '%s'\n", cmd);
+        return;
+    }
+
+    if (rc != 0) {
+        fprintf(stderr, "control: error: %s failed: %s\n", cmd, err ? err : "unknown error");
+        free(err);
+        return;
+    }
+    fprintf(stderr, "control: %s done in %.2f ms\n", cmd, now_ms() - t0);
+}
+
+static void* control_thread(void* arg) {
+    (void)arg;
+    char line[1024];
+    size_t used = 0;
+    int skipping = 0; // inside a line longer than the buffer, dropped
+    for (;;) {
+        // opened read-write, so the FIFO never reports EOF between writers
+        struct pollfd pfd[2] = {{g_ctl.fd, POLLIN, 0}, {g_ctl.wake[0], POLLIN, 0}};
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfd[1].revents) break;
+        if (!(pfd[0].revents & POLLIN)) continue;
+        ssize_t n = read(g_ctl.fd, line + used, sizeof(line) - 1 - used);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (n <= 0) break;
+        used += (size_t)n;
+        char* p = line;
+        char* nl;
+        while ((nl = memchr(p, '\n', used - (size_t)(p - line)))) {
+            *nl = '\0';
+            if (!skipping) run_command(g_ctl.pl, p);
+            skipping = 0;
+            p = nl + 1;
+        }
+        used -= (size_t)(p - line);
+        memmove(line, p, used);
+        if (used == sizeof(line) - 1) {
+            fprintf(stderr, "control: error: command too long\n");
+            used = 0;
+            skipping = 1;
+        }
+    }
+    return NULL;
+}
+
+int control_start(const char* path, pipeline_t* pl, char** failed_msg) {
+    *failed_msg = NULL;
+    if (g_ctl.started) {
+        *failed_msg = dup_cstr("control FIFO already running");
+        return -1;
+    }
+    int created = mkfifo(path, 0600) == 0;
+    if (!created && errno != EEXIST) {
+        *failed_msg = dup_cstr(strerror(errno));
+        return -1;
+    }
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        *failed_msg = dup_cstr(strerror(errno));
+        if (created) unlink(path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISFIFO(st.st_mode)) {
+        close(fd);
+        *failed_msg = dup_cstr("not a FIFO");
+        return -1;
+    }
+    if (pipe(g_ctl.wake) != 0) {
+        close(fd);
+        if (created) unlink(path);
+        *failed_msg = dup_cstr(strerror(errno));
+        return -1;
+    }
+    g_ctl.fd = fd;
+    g_ctl.pl = pl;
+    g_ctl.created = created ? dup_cstr(path) : NULL;
+
+    if (pthread_create(&g_ctl.tid, NULL, control_thread, NULL) != 0) {
+        close(fd);
+        close(g_ctl.wake[0]);
+        close(g_ctl.wake[1]);
+        if (created) unlink(path);
+        free(g_ctl.created);
+        g_ctl.created = NULL;
+        *failed_msg = dup_cstr("pthread_create failed");
+        return -1;
+    }
+    g_ctl.started = 1;
+    return 0;
+}
+
+void control_stop(void) {
+    if (!g_ctl.started) return;
+    char b = 'q';
+    while (write(g_ctl.wake[1], &b, 1) < 0 && errno == EINTR) { }
+    (void)pthread_join(g_ctl.tid, NULL); // a command in progress completes first
+    close(g_ctl.fd);
+    close(g_ctl.wake[0]);
+    close(g_ctl.wake[1]);
+    if (g_ctl.created) unlink(g_ctl.created);
+    free(g_ctl.created);
+    g_ctl.created = NULL;
+    g_ctl.started = 0;
+}
@@ -0,0 +1,27 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include "plugin_runtime.h"
+
+// Start a background thread that reads rewiring commands from a FIFO at path
+// (created if missing, and then removed again by control_stop). One command per line:
+//   swap <name> [<spec>]     replace stage <name> (default: a fresh load of the same plugin)
+//   insert <pos> <spec>      start <spec> and insert it before position <pos>
+//   remove <name>            drain and remove stage <name>
+//   list                     print the current chain
+//   stats                    per-stage stats snapshot (like SIGUSR1)
+//   flush                    flush every stage's stdout/stderr
+//   drain                    stop reading input, finish queued items (like SIGTERM)
+//   stop                     discard queued items and end every stage now
+// stats, flush and stop travel on each stage's control lane and are served
+// before any queued data item.
+// <spec> is "name" or "name:key=value,...". Results are reported on stderr.
+// On success: return 0
+// On failure: return -1 and set *failed_msg to a heap-allocated error string (caller frees)
+int control_start(const char* path, pipeline_t* pl, char** failed_msg);
+
+// Stop the control thread and wait for it; a command in progress completes
+// first (no-op if it was not started). Call before the stages are finalized.
+void control_stop(void);
+
+#endif // CONTROL_H
@@ -0,0 +1,258 @@
+#define _GNU_SOURCE // struct ucred
+#include "daemon.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "plugin_loader.h"
+
+#define DAEMON_MAX_REQUEST 65536
+#define DAEMON_MAX_ARGS    1024
+#define DAEMON_FDS         4     // stdin, stdout, stderr, working directory
+
+static volatile sig_atomic_t g_quit;
+static volatile pid_t g_stream_pid;
+
+static void on_quit(int signo) {
+    (void)signo;
+    g_quit = 1;
+}
+
+static void on_forward(int signo) {
+    if (g_stream_pid > 0) kill(g_stream_pid, signo);
+}
+
+static int fill_addr(struct sockaddr_un* addr, const char* path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return -1;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+static int listen_on(const char* path) {
+    struct sockaddr_un addr;
+    if (fill_addr(&addr, path) != 0) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    // replace a socket left behind by a previous daemon, nothing else
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    // owner-only from the start: streams run with the daemon's rights
+    mode_t old_mask = umask(077);
+    int rc = bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+    umask(old_mask);
+    if (rc != 0 || chmod(path, 0600) != 0 || listen(fd, 64) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+// Only the daemon's own user may start streams, whatever the socket's mode
+static int peer_allowed(int conn) {
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || len != sizeof(cred)) return 0;
+    return cred.uid == geteuid();
+}
+
+// Child side: take over the client's streams and directory, run one
+// analyzer, report its pid first and its exit code last
+static int serve_stream(int conn, daemon_entry_t entry) {
+    static char buf[DAEMON_MAX_REQUEST];
+    char ctrl[CMSG_SPACE(sizeof(int) * DAEMON_FDS)];
+    struct iovec iov = { buf, sizeof(buf) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    ssize_t n = recvmsg(conn, &msg, 0);
+    struct cmsghdr* c = (n >= 0) ? CMSG_FIRSTHDR(&msg) : NULL; // n == 0: no arguments
+    if (!c || c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS ||
+        c->cmsg_len != CMSG_LEN(sizeof(int) * DAEMON_FDS) || (n > 0 && buf[n - 1] != '\0') ||
+        (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+        fprintf(stderr, "daemon: malformed request\n");
+        return 1;
+    }
+    int fds[DAEMON_FDS];
+    memcpy(fds, CMSG_DATA(c), sizeof(fds));
+    for (int i = 0; i < 3; ++i) dup2(fds[i], i);
+    int cwd_ok = (fchdir(fds[3]) == 0);
+    for (int i = 0; i < DAEMON_FDS; ++i) close(fds[i]);
+    if (!cwd_ok) {
+        fprintf(stderr, "daemon: cannot enter the client's directory: %s\n", strerror(errno));
+        return 1;
+    }
+    // stdout was never used here; buffer it as a fresh process would
+    setvbuf(stdout, NULL, isatty(STDOUT_FILENO) ? _IOLBF : _IOFBF, 0);
+
+    char* argv[DAEMON_MAX_ARGS + 1];
+    int argc = 0;
+    argv[argc++] = "analyzer";
+    for (char* p = buf; p < buf + n && argc < DAEMON_MAX_ARGS; p += strlen(p) + 1) argv[argc++] = p;
+    argv[argc] = NULL;
+
+    pid_t self = getpid();
+    if (send(conn, &self, sizeof(self), MSG_NOSIGNAL) != (ssize_t)sizeof(self)) return 1;
+
+    int rc = entry(argc, argv);
+    fflush(NULL);
+    (void)send(conn, &rc, sizeof(rc), MSG_NOSIGNAL);
+    return rc;
+}
+
+int daemon_serve(const char* path, int n_preload, char** preload, daemon_entry_t entry) {
+    // loaded once here, children find them already mapped and relocated
+    plugin_handle_t* plugs = NULL;
+    if (n_preload > 0) {
+        char* err = NULL;
+        if (load_all_plugins((const char* const*)preload, (size_t)n_preload, &plugs, &err) != 0) {
+            fprintf(stderr, "error: daemon preload failed: %s\n", err ? err : "load failed");
+            free(err);
+            return 1;
+        }
+    }
+
+    int lfd = listen_on(path);
+    if (lfd < 0) {
+        fprintf(stderr, "error: daemon socket '%s': %s\n", path, strerror(errno));
+        unload_all_plugins(plugs, (size_t)n_preload);
+        return 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_quit; // no SA_RESTART: accept returns EINTR
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGCHLD, SIG_IGN); // streams are reaped automatically
+    fprintf(stderr, "daemon: listening on %s (%d plugins preloaded)\n", path, n_preload);
+
+    while (!g_quit) {
+        int conn = accept(lfd, NULL, NULL);
+        if (conn < 0) {
+            if (errno != EINTR && errno != ECONNABORTED) fprintf(stderr, "daemon: accept: %s\n", strerror(errno));
+            continue;
+        }
+        if (!peer_allowed(conn)) {
+            fprintf(stderr, "daemon: refused a stream from another user\n");
+            close(conn);
+            continue;
+        }
+        fflush(NULL); // nothing buffered may be written twice
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(lfd);
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            signal(SIGCHLD, SIG_DFL);
+            int rc = serve_stream(conn, entry);
+            close(conn);
+            exit(rc);
+        }
+        if (pid < 0) fprintf(stderr, "daemon: fork: %s\n", strerror(errno));
+        close(conn);
+    }
+
+    // running streams are independent processes and keep going
+    close(lfd);
+    unlink(path);
+    unload_all_plugins(plugs, (size_t)n_preload);
+    fprintf(stderr, "daemon: stopped\n");
+    return 0;
+}
+
+int daemon_connect(const char* path, int argc, char** argv) {
+    static char buf[DAEMON_MAX_REQUEST];
+    size_t len = 0;
+    for (int i = 0; i < argc; ++i) {
+        size_t n = strlen(argv[i]) + 1;
+        if (len + n > sizeof(buf) || i >= DAEMON_MAX_ARGS - 1) {
+            fprintf(stderr, "error: arguments too long for the daemon\n");
+            return 1;
+        }
+        memcpy(buf + len, argv[i], n);
+        len += n;
+    }
+
+    struct sockaddr_un addr;
+    if (fill_addr(&addr, path) != 0) {
+        fprintf(stderr, "error: daemon '%s': %s\n", path, strerror(ENAMETOOLONG));
+        return 1;
+    }
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "error: daemon '%s': %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+
+    int fds[DAEMON_FDS] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO,
+                            open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC) };
+    if (fds[3] < 0) {
+        fprintf(stderr, "error: cannot open working directory: %s\n", strerror(errno));
+        close(fd);
+        return 1;
+    }
+    char ctrl[CMSG_SPACE(sizeof(fds))];
+    memset(ctrl, 0, sizeof(ctrl));
+    struct iovec iov = { buf, len };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+    struct cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(c), fds, sizeof(fds));
+
+    ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    close(fds[3]);
+    pid_t pid = 0;
+    if (sent != (ssize_t)len || recv(fd, &pid, sizeof(pid), 0) != (ssize_t)sizeof(pid)) {
+        fprintf(stderr, "error: daemon '%s' did not start the stream\n", path);
+        close(fd);
+        return 1;
+    }
+
+    // the stream owns our terminal now, so signals meant for it go there
+    g_stream_pid = pid;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_forward;
+    sigemptyset(&sa.sa_mask);
+    int signos[] = { SIGINT, SIGTERM, SIGUSR1, SIGUSR2 };
+    for (size_t i = 0; i < sizeof(signos) / sizeof(signos[0]); ++i) sigaction(signos[i], &sa, NULL);
+
+    int rc = 0;
+    ssize_t n;
+    while ((n = recv(fd, &rc, sizeof(rc), 0)) < 0 && errno == EINTR) { }
+    close(fd);
+    if (n != (ssize_t)sizeof(rc)) {
+        fprintf(stderr, "error: stream ended without an exit status\n");
+        return 1;
+    }
+    return rc;
+}
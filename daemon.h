@@ -0,0 +1,20 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+// Runs one analyzer invocation (the regular main), returns its exit code
+typedef int (*daemon_entry_t)(int argc, char** argv);
+
+// Serve streams on a Unix-domain socket at path until SIGINT/SIGTERM.
+// The plugins named in preload (without .so) are loaded once up front. Each
+// connection forks a child that inherits them and runs entry with the
+// client's arguments, standard streams and working directory, so it behaves
+// exactly like a local run without paying for exec and dlopen.
+// Returns the process exit code.
+int daemon_serve(const char* path, int n_preload, char** preload, daemon_entry_t entry);
+
+// Run argv (analyzer arguments, without the program name) on the daemon at
+// path. Passes stdin/stdout/stderr and the working directory, forwards
+// SIGINT, SIGTERM, SIGUSR1 and SIGUSR2 to the stream and returns its exit code.
+int daemon_connect(const char* path, int argc, char** argv);
+
+#endif // DAEMON_H
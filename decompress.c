@@ -0,0 +1,333 @@
+#define _GNU_SOURCE // fopencookie
+
+#include "decompress.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "signals.h"
+#include "zstd_shim.h"
+
+#define IN_BYTES    (128u << 10) // compressed bytes read at a time
+#define BLOCK_BYTES (256u << 10) // decompressed bytes handed over at a time
+#define N_BLOCKS    4
+#define WAIT_MS     50           // like the line reader's pause at end of input
+
+enum { CODEC_PLAIN, CODEC_GZIP, CODEC_ZSTD, CODEC_UNKNOWN };
+
+static const char* const codec_names[] = { "plain", "gzip", "zstd" };
+
+typedef struct {
+    int fd;                        // compressed input
+    int codec;                     // format of the first member
+    unsigned char in[IN_BYTES];
+    size_t in_pos, in_len;
+    size_t fill;                   // decoded bytes in the block being filled
+
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;          // a block was handed over or freed
+    char*  block[N_BLOCKS];
+    size_t len[N_BLOCKS];
+    unsigned head, tail;           // blocks [head, tail) are ready to read
+    size_t rpos;                   // read offset into block head (reader only)
+    int done;                      // the decoder gave up, no more blocks will come
+
+    _Atomic unsigned long long in_bytes, out_bytes;
+    const zstd_api_t* zstd;        // loaded once the first member is zstd
+    void* zstd_ds;
+#ifdef HAVE_ZLIB
+    z_stream z;
+    int z_ready;
+#endif
+} dstream_t;
+
+static dstream_t* g_stream; // for decompress_report
+
+// Format of the bytes at p, CODEC_UNKNOWN while they are a prefix of a magic number
+static int classify(const unsigned char* p, size_t n) {
+    static const unsigned char gzip_magic[2] = { 0x1f, 0x8b };
+    static const unsigned char zstd_magic[4] = { 0x28, 0xb5, 0x2f, 0xfd };
+    if (n == 0) return CODEC_UNKNOWN;
+    const unsigned char* magic = (p[0] == gzip_magic[0]) ? gzip_magic : zstd_magic;
+    size_t magic_len = (magic == gzip_magic) ? sizeof(gzip_magic) : sizeof(zstd_magic);
+    size_t k = n < magic_len ? n : magic_len;
+    if (memcmp(p, magic, k) != 0) return CODEC_PLAIN;
+    if (k < magic_len) return CODEC_UNKNOWN;
+    return (magic == gzip_magic) ? CODEC_GZIP : CODEC_ZSTD;
+}
+
+static const char* codec_check(dstream_t* s, int codec) {
+#ifndef HAVE_ZLIB
+    if (codec == CODEC_GZIP) return "gzip input needs a build with zlib";
+#endif
+    const char* err = NULL;
+    if (codec == CODEC_ZSTD && !(s->zstd = zstd_shim_load(&err))) return err;
+    return NULL;
+}
+
+// ---- decoder side ----
+
+// Hand the block being filled to the reader
+static void publish(dstream_t* s) {
+    if (s->fill == 0) return;
+    pthread_mutex_lock(&s->lock);
+    s->len[s->tail % N_BLOCKS] = s->fill;
+    s->tail++;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+    s->fill = 0;
+}
+
+// Free space in the block being filled, waiting while every block is unread
+static char* fill_ptr(dstream_t* s, size_t* room) {
+    pthread_mutex_lock(&s->lock);
+    while (s->tail - s->head == N_BLOCKS) pthread_cond_wait(&s->cond, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+    *room = BLOCK_BYTES - s->fill;
+    return s->block[s->tail % N_BLOCKS] + s->fill;
+}
+
+static void produced(dstream_t* s, size_t n) {
+    s->fill += n;
+    atomic_fetch_add(&s->out_bytes, n);
+    if (s->fill == BLOCK_BYTES) publish(s);
+}
+
+// Read more input. What was decoded so far goes to the reader first, since
+// this may block; at end of input it waits for more, like the line reader.
+static void more_input(dstream_t* s) {
+    publish(s);
+    if (s->in_pos > 0) {
+        memmove(s->in, s->in + s->in_pos, s->in_len - s->in_pos);
+        s->in_len -= s->in_pos;
+        s->in_pos = 0;
+    }
+    for (;;) {
+        ssize_t n = read(s->fd, s->in + s->in_len, IN_BYTES - s->in_len);
+        if (n > 0) {
+            s->in_len += (size_t)n;
+            atomic_fetch_add(&s->in_bytes, (unsigned long long)n);
+            return;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) fprintf(stderr, "error: stdin read failed\n");
+        usleep(WAIT_MS * 1000);
+    }
+}
+
+#ifdef HAVE_ZLIB
+static const char* inflate_member(dstream_t* s) {
+    z_stream* z = &s->z;
+    if (!s->z_ready) {
+        if (inflateInit2(z, 16 + MAX_WBITS) != Z_OK) return "zlib init failed"; // gzip wrapper only
+        s->z_ready = 1;
+    } else {
+        inflateReset(z);
+    }
+    int starved = 1; // the last call had room left, so zlib holds no pending output
+    for (;;) {
+        if (s->in_pos == s->in_len && starved) more_input(s);
+        size_t room;
+        char* out = fill_ptr(s, &room);
+        z->next_in = s->in + s->in_pos;
+        z->avail_in = (uInt)(s->in_len - s->in_pos);
+        z->next_out = (Bytef*)out;
+        z->avail_out = (uInt)room;
+        int rc = inflate(z, Z_NO_FLUSH);
+        s->in_pos = s->in_len - z->avail_in;
+        starved = (z->avail_out > 0);
+        produced(s, room - z->avail_out);
+        if (rc == Z_STREAM_END) return NULL;
+        if (rc != Z_OK && rc != Z_BUF_ERROR) return z->msg ? z->msg : "corrupt data";
+    }
+}
+#endif
+
+static const char* zstd_member(dstream_t* s) {
+    if (!s->zstd_ds && !(s->zstd_ds = s->zstd->create_ds())) return "alloc failed";
+    size_t r = s->zstd->init_ds(s->zstd_ds);
+    if (s->zstd->is_error(r)) return s->zstd->error_name(r);
+    int starved = 1;
+    for (;;) {
+        if (s->in_pos == s->in_len && starved) more_input(s);
+        size_t room;
+        char* out = fill_ptr(s, &room);
+        zstd_in_t zin = { s->in + s->in_pos, s->in_len - s->in_pos, 0 };
+        zstd_out_t zout = { out, room, 0 };
+        r = s->zstd->decompress(s->zstd_ds, &zout, &zin);
+        if (s->zstd->is_error(r)) return s->zstd->error_name(r);
+        s->in_pos += zin.pos;
+        starved = (zout.pos < zout.size);
+        produced(s, zout.pos);
+        if (r == 0) return NULL; // frame decoded and flushed
+    }
+}
+
+// Plain bytes after (or instead of) the compressed members, copied as they are
+static void pass_through(dstream_t* s) {
+    for (;;) {
+        if (s->in_pos == s->in_len) more_input(s);
+        size_t room;
+        char* out = fill_ptr(s, &room);
+        size_t n = s->in_len - s->in_pos;
+        if (n > room) n = room;
+        memcpy(out, s->in + s->in_pos, n);
+        s->in_pos += n;
+        produced(s, n);
+    }
+}
+
+static void* decoder_thread(void* arg) {
+    dstream_t* s = (dstream_t*)arg;
+    int codec = s->codec;
+    const char* err = NULL;
+    for (;;) {
+        if (codec == CODEC_PLAIN) pass_through(s); // does not return
+        err = codec_check(s, codec);
+        if (err) break;
+#ifdef HAVE_ZLIB
+        if (codec == CODEC_GZIP) err = inflate_member(s);
+#endif
+        if (codec == CODEC_ZSTD) err = zstd_member(s);
+        if (err) break;
+        // the next member, or what follows the last one
+        while ((codec = classify(s->in + s->in_pos, s->in_len - s->in_pos)) == CODEC_UNKNOWN) more_input(s);
+    }
+    fprintf(stderr, "error: %s input: %s\n", codec_names[codec], err);
+    publish(s);
+    pthread_mutex_lock(&s->lock);
+    s->done = 1;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+// ---- reader side ----
+
+static ssize_t cookie_read(void* cookie, char* buf, size_t size) {
+    dstream_t* s = (dstream_t*)cookie;
+    pthread_mutex_lock(&s->lock);
+    while (s->head == s->tail && !s->done) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += WAIT_MS * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+        pthread_cond_timedwait(&s->cond, &s->lock, &ts);
+        // the signal that asked for a stop cannot interrupt a condition wait
+        if (s->head == s->tail && signals_stop_requested()) {
+            pthread_mutex_unlock(&s->lock);
+            errno = EINTR;
+            return -1;
+        }
+    }
+    if (s->head == s->tail) { // the decoder gave up: end of input for good
+        pthread_mutex_unlock(&s->lock);
+        return 0;
+    }
+    unsigned b = s->head % N_BLOCKS;
+    pthread_mutex_unlock(&s->lock);
+
+    // the decoder does not touch a handed-over block until it is freed
+    size_t n = s->len[b] - s->rpos;
+    if (n > size) n = size;
+    memcpy(buf, s->block[b] + s->rpos, n);
+    s->rpos += n;
+    if (s->rpos == s->len[b]) {
+        s->rpos = 0;
+        pthread_mutex_lock(&s->lock);
+        s->head++;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+    }
+    return (ssize_t)n;
+}
+
+// read(), retried after signals that did not ask for a stop
+static ssize_t read_input(int fd, unsigned char* buf, size_t n) {
+    for (;;) {
+        ssize_t r = read(fd, buf, n);
+        if (r >= 0 || errno != EINTR || signals_stop_requested()) return r;
+    }
+}
+
+FILE* decompress_open(FILE* in, const char** failed_msg) {
+    *failed_msg = NULL;
+    int fd = fileno(in);
+
+    // one byte first: anything that cannot start a magic number goes back with ungetc
+    unsigned char magic[4];
+    if (read_input(fd, magic, 1) != 1) return in; // end of input or a stop: the input loop handles it
+    if (classify(magic, 1) == CODEC_PLAIN) {
+        ungetc(magic[0], in);
+        return in;
+    }
+    // the rest of the magic number, stopping early at a line end so a short first line is not held up
+    size_t got = 1;
+    int codec;
+    while ((codec = classify(magic, got)) == CODEC_UNKNOWN && memchr(magic, '\n', got) == NULL) {
+        ssize_t r = read_input(fd, magic + got, sizeof(magic) - got);
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    if (codec == CODEC_UNKNOWN) codec = CODEC_PLAIN; // bytes already taken, they flow through the decoder
+
+    dstream_t* s = (dstream_t*)calloc(1, sizeof(*s));
+    if (!s) {
+        *failed_msg = "alloc failed";
+        return NULL;
+    }
+    s->fd = fd;
+    s->codec = codec;
+    memcpy(s->in, magic, got);
+    s->in_len = got;
+    atomic_store(&s->in_bytes, got);
+    const char* err = codec_check(s, codec);
+    for (int i = 0; !err && i < N_BLOCKS; ++i) {
+        if (!(s->block[i] = (char*)malloc(BLOCK_BYTES))) err = "alloc failed";
+    }
+    cookie_io_functions_t io = { .read = cookie_read, .write = NULL, .seek = NULL, .close = NULL };
+    FILE* out = err ? NULL : fopencookie(s, "r", io);
+    if (!out) {
+        *failed_msg = err ? err : "fopencookie failed";
+        for (int i = 0; i < N_BLOCKS; ++i) free(s->block[i]);
+        free(s);
+        return NULL;
+    }
+    setvbuf(out, NULL, _IOFBF, 64u << 10);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+
+    // the handlers must keep running on the input thread only
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    pthread_t tid;
+    int rc = pthread_create(&tid, NULL, decoder_thread, s);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        *failed_msg = "pthread_create failed";
+        fclose(out); // leaves s for good, the cookie has no close function
+        return NULL;
+    }
+    pthread_detach(tid); // may stay blocked in read() on the input until exit
+    g_stream = s;
+    return out;
+}
+
+void decompress_report(FILE* out) {
+    dstream_t* s = g_stream;
+    if (!s) return;
+    unsigned long long in = atomic_load(&s->in_bytes), dec = atomic_load(&s->out_bytes);
+    fprintf(out, "input: %s compressed=%llu decompressed=%llu ratio=%.2f\n",
+            codec_names[s->codec], in, dec, in ? (double)dec / (double)in : 0.0);
+}
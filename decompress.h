@@ -0,0 +1,25 @@
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+#include <stdio.h>
+
+// Transparent decompression of the input. The first bytes of the stream pick
+// the format: gzip (1f 8b, through zlib) or zstd (28 b5 2f fd, through
+// libzstd.so.1 loaded at run time); anything else is read as plain text.
+// A compressed stream is inflated by a background thread into a few blocks
+// that the input loop reads from directly, so decompression overlaps with the
+// first stage. Concatenated members are decoded one after the other, and data
+// that follows the last member is passed through as text (e.g. a trailing
+// "<END>" line).
+
+// Return the stream to read lines from: in itself, or a stream of its
+// decompressed bytes. Call from the input thread once signals_start has run:
+// the first read blocks until input arrives and gives up when a stop is requested.
+// On success: return the stream
+// On failure: return NULL and set *failed_msg to a static error string
+FILE* decompress_open(FILE* in, const char** failed_msg);
+
+// Print the compressed and decompressed byte counts to out (no-op for plain input)
+void decompress_report(FILE* out);
+
+#endif // DECOMPRESS_H
@@ -0,0 +1,208 @@
+#include "generator.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "signals.h"
+
+// Small strdup to avoid non-portable prototypes
+static char* dup_cstr(const char* s) {
+    if (!s) return NULL;
+    size_t n = strlen(s);
+    char* p = (char*)malloc(n + 1);
+    if (!p) return NULL;
+    memcpy(p, s, n + 1);
+    return p;
+}
+
+static char* fmt_error(const char* what, const char* value) {
+    size_t need = strlen(what) + strlen(value) + 4;
+    char* p = (char*)malloc(need);
+    if (p) snprintf(p, need, "%s '%s'", what, value);
+    return p;
+}
+
+static int parse_u64(const char* s, unsigned long long* out) {
+    if (!s || !*s || *s == '-') return -1;
+    errno = 0;
+    char* endp = NULL;
+    unsigned long long v = strtoull(s, &endp, 10);
+    if (endp == s || *endp != '\0' || errno == ERANGE) return -1;
+    *out = v;
+    return 0;
+}
+
+static int parse_double(const char* s, double* out) {
+    if (!s || !*s) return -1;
+    errno = 0;
+    char* endp = NULL;
+    double v = strtod(s, &endp);
+    if (endp == s || *endp != '\0' || errno == ERANGE || !(v >= 0.0)) return -1;
+    *out = v;
+    return 0;
+}
+
+int generator_parse(const char* spec, generator_config_t* cfg, char** failed_msg) {
+    *failed_msg = NULL;
+    *cfg = (generator_config_t){
+        .count = 100000, .rate = 0.0, .len_min = 16, .len_max = 128,
+        .len_exp = 0, .repeat = 0.0, .pool = 64, .seed = 1,
+    };
+
+    char* buf = dup_cstr(spec ? spec : "");
+    if (!buf) { *failed_msg = dup_cstr("alloc failed"); return -1; }
+
+    int rc = 0;
+    char* save = NULL;
+    for (char* item = strtok_r(buf, ",", &save); item && rc == 0; item = strtok_r(NULL, ",", &save)) {
+        char* eq = strchr(item, '=');
+        if (!eq) { *failed_msg = fmt_error("malformed generator option", item); rc = -1; break; }
+        *eq = '\0';
+        const char* key = item;
+        const char* val = eq + 1;
+        unsigned long long u = 0;
+
+        if (strcmp(key, "count") == 0) {
+            rc = parse_u64(val, &cfg->count);
+        } else if (strcmp(key, "rate") == 0) {
+            rc = parse_double(val, &cfg->rate);
+        } else if (strcmp(key, "len") == 0) {
+            char* dash = strchr(val, '-');
+            unsigned long long lo = 0, hi = 0;
+            if (dash) {
+                *dash = '\0';
+                rc = (parse_u64(val, &lo) == 0 && parse_u64(dash + 1, &hi) == 0) ? 0 : -1;
+            } else {
+                rc = parse_u64(val, &lo);
+                hi = lo;
+            }
+            if (rc == 0 && (hi < lo || hi > (1ull << 24))) rc = -1;
+            cfg->len_min = (size_t)lo;
+            cfg->len_max = (size_t)hi;
+        } else if (strcmp(key, "dist") == 0) {
+            if (strcmp(val, "uniform") == 0)  cfg->len_exp = 0;
+            else if (strcmp(val, "exp") == 0) cfg->len_exp = 1;
+            else rc = -1;
+        } else if (strcmp(key, "repeat") == 0) {
+            rc = (parse_double(val, &cfg->repeat) == 0 && cfg->repeat <= 1.0) ? 0 : -1;
+        } else if (strcmp(key, "pool") == 0) {
+            rc = (parse_u64(val, &u) == 0 && u > 0 && u <= 1000000) ? 0 : -1;
+            cfg->pool = (unsigned)u;
+        } else if (strcmp(key, "seed") == 0) {
+            rc = parse_u64(val, &u);
+            cfg->seed = u ? u : 1;
+        } else {
+            *failed_msg = fmt_error("unknown generator option", key);
+            rc = -1;
+            break;
+        }
+        if (rc != 0) *failed_msg = fmt_error("invalid value for generator option", key);
+    }
+    free(buf);
+    return rc;
+}
+
+// xorshift64*: fast, good enough for synthetic text
+static uint64_t next_rand(uint64_t* s) {
+    uint64_t x = *s;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *s = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+static double next_unit(uint64_t* s) {
+    return (double)(next_rand(s) >> 11) * (1.0 / 9007199254740992.0); // [0, 1)
+}
+
+static size_t next_len(const generator_config_t* cfg, uint64_t* s) {
+    size_t span = cfg->len_max - cfg->len_min;
+    if (span == 0) return cfg->len_min;
+    if (!cfg->len_exp) return cfg->len_min + (size_t)(next_rand(s) % (span + 1));
+
+    double mean = (double)span / 2.0;
+    double v = -log(1.0 - next_unit(s)) * mean;
+    return cfg->len_min + (v > (double)span ? span : (size_t)v);
+}
+
+// Random printable text; no '<' so a generated line is never the <END> sentinel
+static void fill_line(char* out, size_t len, uint64_t* s) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789";
+    for (size_t i = 0; i < len; ++i) {
+        out[i] = alphabet[next_rand(s) % (sizeof(alphabet) - 1)];
+    }
+    out[len] = '\0';
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int generator_run(const generator_config_t* cfg, pipeline_t* pl) {
+    uint64_t rng = cfg->seed;
+    char* line = NULL;
+
+    // lines that repeated picks are drawn from
+    char** pool = NULL;
+    if (cfg->repeat > 0.0) {
+        pool = (char**)calloc(cfg->pool, sizeof(char*));
+        if (!pool) { fprintf(stderr, "error: generator alloc failed\n"); return -1; }
+        for (unsigned i = 0; i < cfg->pool; ++i) {
+            size_t len = next_len(cfg, &rng);
+            pool[i] = (char*)malloc(len + 1);
+            if (!pool[i]) { fprintf(stderr, "error: generator alloc failed\n"); goto fail; }
+            fill_line(pool[i], len, &rng);
+        }
+    }
+
+    line = (char*)malloc(cfg->len_max + 1);
+    if (!line) { fprintf(stderr, "error: generator alloc failed\n"); goto fail; }
+
+    double start = now_sec();
+    for (unsigned long long i = 0; cfg->count == 0 || i < cfg->count; ++i) {
+        if (signals_stop_requested()) break; // drain or stop: end the stream here
+        if (cfg->rate > 0.0) {
+            double wait = start + (double)i / cfg->rate - now_sec();
+            if (wait > 0.0) {
+                struct timespec ts = { (time_t)wait, (long)((wait - (double)(time_t)wait) * 1e9) };
+                nanosleep(&ts, NULL);
+            }
+        }
+
+        const char* out = line;
+        if (pool && next_unit(&rng) < cfg->repeat) {
+            out = pool[next_rand(&rng) % cfg->pool];
+        } else {
+            fill_line(line, next_len(cfg, &rng), &rng);
+        }
+
+        const char* perr = pipeline_place_work(pl, out);
+        if (perr) fprintf(stderr, "error: place_work failed: %s\n", perr);
+    }
+
+    const char* perr = pipeline_finish(pl);
+    if (perr) fprintf(stderr, "error: place_work(<END>) failed: %s\n", perr);
+
+    free(line);
+    if (pool) {
+        for (unsigned i = 0; i < cfg->pool; ++i) free(pool[i]);
+        free(pool);
+    }
+    return 0;
+
+fail:
+    free(line);
+    if (pool) {
+        for (unsigned i = 0; i < cfg->pool; ++i) free(pool[i]);
+        free(pool);
+    }
+    (void)pipeline_finish(pl);
+    return -1;
+}
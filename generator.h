@@ -0,0 +1,29 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "plugin_runtime.h"
+
+// Synthetic line source for load tests (--generate=...), feeds the first stage directly
+typedef struct {
+    unsigned long long count; // lines to produce, 0 = until killed
+    double   rate;            // lines per second, 0 = as fast as the pipeline accepts
+    size_t   len_min;         // shortest line
+    size_t   len_max;         // longest line
+    int      len_exp;         // exponential lengths (mean halfway between min and max) instead of uniform
+    double   repeat;          // probability that a line repeats one from the pool, 0..1
+    unsigned pool;            // distinct lines available for repetition
+    uint64_t seed;            // PRNG seed
+} generator_config_t;
+
+// Parse "key=value,..." (count, rate, len=N|MIN-MAX, dist=uniform|exp, repeat, pool, seed)
+// On success: return 0
+// On failure: return -1 and set *failed_msg to a heap-allocated error string (caller frees)
+int generator_parse(const char* spec, generator_config_t* cfg, char** failed_msg);
+
+// Produce the configured lines into the pipeline, then send <END>
+// On success: return 0; on failure: return -1 (the error was printed)
+int generator_run(const generator_config_t* cfg, pipeline_t* pl);
+
+#endif // GENERATOR_H
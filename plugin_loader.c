@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <dlfcn.h>
+#include <unistd.h> // write, close, unlink
 
 // Simple strdup replacement to avoid non standard prototypes 
 static char* dup_cstr(const char* s) {
@@ -67,6 +68,14 @@ static void* must_dlsym(void* handle, const char* sym, const char* plug_name, ch
     return p;
 }
 
+// dlsym for optional entry points: NULL when absent, never an error
+static void* opt_dlsym(void* handle, const char* sym) {
+    dlerror(); // clear
+    void* p = dlsym(handle, sym);
+    (void)dlerror();
+    return p;
+}
+
 int find_duplicate_name(const char* const* names, size_t count, size_t* oi, size_t* oj) {
     for (size_t i = 0; i < count; ++i) {
         if (!names[i]) continue;
@@ -91,6 +100,132 @@ static void free_partial(plugin_handle_t* arr, size_t upto) {
     free(arr);
 }
 
+// Copy the plugin's .so to a private temp file and dlopen that, so a rebuilt
+// plugin gets a new image even while the previous build is still loaded.
+static void* open_so_fresh_copy(const char* name, char** err_out) {
+    char p1[1024], p2[1024];
+    if (!build_candidate_paths(name, p1, sizeof(p1), p2, sizeof(p2))) {
+        *err_out = dup_cstr("invalid plugin name");
+        return NULL;
+    }
+    FILE* src = fopen(p1, "rb");
+    if (!src) src = fopen(p2, "rb");
+    if (!src) {
+        *err_out = dup_cstr("dlopen failed: plugin file not found");
+        return NULL;
+    }
+
+    const char* dir = getenv("TMPDIR");
+    char tmp[1024];
+    int n = snprintf(tmp, sizeof(tmp), "%s/analyzer-%s-XXXXXX.so", (dir && *dir) ? dir : "/tmp", name);
+    int fd = (n > 0 && (size_t)n < sizeof(tmp)) ? mkstemps(tmp, 3) : -1;
+    if (fd < 0) {
+        fclose(src);
+        *err_out = dup_cstr("dlopen failed: cannot create temp copy");
+        return NULL;
+    }
+
+    char buf[65536];
+    size_t got;
+    int ok = 1;
+    while (ok && (got = fread(buf, 1, sizeof(buf), src)) > 0) {
+        size_t off = 0;
+        while (off < got) {
+            ssize_t w = write(fd, buf + off, got - off);
+            if (w <= 0) { ok = 0; break; }
+            off += (size_t)w;
+        }
+    }
+    if (ferror(src)) ok = 0;
+    fclose(src);
+    if (close(fd) != 0) ok = 0;
+
+    void* h = ok ? dlopen(tmp, RTLD_NOW | RTLD_LOCAL) : NULL;
+    const char* e = ok ? (h ? NULL : dlerror()) : "cannot copy plugin file";
+    unlink(tmp); // the mapping keeps the image alive
+    if (!h) {
+        size_t need = strlen("dlopen failed: ") + strlen(e ? e : "unknown error") + 1;
+        char* msg = (char*)malloc(need);
+        if (msg) snprintf(msg, need, "dlopen failed: %s", e ? e : "unknown error");
+        *err_out = msg;
+    }
+    return h;
+}
+
+int load_plugin(const char* name, int fresh_copy, plugin_handle_t* out, char** out_error) {
+    if (out_error) *out_error = NULL;
+    *out = (plugin_handle_t){0};
+    char* err = NULL;
+
+    // open .so
+    void* h = fresh_copy ? open_so_fresh_copy(name, &err) : open_so_candidates(name, &err);
+    if (!h) {
+        if (!err) err = dup_cstr("dlopen failed");
+        if (out_error) *out_error = err; else free(err);
+        return -1;
+    }
+
+    // resolve required symbols exactly as in the SDK
+    plugin_init_func_t          init =
+        (plugin_init_func_t)         must_dlsym(h, "plugin_init",          name, &err);
+    plugin_fini_func_t          fini =
+        (plugin_fini_func_t)         must_dlsym(h, "plugin_fini",          name, &err);
+    plugin_place_work_func_t    place_work =
+        (plugin_place_work_func_t)   must_dlsym(h, "plugin_place_work",    name, &err);
+    plugin_attach_func_t        attach =
+        (plugin_attach_func_t)       must_dlsym(h, "plugin_attach",        name, &err);
+    plugin_wait_finished_func_t wait_finished =
+        (plugin_wait_finished_func_t)must_dlsym(h, "plugin_wait_finished", name, &err);
+
+    if (err) {
+        // some symbol missing
+        dlclose(h);
+        if (out_error) *out_error = err; else free(err);
+        return -1;
+    }
+
+    // store handle
+    out->init          = init;
+    out->fini          = fini;
+    out->place_work    = place_work;
+    out->attach        = attach;
+    out->wait_finished = wait_finished;
+    out->configure     = (plugin_configure_func_t)   opt_dlsym(h, "plugin_configure");
+    out->report_stats  = (plugin_report_stats_func_t)opt_dlsym(h, "plugin_report_stats");
+    out->pause         = (plugin_pause_func_t)       opt_dlsym(h, "plugin_pause");
+    out->resume        = (plugin_resume_func_t)      opt_dlsym(h, "plugin_resume");
+    out->reattach      = (plugin_reattach_func_t)    opt_dlsym(h, "plugin_reattach");
+    out->fuse          = (plugin_fuse_func_t)        opt_dlsym(h, "plugin_fuse");
+    out->set_tracer    = (plugin_set_tracer_func_t)  opt_dlsym(h, "plugin_set_tracer");
+    out->set_budget    = (plugin_set_budget_func_t)  opt_dlsym(h, "plugin_set_budget");
+    out->place_work_meta = (plugin_place_work_meta_func_t)opt_dlsym(h, "plugin_place_work_meta");
+    out->attach_meta   = (plugin_attach_meta_func_t) opt_dlsym(h, "plugin_attach_meta");
+    out->control       = (plugin_control_func_t)     opt_dlsym(h, "plugin_control");
+    out->place_work_batch = (plugin_place_work_batch_func_t)opt_dlsym(h, "plugin_place_work_batch");
+    out->attach_batch  = (plugin_attach_batch_func_t)opt_dlsym(h, "plugin_attach_batch");
+    out->set_inline    = (plugin_set_inline_func_t)  opt_dlsym(h, "plugin_set_inline");
+    out->set_latency   = (plugin_set_latency_func_t) opt_dlsym(h, "plugin_set_latency");
+    out->set_framing   = (plugin_set_framing_func_t) opt_dlsym(h, "plugin_set_framing");
+    out->sample_load   = (plugin_sample_load_func_t) opt_dlsym(h, "plugin_sample_load");
+    out->set_threads   = (plugin_set_threads_func_t) opt_dlsym(h, "plugin_set_threads");
+    out->handle        = h;
+    out->name          = dup_cstr(name);
+    if (!out->name) {
+        if (out_error) *out_error = dup_cstr("alloc failed for plugin name");
+        dlclose(h);
+        *out = (plugin_handle_t){0};
+        return -1;
+    }
+    return 0;
+}
+
+void unload_plugin(plugin_handle_t* h) {
+    if (!h) return;
+    if (h->handle) dlclose(h->handle);
+    free(h->name);
+    *h = (plugin_handle_t){0};
+}
+
 int load_all_plugins(const char* const* names, size_t count,
                      plugin_handle_t** out, char** out_error) {
     *out = NULL;
@@ -115,50 +250,7 @@ int load_all_plugins(const char* const* names, size_t count,
     }
 
     for (size_t i = 0; i < count; ++i) {
-        const char* plug = names[i];
-        char* err = NULL;
-
-        // open .so
-        void* h = open_so_candidates(plug, &err);
-        if (!h) {
-            if (!err) err = dup_cstr("dlopen failed");
-            if (out_error) *out_error = err;
-            free_partial(arr, i);
-            return -1;
-        }
-
-        // resolve required symbols exactly as in the SDK
-        plugin_init_func_t          init =
-            (plugin_init_func_t)         must_dlsym(h, "plugin_init",          plug, &err);
-        plugin_fini_func_t          fini =
-            (plugin_fini_func_t)         must_dlsym(h, "plugin_fini",          plug, &err);
-        plugin_place_work_func_t    place_work =
-            (plugin_place_work_func_t)   must_dlsym(h, "plugin_place_work",    plug, &err);
-        plugin_attach_func_t        attach =
-            (plugin_attach_func_t)       must_dlsym(h, "plugin_attach",        plug, &err);
-        plugin_wait_finished_func_t wait_finished =
-            (plugin_wait_finished_func_t)must_dlsym(h, "plugin_wait_finished", plug, &err);
-
-        if (err) {
-            // some symbol missing
-            dlclose(h);
-            if (out_error) *out_error = err;
-            free_partial(arr, i);
-            return -1;
-        }
-
-        // store handle
-        arr[i].init          = init;
-        arr[i].fini          = fini;
-        arr[i].place_work    = place_work;
-        arr[i].attach        = attach;
-        arr[i].wait_finished = wait_finished;
-        arr[i].handle        = h;
-        arr[i].name          = dup_cstr(plug);
-        if (!arr[i].name) {
-            if (out_error) *out_error = dup_cstr("alloc failed for plugin name");
-            // cleanup current and previous
-            dlclose(h);
+        if (load_plugin(names[i], 0, &arr[i], out_error) != 0) {
             free_partial(arr, i);
             return -1;
         }
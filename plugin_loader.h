@@ -7,6 +7,9 @@
 extern "C" {
 #endif
 
+struct cp_item_meta; // plugins/sync/consumer_producer.h
+struct stage_load;   // plugins/stage_load.h
+
 // function pointer signatures per the plugin SDK
 typedef const char* (*plugin_init_func_t)(int queue_size);
 typedef const char* (*plugin_fini_func_t)(void);
@@ -17,6 +20,27 @@ typedef const char* (*plugin_wait_finished_func_t)(void);
 // to check-----
 typedef const char* (*plugin_get_name_func_t)(void);
 
+// optional entry points (NULL in the handle when the plugin does not export them)
+typedef const char* (*plugin_configure_func_t)(const char* key, const char* value);
+typedef const char* (*plugin_report_stats_func_t)(void);
+typedef const char* (*plugin_pause_func_t)(void);
+typedef const char* (*plugin_resume_func_t)(void);
+typedef const char* (*plugin_reattach_func_t)(const char* (*next_place_work)(const char*));
+typedef const char* (*plugin_fuse_func_t)(const char* const* stages, size_t count);
+typedef void        (*plugin_set_tracer_func_t)(const void* hook); // const trace_hook_t*
+typedef void        (*plugin_set_budget_func_t)(void* shared, size_t queue_bytes); // mem_budget_t*
+typedef const char* (*plugin_place_work_meta_func_t)(const char* s, const struct cp_item_meta* meta);
+typedef void        (*plugin_attach_meta_func_t)(plugin_place_work_meta_func_t next);
+typedef const char* (*plugin_control_func_t)(unsigned ctl);
+typedef const char* (*plugin_place_work_batch_func_t)(const char* items, size_t count,
+                                                      const struct cp_item_meta* meta);
+typedef void        (*plugin_attach_batch_func_t)(plugin_place_work_batch_func_t next);
+typedef void        (*plugin_set_inline_func_t)(int on);
+typedef void        (*plugin_set_latency_func_t)(int on);
+typedef void        (*plugin_set_framing_func_t)(int framing);
+typedef const char* (*plugin_sample_load_func_t)(struct stage_load* out);
+typedef const char* (*plugin_set_threads_func_t)(int n);
+
 // Handle (for each loaded plugin)
 typedef struct {
     plugin_init_func_t          init; // plugin_init
@@ -24,6 +48,24 @@ typedef struct {
     plugin_place_work_func_t    place_work; // plugin_place_work
     plugin_attach_func_t        attach; //plugin_attach
     plugin_wait_finished_func_t wait_finished; //plugin_wait_finished
+    plugin_configure_func_t     configure;    // plugin_configure (optional)
+    plugin_report_stats_func_t  report_stats; // plugin_report_stats (optional)
+    plugin_pause_func_t         pause;        // plugin_pause (optional)
+    plugin_resume_func_t        resume;       // plugin_resume (optional)
+    plugin_reattach_func_t      reattach;     // plugin_reattach (optional)
+    plugin_fuse_func_t          fuse;         // plugin_fuse (optional)
+    plugin_set_tracer_func_t    set_tracer;   // plugin_set_tracer (optional)
+    plugin_set_budget_func_t    set_budget;   // plugin_set_budget (optional)
+    plugin_place_work_meta_func_t place_work_meta; // plugin_place_work_meta (optional)
+    plugin_attach_meta_func_t   attach_meta;  // plugin_attach_meta (optional)
+    plugin_control_func_t       control;      // plugin_control (optional)
+    plugin_place_work_batch_func_t place_work_batch; // plugin_place_work_batch (optional)
+    plugin_attach_batch_func_t  attach_batch; // plugin_attach_batch (optional)
+    plugin_set_inline_func_t    set_inline;   // plugin_set_inline (optional)
+    plugin_set_latency_func_t   set_latency;  // plugin_set_latency (optional)
+    plugin_set_framing_func_t   set_framing;  // plugin_set_framing (optional)
+    plugin_sample_load_func_t   sample_load;  // plugin_sample_load (optional)
+    plugin_set_threads_func_t   set_threads;  // plugin_set_threads (optional)
     char*                       name;   //  copy of argv name (without .so)
     void*                       handle; // dlopen handle (for .so.)
 } plugin_handle_t;
@@ -32,6 +74,15 @@ typedef struct {
 int load_all_plugins(const char* const* names, size_t count,
                      plugin_handle_t** out, char** out_error);
 
+// Load one plugin by name into *out. With fresh_copy set, the .so is loaded
+// from a private temp copy so a rebuilt file is picked up even while the
+// previous build of the same plugin is still loaded.
+// On failure returns -1 and writes a heap-allocated message to *out_error.
+int load_plugin(const char* name, int fresh_copy, plugin_handle_t* out, char** out_error);
+
+// dlclose one handle and free its name (safe on an empty handle)
+void unload_plugin(plugin_handle_t* h);
+
 // Unloads all plugins and frees plugin_handle_t array and names (safe on NULL).
 void unload_all_plugins(plugin_handle_t* arr, size_t count);
 
@@ -1,4 +1,6 @@
 #include "plugin_runtime.h"
+#include "trace.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -12,6 +14,186 @@ static char* dup_cstr(const char* s) {
     return p;
 }
 
+// Build "<prefix>: <detail>" on the heap
+static char* fmt_error(const char* prefix, const char* detail) {
+    size_t need = strlen(prefix) + strlen(": ") + strlen(detail) + 1;
+    char* p = (char*)malloc(need);
+    if (!p) return NULL;
+    snprintf(p, need, "%s: %s", prefix, detail);
+    return p;
+}
+
+// memory limits handed to every stage before init (see runtime_set_memory)
+static mem_budget_t* g_shared_budget;
+static size_t g_queue_bytes;
+
+void runtime_set_memory(mem_budget_t* shared, size_t queue_bytes) {
+    g_shared_budget = shared;
+    g_queue_bytes   = queue_bytes;
+}
+
+// engine handed to every stage before init (see runtime_set_inline)
+static int g_inline;
+
+void runtime_set_inline(int on) {
+    g_inline = on;
+}
+
+// direct handoff handed to every stage before init (see runtime_set_latency)
+static int g_latency;
+
+void runtime_set_latency(int on) {
+    g_latency = on;
+}
+
+// output framing handed to every stage before init (see runtime_set_framing)
+static int g_framing;
+
+void runtime_set_framing(int framing) {
+    g_framing = framing;
+}
+
+// Pass host-wide settings (tracer, memory limits, engine, latency mode,
+// framing) to a stage about to init
+// Returns NULL, or an error when the stage cannot run on the selected engine
+static const char* prepare_stage(plugin_handle_t* h) {
+    if (h->set_tracer && trace_hook()) h->set_tracer(trace_hook());
+    if (h->set_budget) h->set_budget(g_shared_budget, g_queue_bytes);
+    if (h->set_inline) h->set_inline(g_inline);
+    else if (g_inline) return "plugin cannot run on the inline engine";
+    if (h->set_latency) h->set_latency(g_latency); // without it the stage always queues
+    if (h->set_framing) h->set_framing(g_framing);
+    return NULL;
+}
+
+// Point from at to (NULL: end of chain), with metadata and batches when both
+// sides take them. For a live stage, from must be paused (reattach).
+static void link_meta(plugin_handle_t* from, const plugin_handle_t* to) {
+    if (from->attach_meta) from->attach_meta(to ? to->place_work_meta : NULL);
+    if (from->attach_batch) from->attach_batch(to ? to->place_work_batch : NULL);
+}
+
+// Apply one "k=v,k=v" option string to a single plugin.
+// Returns NULL on success, or a heap-allocated error message.
+static char* configure_one(plugin_handle_t* h, const char* spec) {
+    // scratch copy we can unescape and split in place
+    char* buf = dup_cstr(spec);
+    if (!buf) return dup_cstr("alloc failed for options");
+
+    char* err = NULL;
+    char* r = buf;
+    while (*r && !err) {
+        // unescape one item up to the next unescaped ','
+        char* item = r;
+        char* w = r;
+        while (*r && *r != ',') {
+            // only \, and \\ are escapes, so values such as regexes keep
+            // their other backslashes
+            if (*r == '\\' && (r[1] == ',' || r[1] == '\\')) r++;
+            *w++ = *r++;
+        }
+        if (*r == ',') r++;
+        *w = '\0';
+        if (*item == '\0') continue; // tolerate empty items ("a=1,,b=2")
+
+        char* eq = strchr(item, '=');
+        if (!eq || eq == item) {
+            err = fmt_error("malformed option (want key=value)", item);
+            break;
+        }
+        *eq = '\0';
+        if (!h->configure) {
+            err = dup_cstr("plugin does not accept options");
+            break;
+        }
+        const char* cerr = h->configure(item, eq + 1);
+        if (cerr) err = fmt_error(item, cerr);
+    }
+    free(buf);
+    return err;
+}
+
+// Stage names recognized by the chain compiler
+static int is_fusable(const plugin_handle_t* h, const char* options) {
+    static const char* const k_fusable[] = { "rotator", "flipper", "expander", "uppercaser" };
+    if (!h->fuse || !h->name || (options && *options)) return 0;
+    for (size_t i = 0; i < sizeof(k_fusable) / sizeof(k_fusable[0]); ++i) {
+        if (strcmp(h->name, k_fusable[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+void fuse_chain(plugin_handle_t* arr, size_t* count, const char** options) {
+    if (!arr || !count) return;
+
+    size_t out = 0;
+    size_t i = 0;
+    while (i < *count) {
+        size_t j = i;
+        while (j < *count && is_fusable(&arr[j], options ? options[j] : NULL)) ++j;
+
+        size_t run = j - i;
+        if (run >= 2) {
+            const char* names[16];
+            if (run > sizeof(names) / sizeof(names[0])) run = sizeof(names) / sizeof(names[0]);
+            j = i + run;
+            for (size_t t = 0; t < run; ++t) names[t] = arr[i + t].name;
+
+            if (arr[i].fuse(names, run) == NULL) {
+                // the host takes the run's combined name
+                size_t need = 0;
+                for (size_t t = 0; t < run; ++t) need += strlen(names[t]) + 1;
+                char* combined = (char*)malloc(need);
+                if (combined) {
+                    combined[0] = '\0';
+                    for (size_t t = 0; t < run; ++t) {
+                        if (t) strcat(combined, "+");
+                        strcat(combined, names[t]);
+                    }
+                    free(arr[i].name);
+                    arr[i].name = combined;
+                }
+                for (size_t t = i + 1; t < j; ++t) unload_plugin(&arr[t]);
+
+                arr[out] = arr[i];
+                if (options) options[out] = options[i];
+                ++out;
+                i = j;
+                continue;
+            }
+        }
+
+        // not fused: keep stage i as it is
+        if (j == i) j = i + 1;
+        for (size_t t = i; t < j; ++t) {
+            arr[out] = arr[t];
+            if (options) options[out] = options[t];
+            ++out;
+        }
+        i = j;
+    }
+    *count = out;
+}
+
+int configure_all_plugins(plugin_handle_t* arr, size_t count, const char* const* options,
+                          size_t* failed_index, char** failed_msg) {
+    if (failed_index) *failed_index = (size_t)-1;
+    if (failed_msg)   *failed_msg   = NULL;
+    if (!arr || !options) return 0; // nothing to do
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!options[i] || !*options[i]) continue;
+        char* err = configure_one(&arr[i], options[i]);
+        if (err) {
+            if (failed_index) *failed_index = i;
+            if (failed_msg)   *failed_msg   = err;
+            else              free(err);
+            return -1;
+        }
+    }
+    return 0;
+}
+
 int init_all_plugins(plugin_handle_t* arr, size_t count, int queue_size,
                      size_t* failed_index, char** failed_msg) {
     if (failed_index) *failed_index = (size_t)-1;
@@ -19,7 +201,8 @@ int init_all_plugins(plugin_handle_t* arr, size_t count, int queue_size,
     if (!arr || count == 0) return 0; // nothing to do
 
     for (size_t i = 0; i < count; ++i) {
-        const char* err = arr[i].init ? arr[i].init(queue_size) : "missing init()";
+        const char* err = prepare_stage(&arr[i]);
+        if (!err) err = arr[i].init ? arr[i].init(queue_size) : "missing init()";
         if (err != NULL) {
             if (failed_index) *failed_index = i;
             if (failed_msg)   *failed_msg   = dup_cstr(err ? err : "init failed");
@@ -63,6 +246,228 @@ int attach_chain(plugin_handle_t* arr, size_t count,
         }
         // connect i => i+1
         arr[i].attach(arr[i + 1].place_work);
+        link_meta(&arr[i], &arr[i + 1]);
     }
     return 0;
-}
\ No newline at end of file
+}
+
+int pipeline_init(pipeline_t* pl, plugin_handle_t* plugs, size_t count, int queue_size) {
+    if (!pl) return -1;
+    pl->plugs      = plugs;
+    pl->count      = count;
+    pl->queue_size = queue_size;
+    pl->closed     = 0;
+    if (pthread_mutex_init(&pl->lock, NULL) != 0) return -1;
+    if (pthread_mutex_init(&pl->ctl_lock, NULL) != 0) {
+        pthread_mutex_destroy(&pl->lock);
+        return -1;
+    }
+    return 0;
+}
+
+void pipeline_destroy(pipeline_t* pl) {
+    if (!pl) return;
+    pthread_mutex_destroy(&pl->ctl_lock);
+    pthread_mutex_destroy(&pl->lock);
+}
+
+const char* pipeline_place_work(pipeline_t* pl, const char* s) {
+    pthread_mutex_lock(&pl->lock);
+    trace_begin_item();
+    const char* err = pl->closed ? "pipeline closed" : pl->plugs[0].place_work(s);
+    pthread_mutex_unlock(&pl->lock);
+    return err;
+}
+
+const char* pipeline_place_work_meta(pipeline_t* pl, const char* s, const cp_item_meta_t* meta) {
+    pthread_mutex_lock(&pl->lock);
+    trace_begin_item();
+    const char* err = pl->closed                 ? "pipeline closed"
+                    : pl->plugs[0].place_work_meta ? pl->plugs[0].place_work_meta(s, meta)
+                    : pl->plugs[0].place_work(s);
+    pthread_mutex_unlock(&pl->lock);
+    return err;
+}
+
+const char* pipeline_finish(pipeline_t* pl) {
+    pthread_mutex_lock(&pl->lock);
+    const char* err = pl->closed ? "pipeline closed" : pl->plugs[0].place_work("<END>");
+    pl->closed = 1;
+    pthread_mutex_unlock(&pl->lock);
+    return err;
+}
+
+void pipeline_post_control(pipeline_t* pl, unsigned ctl) {
+    pthread_mutex_lock(&pl->ctl_lock);
+    for (size_t i = 0; i < pl->count; ++i) {
+        if (pl->plugs[i].control) (void)pl->plugs[i].control(ctl);
+    }
+    pthread_mutex_unlock(&pl->ctl_lock);
+}
+
+static size_t find_stage(const pipeline_t* pl, const char* name) {
+    for (size_t i = 0; i < pl->count; ++i) {
+        if (pl->plugs[i].name && strcmp(pl->plugs[i].name, name) == 0) return i;
+    }
+    return (size_t)-1;
+}
+
+// Load, configure and init a stage from "name[:options]" (caller holds pl->lock)
+static int start_stage(pipeline_t* pl, const char* spec, plugin_handle_t* out, char** failed_msg) {
+    char* name = dup_cstr(spec);
+    if (!name) { *failed_msg = dup_cstr("alloc failed"); return -1; }
+    char* opts = strchr(name, ':');
+    if (opts) *opts++ = '\0';
+
+    if (*name == '\0') {
+        *failed_msg = dup_cstr("invalid plugin name");
+        free(name);
+        return -1;
+    }
+    if (find_stage(pl, name) != (size_t)-1) {
+        *failed_msg = fmt_error("plugin already in the pipeline", name);
+        free(name);
+        return -1;
+    }
+    if (load_plugin(name, 1, out, failed_msg) != 0) {
+        free(name);
+        return -1;
+    }
+    free(name);
+
+    char* err = (opts && *opts) ? configure_one(out, opts) : NULL;
+    if (!err) {
+        const char* ierr = prepare_stage(out);
+        if (!ierr) ierr = out->init ? out->init(pl->queue_size) : "missing init()";
+        if (ierr) err = fmt_error("init failed", ierr);
+    }
+    if (err) {
+        *failed_msg = err;
+        unload_plugin(out);
+        return -1;
+    }
+    return 0;
+}
+
+// The upstream of stage k must support pause/reattach (stage 0 is fed by
+// pipeline_place_work, which the caller already holds off via pl->lock)
+static int check_upstream(const pipeline_t* pl, size_t k, char** failed_msg) {
+    if (k == 0) return 0;
+    const plugin_handle_t* up = &pl->plugs[k - 1];
+    if (!up->pause || !up->resume || !up->reattach) {
+        *failed_msg = fmt_error("upstream stage does not support live rewiring", up->name);
+        return -1;
+    }
+    return 0;
+}
+
+// Point the (paused) upstream of stage k at next (NULL: end of chain) and let it run again
+static void rewire_upstream(pipeline_t* pl, size_t k, const plugin_handle_t* next) {
+    if (k == 0) return;
+    (void)pl->plugs[k - 1].reattach(next ? next->place_work : NULL);
+    link_meta(&pl->plugs[k - 1], next);
+    (void)pl->plugs[k - 1].resume();
+}
+
+int pipeline_insert_stage(pipeline_t* pl, size_t pos, const char* spec, char** failed_msg) {
+    *failed_msg = NULL;
+    pthread_mutex_lock(&pl->lock);
+    pthread_mutex_lock(&pl->ctl_lock);
+
+    int rc = -1;
+    plugin_handle_t nw;
+    if (pl->closed) {
+        *failed_msg = dup_cstr("pipeline closed");
+    } else if (pos > pl->count) {
+        *failed_msg = dup_cstr("position out of range");
+    } else if (check_upstream(pl, pos, failed_msg) == 0 && start_stage(pl, spec, &nw, failed_msg) == 0) {
+        plugin_handle_t* grown = (plugin_handle_t*)realloc(pl->plugs, (pl->count + 1) * sizeof(*grown));
+        if (!grown) {
+            *failed_msg = dup_cstr("alloc failed for plugin handles");
+            (void)nw.fini();
+            unload_plugin(&nw);
+        } else {
+            pl->plugs = grown;
+            if (pos < pl->count) {
+                nw.attach(pl->plugs[pos].place_work);
+                link_meta(&nw, &pl->plugs[pos]);
+            }
+            if (pos > 0) (void)pl->plugs[pos - 1].pause();
+            rewire_upstream(pl, pos, &nw);
+            memmove(&pl->plugs[pos + 1], &pl->plugs[pos], (pl->count - pos) * sizeof(*pl->plugs));
+            pl->plugs[pos] = nw;
+            pl->count++;
+            rc = 0;
+        }
+    }
+
+    pthread_mutex_unlock(&pl->ctl_lock);
+    pthread_mutex_unlock(&pl->lock);
+    return rc;
+}
+
+int pipeline_swap_stage(pipeline_t* pl, const char* name, const char* spec, char** failed_msg) {
+    *failed_msg = NULL;
+    pthread_mutex_lock(&pl->lock);
+    pthread_mutex_lock(&pl->ctl_lock);
+
+    int rc = -1;
+    size_t k = pl->closed ? (size_t)-1 : find_stage(pl, name);
+    plugin_handle_t nw;
+    if (pl->closed) {
+        *failed_msg = dup_cstr("pipeline closed");
+    } else if (k == (size_t)-1) {
+        *failed_msg = fmt_error("no such stage", name);
+    } else if (check_upstream(pl, k, failed_msg) == 0) {
+        // take the old stage out of name lookups so spec may reuse its name
+        plugin_handle_t old = pl->plugs[k];
+        pl->plugs[k].name = NULL;
+        int started = start_stage(pl, spec, &nw, failed_msg);
+        pl->plugs[k].name = old.name;
+
+        if (started == 0) {
+            if (k + 1 < pl->count) {
+                nw.attach(pl->plugs[k + 1].place_work);
+                link_meta(&nw, &pl->plugs[k + 1]);
+            }
+            if (k > 0) (void)pl->plugs[k - 1].pause();
+            (void)old.fini(); // drains the old queue into the successor
+            rewire_upstream(pl, k, &nw);
+            pl->plugs[k] = nw;
+            unload_plugin(&old);
+            rc = 0;
+        }
+    }
+
+    pthread_mutex_unlock(&pl->ctl_lock);
+    pthread_mutex_unlock(&pl->lock);
+    return rc;
+}
+
+int pipeline_remove_stage(pipeline_t* pl, const char* name, char** failed_msg) {
+    *failed_msg = NULL;
+    pthread_mutex_lock(&pl->lock);
+    pthread_mutex_lock(&pl->ctl_lock);
+
+    int rc = -1;
+    size_t k = pl->closed ? (size_t)-1 : find_stage(pl, name);
+    if (pl->closed) {
+        *failed_msg = dup_cstr("pipeline closed");
+    } else if (k == (size_t)-1) {
+        *failed_msg = fmt_error("no such stage", name);
+    } else if (pl->count == 1) {
+        *failed_msg = dup_cstr("cannot remove the only stage");
+    } else if (check_upstream(pl, k, failed_msg) == 0) {
+        if (k > 0) (void)pl->plugs[k - 1].pause();
+        (void)pl->plugs[k].fini(); // drains into the successor
+        rewire_upstream(pl, k, (k + 1 < pl->count) ? &pl->plugs[k + 1] : NULL);
+        unload_plugin(&pl->plugs[k]);
+        memmove(&pl->plugs[k], &pl->plugs[k + 1], (pl->count - k - 1) * sizeof(*pl->plugs));
+        pl->count--;
+        rc = 0;
+    }
+
+    pthread_mutex_unlock(&pl->ctl_lock);
+    pthread_mutex_unlock(&pl->lock);
+    return rc;
+}
@@ -2,8 +2,55 @@
 #define PLUGIN_RUNTIME_H
 
 #include <stddef.h>
+#include <pthread.h>
 #include "plugin_loader.h"
+#include "plugins/sync/consumer_producer.h" // cp_item_meta_t
 
+// A running chain that can be rewired while data flows
+typedef struct {
+    plugin_handle_t* plugs;  // stages in chain order (owned)
+    size_t count;            // number of stages
+    int queue_size;          // capacity used for stages started later
+    pthread_mutex_t lock;    // serializes rewiring with ingestion into stage 0
+    pthread_mutex_t ctl_lock; // guards plugs/count for control requests, which must not
+                              // wait behind ingestion blocked on a full stage 0
+    int closed;              // <END> was sent, the chain is frozen
+} pipeline_t;
+
+
+// planning step: collapse each run of adjacent built-in permutation / byte-map
+// stages (rotator, flipper, expander, uppercaser) without stage options into
+// its first stage, which then runs one composed kernel. The other stages of
+// the run are unloaded; arr and options are compacted in place and *count is
+// updated. Runs the plugins refuse to fuse are left as they are.
+void fuse_chain(plugin_handle_t* arr, size_t* count, const char** options);
+
+// pass per-stage options to plugins before init
+// options[i]: "key=value,key=value" for plugin i, or NULL (a literal ',' or '\\'
+// inside a value is escaped with a backslash)
+// On success: return 0
+// On failure: return -1, set *failed_index to the plugin that rejected an option,
+// and *failed_msg to a heap-allocated error string (caller frees)
+int configure_all_plugins(plugin_handle_t* arr, size_t count, const char* const* options,
+                          size_t* failed_index, char** failed_msg);
+
+// memory limits for stages initialized from now on: shared is charged by every
+// stage's queue (NULL for none), queue_bytes is the per-queue byte budget for
+// stages without a budget= option (0 for none)
+void runtime_set_memory(mem_budget_t* shared, size_t queue_bytes);
+
+// engine for stages initialized from now on: 0 = one consumer thread per
+// stage (default), 1 = inline, every stage runs on the thread that feeds the
+// chain (stages must export plugin_set_inline)
+void runtime_set_inline(int on);
+
+// direct handoff for stages initialized from now on: a stage whose queue is
+// empty and whose thread is idle is run by its producer (see plugin_set_latency)
+void runtime_set_latency(int on);
+
+// record framing sinks write in for stages initialized from now on
+// (PLUGIN_FRAMING_*, see plugin_set_framing)
+void runtime_set_framing(int framing);
 
 // init plugins from left to right
 // queue_size: size for per-plugin queues (if used)
@@ -23,4 +70,45 @@ void fini_prefix(plugin_handle_t* arr, size_t upto);
 int attach_chain(plugin_handle_t* arr, size_t count,
                  size_t* failed_index, char** failed_msg);
 
+// take ownership of an initialized and attached chain
+// On success: return 0; on failure: return -1
+int pipeline_init(pipeline_t* pl, plugin_handle_t* plugs, size_t count, int queue_size);
+
+// release the lock (the stages themselves are finalized by the caller)
+void pipeline_destroy(pipeline_t* pl);
+
+// feed one string into the first stage
+// Returns NULL on success, error message on failure
+const char* pipeline_place_work(pipeline_t* pl, const char* s);
+
+// feed one string with metadata (e.g. a record fragment) into the first stage;
+// meta is dropped if the stage does not take metadata
+// Returns NULL on success, error message on failure
+const char* pipeline_place_work_meta(pipeline_t* pl, const char* s, const cp_item_meta_t* meta);
+
+// send <END> into the first stage and freeze the chain
+// Returns NULL on success, error message on failure
+const char* pipeline_finish(pipeline_t* pl);
+
+// post CP_CTL_* requests on every stage's control lane (stages without
+// plugin_control are skipped); never waits for queued data
+void pipeline_post_control(pipeline_t* pl, unsigned ctl);
+
+// Live rewiring. The stage upstream of the change is paused at its queue
+// boundary (ingestion is held for stage 0), a replaced or removed stage is
+// drained into its successor, and flow resumes. New stages are loaded from a
+// fresh copy of their .so, so a rebuilt plugin is picked up.
+// spec is "name" or "name:key=value,...".
+// On success: return 0
+// On failure: return -1 and set *failed_msg to a heap-allocated error string (caller frees)
+
+// start spec and insert it before position pos (pos == count appends)
+int pipeline_insert_stage(pipeline_t* pl, size_t pos, const char* spec, char** failed_msg);
+
+// replace the stage called name with a new instance of spec
+int pipeline_swap_stage(pipeline_t* pl, const char* name, const char* spec, char** failed_msg);
+
+// drain and remove the stage called name
+int pipeline_remove_stage(pipeline_t* pl, const char* name, char** failed_msg);
+
 #endif // PLUGIN_RUNTIME_H
@@ -0,0 +1,454 @@
+#include "plugin_common.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Consumes records and emits only summaries: item count, distinct keys and
+// the most frequent keys, in constant memory whatever the stream size.
+// - distinct count: HyperLogLog, 2^14 registers (about 0.8% standard error)
+// - top-K: Count-Min sketch (4 x 4096 counters, estimates never undercount)
+//   feeding a min-heap of the K heaviest keys seen
+// - exact counts while the stream has at most exact=N distinct keys, after
+//   which the table is dropped and the sketches take over
+// A key is the whole record, or field=N (1-based) split on sep=STR.
+// Summaries are emitted from the record path only: every=N records, the first
+// record once interval=T has elapsed, and <END>. A stream that goes quiet gets
+// no summary until its next record.
+
+#define AGG_HLL_BITS   14
+#define AGG_HLL_REGS   (1u << AGG_HLL_BITS)
+#define AGG_CM_DEPTH   4
+#define AGG_CM_WIDTH   4096
+#define AGG_KEY_MAX    64    // top-K keys are kept (and shown) truncated to this
+#define AGG_TOPK_MAX   1000
+#define AGG_EXACT_MAX  4096
+
+typedef struct
+{
+    uint64_t hash;
+    uint64_t count;
+    char key[AGG_KEY_MAX + 1];
+} agg_top_t;
+
+typedef struct
+{
+    uint64_t hash;
+    uint64_t count;
+    char* key;   // NULL = free slot
+} agg_exact_t;
+
+static uint8_t  g_hll[AGG_HLL_REGS];
+static uint32_t g_cm[AGG_CM_DEPTH][AGG_CM_WIDTH];
+static agg_top_t* g_top;           // min-heap on count
+static int g_top_n;
+static int g_topk = 10;
+static agg_exact_t* g_exact;       // open addressing, NULL once exceeded
+static int g_exact_cap;
+static int g_exact_n;
+static int g_exact_max = 64;
+
+static uint64_t g_items;           // records seen since the last reset
+static uint64_t g_missing;         // records without the selected field
+static uint64_t g_since_summary;   // records since the last summary
+static uint64_t g_summaries;       // summaries emitted so far
+
+static int      g_field;           // 0 = whole record
+static char     g_sep[64] = " ";
+static size_t   g_sep_len = 1;
+static uint64_t g_every;           // summary every N records, 0 = off
+static uint64_t g_interval_ns;     // summary on the first record after T, 0 = off
+static uint64_t g_last_ns;
+static int      g_reset;           // start over after each summary (tumbling windows)
+
+static char*  g_line;              // summary being built
+static size_t g_line_len;
+static size_t g_line_cap;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ---------------------------------------------------------------- sketches
+
+static void hll_add(uint64_t h) {
+    unsigned idx = (unsigned)(h >> (64 - AGG_HLL_BITS));
+    uint64_t rest = (h << AGG_HLL_BITS) | (1ull << (AGG_HLL_BITS - 1)); // guard bit bounds the rank
+    uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+    if (rank > g_hll[idx]) g_hll[idx] = rank;
+}
+
+static uint64_t hll_estimate(void) {
+    const double m = (double)AGG_HLL_REGS;
+    double sum = 0.0;
+    unsigned zeros = 0;
+    for (unsigned i = 0; i < AGG_HLL_REGS; ++i) {
+        sum += ldexp(1.0, -(int)g_hll[i]);
+        zeros += (g_hll[i] == 0);
+    }
+    double e = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    if (e <= 2.5 * m && zeros) e = m * log(m / (double)zeros); // small range: linear counting
+    return (uint64_t)(e + 0.5);
+}
+
+// Add one occurrence, return the new (over)estimate
+static uint64_t cm_add(uint64_t h) {
+    uint32_t h1 = (uint32_t)h, h2 = (uint32_t)(h >> 32) | 1u;
+    uint32_t est = UINT32_MAX;
+    for (unsigned r = 0; r < AGG_CM_DEPTH; ++r) {
+        uint32_t* c = &g_cm[r][(h1 + r * h2) % AGG_CM_WIDTH];
+        if (*c < UINT32_MAX) (*c)++;
+        if (*c < est) est = *c;
+    }
+    return est;
+}
+
+static void heap_swap(int a, int b) {
+    agg_top_t t = g_top[a];
+    g_top[a] = g_top[b];
+    g_top[b] = t;
+}
+
+static void heap_down(int i) {
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < g_top_n && g_top[l].count < g_top[m].count) m = l;
+        if (r < g_top_n && g_top[r].count < g_top[m].count) m = r;
+        if (m == i) return;
+        heap_swap(i, m);
+        i = m;
+    }
+}
+
+static void heap_up(int i) {
+    while (i > 0 && g_top[(i - 1) / 2].count > g_top[i].count) {
+        heap_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void top_set_key(agg_top_t* t, const char* key, size_t len) {
+    if (len > AGG_KEY_MAX) len = AGG_KEY_MAX;
+    memcpy(t->key, key, len);
+    t->key[len] = '\0';
+}
+
+static void top_offer(uint64_t h, uint64_t est, const char* key, size_t len) {
+    for (int i = 0; i < g_top_n; ++i) {
+        if (g_top[i].hash == h) { // counts only grow: restore the min-heap downwards
+            g_top[i].count = est;
+            heap_down(i);
+            return;
+        }
+    }
+    if (g_top_n < g_topk) {
+        agg_top_t* t = &g_top[g_top_n];
+        t->hash = h;
+        t->count = est;
+        top_set_key(t, key, len);
+        heap_up(g_top_n++);
+    } else if (est > g_top[0].count) { // heavier than the lightest kept key
+        g_top[0].hash = h;
+        g_top[0].count = est;
+        top_set_key(&g_top[0], key, len);
+        heap_down(0);
+    }
+}
+
+static void exact_free(void) {
+    if (!g_exact) return;
+    for (int i = 0; i < g_exact_cap; ++i) free(g_exact[i].key);
+    free(g_exact);
+    g_exact = NULL;
+    g_exact_n = 0;
+}
+
+static int exact_alloc(void) {
+    if (g_exact_max == 0) return 0;
+    g_exact_cap = 16;
+    while (g_exact_cap < 2 * g_exact_max) g_exact_cap *= 2; // load factor <= 0.5
+    g_exact = (agg_exact_t*)calloc((size_t)g_exact_cap, sizeof(*g_exact));
+    g_exact_n = 0;
+    return g_exact ? 0 : -1;
+}
+
+static void exact_add(uint64_t h, const char* key, size_t len) {
+    unsigned mask = (unsigned)g_exact_cap - 1;
+    for (unsigned i = (unsigned)h & mask;; i = (i + 1) & mask) {
+        agg_exact_t* e = &g_exact[i];
+        if (!e->key) {
+            char* copy = (g_exact_n < g_exact_max) ? (char*)malloc(len + 1) : NULL;
+            if (!copy) { // too many distinct keys (or no memory): sketches only from now on
+                exact_free();
+                return;
+            }
+            memcpy(copy, key, len);
+            copy[len] = '\0';
+            e->hash = h;
+            e->count = 1;
+            e->key = copy;
+            g_exact_n++;
+            return;
+        }
+        if (e->hash == h && strlen(e->key) == len && memcmp(e->key, key, len) == 0) {
+            e->count++;
+            return;
+        }
+    }
+}
+
+static void reset_state(void) {
+    memset(g_hll, 0, sizeof(g_hll));
+    memset(g_cm, 0, sizeof(g_cm));
+    g_top_n = 0;
+    exact_free();
+    (void)exact_alloc(); // on failure the window simply has no exact counts
+    g_items = 0;
+    g_missing = 0;
+}
+
+// ---------------------------------------------------------------- summary
+
+static int line_reserve(size_t more) {
+    if (g_line_len + more + 1 <= g_line_cap) return 0;
+    size_t cap = g_line_cap ? g_line_cap : 1024;
+    while (cap < g_line_len + more + 1) cap *= 2;
+    char* p = (char*)realloc(g_line, cap);
+    if (!p) return -1;
+    g_line = p;
+    g_line_cap = cap;
+    return 0;
+}
+
+static int line_append(const char* s) {
+    size_t n = strlen(s);
+    if (line_reserve(n) != 0) return -1;
+    memcpy(g_line + g_line_len, s, n);
+    g_line_len += n;
+    return 0;
+}
+
+static int line_printf(const char* fmt, uint64_t v) {
+    char tmp[64];
+    int n = snprintf(tmp, sizeof(tmp), fmt, v);
+    if (n < 0 || line_reserve((size_t)n) != 0) return -1;
+    memcpy(g_line + g_line_len, tmp, (size_t)n);
+    g_line_len += (size_t)n;
+    return 0;
+}
+
+static int line_json_string(const char* s) {
+    if (line_reserve(strlen(s) * 6 + 2) != 0) return -1;
+    char* w = g_line + g_line_len;
+    *w++ = '"';
+    for (const unsigned char* p = (const unsigned char*)s; *p; ++p) {
+        if (*p == '"' || *p == '\\') {
+            *w++ = '\\';
+            *w++ = (char)*p;
+        } else if (*p < 0x20) {
+            w += sprintf(w, "\\u%04x", *p);
+        } else {
+            *w++ = (char)*p;
+        }
+    }
+    *w++ = '"';
+    g_line_len = (size_t)(w - g_line);
+    return 0;
+}
+
+static int cmp_top_desc(const void* a, const void* b) {
+    uint64_t x = ((const agg_top_t*)a)->count, y = ((const agg_top_t*)b)->count;
+    return (x < y) - (x > y);
+}
+
+static int cmp_exact_desc(const void* a, const void* b) {
+    const agg_exact_t* x = *(const agg_exact_t* const*)a;
+    const agg_exact_t* y = *(const agg_exact_t* const*)b;
+    if (x->count != y->count) return (x->count < y->count) - (x->count > y->count);
+    return strcmp(x->key, y->key);
+}
+
+// One JSON line: {"items":N,"missing":N,"distinct":N,"exact":bool,"top":[["key",count],...]}
+// With exact counts the top lists every key, otherwise the K heaviest with
+// Count-Min estimates.
+static const char* emit_summary(plugin_emitter_t* out) {
+    g_line_len = 0;
+    int exact = (g_exact != NULL);
+    int rc = line_printf("{\"items\":%" PRIu64, g_items);
+    rc |= line_printf(",\"missing\":%" PRIu64, g_missing);
+    rc |= line_printf(",\"distinct\":%" PRIu64, exact ? (uint64_t)g_exact_n : hll_estimate());
+    rc |= line_append(exact ? ",\"exact\":true,\"top\":[" : ",\"exact\":false,\"top\":[");
+
+    if (exact) {
+        agg_exact_t** order = (agg_exact_t**)malloc((size_t)(g_exact_n ? g_exact_n : 1) * sizeof(*order));
+        if (!order) return "alloc failed for summary";
+        int n = 0;
+        for (int i = 0; i < g_exact_cap; ++i) if (g_exact[i].key) order[n++] = &g_exact[i];
+        qsort(order, (size_t)n, sizeof(*order), cmp_exact_desc);
+        for (int i = 0; i < n && rc == 0; ++i) {
+            rc |= line_append(i ? ",[" : "[");
+            rc |= line_json_string(order[i]->key);
+            rc |= line_printf(",%" PRIu64 "]", order[i]->count);
+        }
+        free(order);
+    } else {
+        agg_top_t* sorted = (agg_top_t*)malloc((size_t)(g_top_n ? g_top_n : 1) * sizeof(*sorted));
+        if (!sorted) return "alloc failed for summary";
+        memcpy(sorted, g_top, (size_t)g_top_n * sizeof(*sorted));
+        qsort(sorted, (size_t)g_top_n, sizeof(*sorted), cmp_top_desc);
+        for (int i = 0; i < g_top_n && rc == 0; ++i) {
+            rc |= line_append(i ? ",[" : "[");
+            rc |= line_json_string(sorted[i].key);
+            rc |= line_printf(",%" PRIu64 "]", sorted[i].count);
+        }
+        free(sorted);
+    }
+    rc |= line_append("]}");
+    if (rc != 0) return "alloc failed for summary";
+
+    g_since_summary = 0;
+    g_summaries++;
+    if (g_interval_ns) g_last_ns = now_ns();
+    const char* err = common_plugin_emit(out, g_line, g_line_len);
+    if (g_reset) reset_state();
+    return err;
+}
+
+// ---------------------------------------------------------------- plugin
+
+static void release(void) {
+    exact_free();
+    free(g_top);
+    g_top = NULL;
+    free(g_line);
+    g_line = NULL;
+    g_line_len = g_line_cap = 0;
+}
+
+// Key of a record: the whole record or its selected field (*len set), NULL if missing
+static const char* select_key(const char* s, size_t* len) {
+    if (g_field == 0) {
+        *len = strlen(s);
+        return s;
+    }
+    for (int f = 1;; ++f) {
+        const char* hit = strstr(s, g_sep);
+        if (f == g_field) {
+            *len = hit ? (size_t)(hit - s) : strlen(s);
+            return s;
+        }
+        if (!hit) return NULL;
+        s = hit + g_sep_len;
+    }
+}
+
+const char* plugin_aggregate(const char* input, plugin_emitter_t* out) {
+    if (!input) { // <END>: the final summary, unless nothing happened since the last one
+        const char* err = (g_since_summary || g_summaries == 0) ? emit_summary(out) : NULL;
+        release();
+        return err;
+    }
+
+    g_items++;
+    g_since_summary++;
+    size_t len = 0;
+    const char* key = select_key(input, &len);
+    if (!key) {
+        g_missing++;
+    } else {
+        uint64_t h = memo_hash(key, len);
+        hll_add(h);
+        top_offer(h, cm_add(h), key, len);
+        if (g_exact) exact_add(h, key, len);
+    }
+
+    // interval is checked here only: no timer drives this stage between records
+    if ((g_every && g_since_summary >= g_every) || (g_interval_ns && now_ns() - g_last_ns >= g_interval_ns)) {
+        return emit_summary(out);
+    }
+    return NULL;
+}
+
+static int parse_count(const char* v, unsigned long max, unsigned long* out) {
+    char* endp = NULL;
+    errno = 0;
+    unsigned long n = strtoul(v, &endp, 10);
+    if (endp == v || *endp != '\0' || errno == ERANGE || v[0] == '-' || n > max) return -1;
+    *out = n;
+    return 0;
+}
+
+const char* plugin_init(int queue_size) {
+    const char* field    = common_plugin_option("field");
+    const char* sep      = common_plugin_option("sep");
+    const char* topk     = common_plugin_option("topk");
+    const char* exact    = common_plugin_option("exact");
+    const char* every    = common_plugin_option("every");
+    const char* interval = common_plugin_option("interval");
+    const char* reset    = common_plugin_option("reset");
+    unsigned long v = 0;
+
+    release();
+    g_field = 0;
+    g_topk = 10;
+    g_exact_max = 64;
+    g_every = 0;
+    g_interval_ns = 0;
+    g_reset = 0;
+    memcpy(g_sep, " ", 2);
+    g_sep_len = 1;
+    if (field) {
+        if (parse_count(field, 1024, &v) != 0 || v == 0) return "invalid field (1-based)";
+        g_field = (int)v;
+    }
+    if (sep) {
+        size_t n = strlen(sep);
+        if (n == 0 || n >= sizeof(g_sep)) return "invalid sep";
+        memcpy(g_sep, sep, n + 1);
+        g_sep_len = n;
+    }
+    if (topk) {
+        if (parse_count(topk, AGG_TOPK_MAX, &v) != 0 || v == 0) return "invalid topk";
+        g_topk = (int)v;
+    }
+    if (exact) {
+        if (parse_count(exact, AGG_EXACT_MAX, &v) != 0) return "invalid exact";
+        g_exact_max = (int)v;
+    }
+    if (every) {
+        if (parse_count(every, ULONG_MAX, &v) != 0) return "invalid every";
+        g_every = v;
+    }
+    if (interval) {
+        char* endp = NULL;
+        double sec = strtod(interval, &endp);
+        if (endp == interval || *endp != '\0' || !(sec > 0.0) || sec > 86400.0) return "invalid interval";
+        g_interval_ns = (uint64_t)(sec * 1e9);
+    }
+    if (reset) {
+        if (strcmp(reset, "1") == 0)      g_reset = 1;
+        else if (strcmp(reset, "0") != 0) return "invalid reset (use 1 or 0)";
+    }
+
+    g_top = (agg_top_t*)calloc((size_t)g_topk, sizeof(*g_top));
+    if (!g_top) return "alloc failed";
+    reset_state();
+    if (g_exact_max && !g_exact) {
+        release();
+        return "alloc failed";
+    }
+    g_since_summary = 0;
+    g_summaries = 0;
+    g_last_ns = now_ns();
+
+    const char* err = common_plugin_init_emit(plugin_aggregate, "aggregate", queue_size, 0);
+    if (err) release();
+    return err;
+}
@@ -0,0 +1,148 @@
+#include "chain_kernel.h"
+
+#include <ctype.h>  // toupper
+#include <stdlib.h> // malloc
+#include <string.h> // strcmp/strlen
+
+static int op_for_name(const char* name, chain_op_t* op) {
+    if (!name) return 0;
+    if (strcmp(name, "rotator") == 0)    { *op = CHAIN_OP_ROTATE; return 1; }
+    if (strcmp(name, "flipper") == 0)    { *op = CHAIN_OP_FLIP;   return 1; }
+    if (strcmp(name, "expander") == 0)   { *op = CHAIN_OP_EXPAND; return 1; }
+    if (strcmp(name, "uppercaser") == 0) { *op = CHAIN_OP_UPPER;  return 1; }
+    return 0;
+}
+
+int chain_kernel_supports(const char* plugin_name) {
+    chain_op_t op;
+    return op_for_name(plugin_name, &op);
+}
+
+// Byte b after the byte maps of ops [from, to)
+static unsigned char map_byte(const chain_kernel_t* k, int from, int to, unsigned char b) {
+    for (int i = from; i < to; ++i) {
+        if (k->ops[i] == CHAIN_OP_UPPER) b = (unsigned char)toupper(b);
+    }
+    return b;
+}
+
+const char* chain_kernel_compile(chain_kernel_t* kernel, const char* const* plugin_names, size_t count) {
+    if (!kernel || !plugin_names) return "invalid arguments";
+    if (count == 0 || count > CHAIN_MAX_OPS) return "unsupported run length";
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!op_for_name(plugin_names[i], &kernel->ops[i])) return "plugin has no kernel equivalent";
+    }
+    kernel->n_ops = (int)count;
+    for (int i = 0; i < CHAIN_MAP_SLOTS; ++i) kernel->maps[i] = (chain_map_t){0};
+
+    for (int c = 0; c < 256; ++c) kernel->table[c] = map_byte(kernel, 0, kernel->n_ops, (unsigned char)c);
+    // a space inserted by op i only sees the byte maps that run after it
+    for (int i = 0; i < kernel->n_ops; ++i) kernel->literal[i] = map_byte(kernel, i + 1, kernel->n_ops, ' ');
+    return NULL;
+}
+
+// Length of the string after each op: lens[0] is the input, lens[n_ops] the output.
+// Each plugin is a no-op on strings too short to change (and on "").
+static void stage_lengths(const chain_kernel_t* k, size_t n, size_t lens[CHAIN_MAX_OPS + 1]) {
+    lens[0] = n;
+    for (int i = 0; i < k->n_ops; ++i) {
+        size_t m = lens[i];
+        lens[i + 1] = (k->ops[i] == CHAIN_OP_EXPAND && m >= 2) ? 2 * m - 1 : m;
+    }
+}
+
+// Where position j of the string produced by the first `upto` ops comes
+// from: a source index, or CHAIN_LITERAL + op for an inserted space.
+// Walks the ops backwards.
+static uint32_t resolve(const chain_kernel_t* k, const size_t lens[CHAIN_MAX_OPS + 1], int upto, size_t j) {
+    for (int i = upto - 1; i >= 0; --i) {
+        size_t m = lens[i];
+        if (m < 2) continue; // identity on short strings
+        switch (k->ops[i]) {
+        case CHAIN_OP_ROTATE: j = (j == 0) ? m - 1 : j - 1; break;
+        case CHAIN_OP_FLIP:   j = m - 1 - j;                break;
+        case CHAIN_OP_EXPAND:
+            if (j & 1) return CHAIN_LITERAL + (uint32_t)i;
+            j >>= 1;
+            break;
+        case CHAIN_OP_UPPER: break;
+        }
+    }
+    return (uint32_t)j;
+}
+
+// Byte at position j of the string produced by the first `upto` ops: the
+// same lookup as the literal and byte tables, cut off after op upto - 1
+static unsigned char byte_at(const chain_kernel_t* k, const unsigned char* in,
+                             const size_t lens[CHAIN_MAX_OPS + 1], int upto, size_t j) {
+    uint32_t src = resolve(k, lens, upto, j);
+    if (src & CHAIN_LITERAL) return map_byte(k, (int)(src - CHAIN_LITERAL) + 1, upto, ' ');
+    return map_byte(k, 0, upto, in[src]);
+}
+
+// In the unfused chain, an intermediate string equal to "<END>" is taken as the
+// sentinel by the next stage of the run, which forwards "<END>". Detect that.
+static int hits_sentinel(const chain_kernel_t* k, const unsigned char* in, const size_t lens[CHAIN_MAX_OPS + 1]) {
+    static const char end_token[] = "<END>";
+    for (int i = 1; i < k->n_ops; ++i) {
+        if (lens[i] != sizeof(end_token) - 1) continue;
+        size_t j = 0;
+        while (j < lens[i] && byte_at(k, in, lens, i, j) == (unsigned char)end_token[j]) ++j;
+        if (j == lens[i]) return 1;
+    }
+    return 0;
+}
+
+void chain_kernel_destroy(chain_kernel_t* kernel) {
+    if (!kernel) return;
+    for (int i = 0; i < CHAIN_MAP_SLOTS; ++i) {
+        free(kernel->maps[i].map);
+        kernel->maps[i] = (chain_map_t){0};
+    }
+}
+
+// Index map for inputs of length n, built on first use and kept per length
+static const uint32_t* map_for(chain_kernel_t* k, size_t n, const size_t lens[CHAIN_MAX_OPS + 1]) {
+    size_t outn = lens[k->n_ops];
+    if (outn > CHAIN_MAP_MAX_LEN) return NULL;
+
+    chain_map_t* slot = &k->maps[n % CHAIN_MAP_SLOTS];
+    if (slot->map && slot->n == n) return slot->map;
+
+    uint32_t* map = (uint32_t*)realloc(slot->map, (outn ? outn : 1) * sizeof(uint32_t));
+    if (!map) return NULL; // the old map (if any) is still owned by the slot
+    for (size_t j = 0; j < outn; ++j) map[j] = resolve(k, lens, k->n_ops, j);
+    slot->map = map;
+    slot->n = n;
+    return map;
+}
+
+const char* chain_kernel_apply(chain_kernel_t* k, const char* input) {
+    if (!k || !input) return NULL;
+
+    size_t n = strlen(input);
+    if (n == 0) return input; // every plugin in the run passes "" through
+
+    const unsigned char* in = (const unsigned char*)input;
+    size_t lens[CHAIN_MAX_OPS + 1];
+    stage_lengths(k, n, lens);
+
+    if (hits_sentinel(k, in, lens)) {
+        char* end = (char*)malloc(sizeof("<END>"));
+        if (end) memcpy(end, "<END>", sizeof("<END>"));
+        return end;
+    }
+
+    size_t outn = lens[k->n_ops];
+    char* out = (char*)malloc(outn + 1);
+    if (!out) return NULL;
+
+    const uint32_t* map = map_for(k, n, lens);
+    for (size_t j = 0; j < outn; ++j) {
+        uint32_t src = map ? map[j] : resolve(k, lens, k->n_ops, j);
+        out[j] = (char)((src & CHAIN_LITERAL) ? k->literal[src - CHAIN_LITERAL] : k->table[in[src]]);
+    }
+    out[outn] = '\0';
+    return out;
+}
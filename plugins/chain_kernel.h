@@ -0,0 +1,67 @@
+#ifndef CHAIN_KERNEL_H
+#define CHAIN_KERNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+* Composed transform for a run of the built-in position/byte-map plugins
+* (rotator, flipper, expander, uppercaser). The run is applied in a single
+* pass over the output with a single allocation, and the result matches
+* running the plugins one after the other.
+*/
+
+#define CHAIN_MAX_OPS 8
+#define CHAIN_MAP_SLOTS 16     /* index maps remembered, one per input length (direct mapped) */
+#define CHAIN_MAP_MAX_LEN 4096 /* longer outputs are resolved position by position */
+
+typedef enum
+{
+    CHAIN_OP_ROTATE, /* rotator: last character moves to the front */
+    CHAIN_OP_FLIP,   /* flipper: reverse */
+    CHAIN_OP_EXPAND, /* expander: a space between every pair */
+    CHAIN_OP_UPPER   /* uppercaser: byte map */
+} chain_op_t;
+
+/* output position -> source index, or CHAIN_LITERAL + op for an inserted space */
+#define CHAIN_LITERAL 0x80000000u
+
+typedef struct
+{
+    size_t    n;   /* input length the map was built for */
+    uint32_t* map; /* one entry per output byte, NULL when the slot is empty */
+} chain_map_t;
+
+typedef struct
+{
+    chain_op_t ops[CHAIN_MAX_OPS];
+    int n_ops;
+    unsigned char table[256];            /* all byte maps of the run composed */
+    unsigned char literal[CHAIN_MAX_OPS]; /* a space inserted by op i, after the maps that follow it */
+    chain_map_t maps[CHAIN_MAP_SLOTS];   /* cached index maps (single consumer, not thread safe) */
+} chain_kernel_t;
+
+/**
+* Check whether a plugin name has a kernel equivalent
+* @return 1 if the plugin can be fused, 0 otherwise
+*/
+int chain_kernel_supports(const char* plugin_name);
+
+/**
+* Compile a run of plugins (in chain order) into a kernel
+* @return NULL on success, error message on failure
+*/
+const char* chain_kernel_compile(chain_kernel_t* kernel, const char* const* plugin_names, size_t count);
+
+/**
+* Release the cached index maps
+*/
+void chain_kernel_destroy(chain_kernel_t* kernel);
+
+/**
+* Apply the kernel to one string
+* @return input itself when the run leaves it unchanged, a new heap string otherwise, NULL on alloc failure
+*/
+const char* chain_kernel_apply(chain_kernel_t* kernel, const char* input);
+
+#endif // CHAIN_KERNEL_H
@@ -0,0 +1,75 @@
+#include "plugin_common.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Counts what reaches it and prints throughput every interval (checked as items arrive)
+static double   g_interval = 1.0; // seconds between reports
+static double   g_start;          // first item
+static double   g_last;           // last report
+static uint64_t g_items, g_bytes;
+static uint64_t g_last_items, g_last_bytes;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Reports are not records: with nul or len32 framing they go to stderr
+static FILE* report_stream(void) {
+    return common_plugin_framing() == PLUGIN_FRAMING_LINE ? stdout : stderr;
+}
+
+static void report(double now) {
+    double dt = now - g_last;
+    if (dt <= 0.0) dt = 1e-9;
+    FILE* out = report_stream();
+    fprintf(out, "[countsink] t=%.1fs items=%" PRIu64 " rate=%.0f/s %.2f MB/s\n",
+           now - g_start, g_items,
+           (double)(g_items - g_last_items) / dt,
+           (double)(g_bytes - g_last_bytes) / dt / 1e6);
+    fflush(out);
+    g_last = now;
+    g_last_items = g_items;
+    g_last_bytes = g_bytes;
+}
+
+const char* plugin_transform(const char* input) {
+    if (!input) return NULL;
+
+    double now = now_sec();
+    if (g_items == 0) g_start = g_last = now;
+    g_items++;
+    g_bytes += strlen(input);
+    if (now - g_last >= g_interval) report(now);
+    return input; // passthrough, no output
+}
+
+// Called once <END> arrives
+static void print_total(void) {
+    double elapsed = g_items ? now_sec() - g_start : 0.0;
+    FILE* out = report_stream();
+    fprintf(out, "[countsink] total items=%" PRIu64 " bytes=%" PRIu64 " elapsed=%.3fs rate=%.0f/s\n",
+            g_items, g_bytes, elapsed, elapsed > 0.0 ? (double)g_items / elapsed : 0.0);
+    fflush(out);
+}
+
+const char* plugin_init(int queue_size) {
+    const char* opt = common_plugin_option("interval");
+    if (opt) {
+        char* endp = NULL;
+        errno = 0;
+        g_interval = strtod(opt, &endp);
+        if (endp == opt || *endp != '\0' || errno == ERANGE || !(g_interval > 0.0)) return "invalid interval";
+    }
+    g_items = g_bytes = g_last_items = g_last_bytes = 0;
+
+    const char* err = common_plugin_init(plugin_transform, "countsink", queue_size);
+    if (err) return err;
+    common_plugin_set_end_hook(print_total);
+    return NULL;
+}
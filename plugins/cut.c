@@ -0,0 +1,166 @@
+#include "plugin_common.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Keeps the fields listed in fields=N[,N...] (1-based, in that order) of
+// every record and joins them with sep=STR (default a space). Column batches
+// from tokenizer are read through their offset and length arrays, one field
+// column at a time; any other record is split on runs of space and tab.
+// Fields a record does not have are left out.
+
+#define CUT_MAX_FIELDS 32
+
+static uint32_t g_fields[CUT_MAX_FIELDS]; // 0-based
+static size_t   g_nfields;
+static char     g_sep[64] = " ";
+static size_t   g_sep_len = 1;
+
+// Output records of the current batch, built field column by field column
+static char*  g_buf;
+static size_t g_buf_cap;
+
+typedef struct
+{
+    size_t at;     // start of the row's slot in g_buf
+    size_t len;
+    size_t fields; // written so far, a separator goes before the next
+} cut_row_t;
+
+static cut_row_t* g_rows;
+static size_t     g_rows_cap;
+
+static int reserve(size_t need) {
+    if (need <= g_buf_cap) return 0;
+    size_t n = g_buf_cap ? g_buf_cap : 4096;
+    while (n < need) n *= 2;
+    char* p = (char*)realloc(g_buf, n);
+    if (!p) return -1;
+    g_buf = p;
+    g_buf_cap = n;
+    return 0;
+}
+
+// Batch: output row r is built in a slot of g_buf sized for its selected
+// fields, so each selected field column is copied in one pass over its two arrays.
+static const char* cut_batch(const cp_columns_t* b, plugin_emitter_t* out) {
+    if (b->rows == 0) return NULL;
+    if (b->rows > g_rows_cap) {
+        cut_row_t* p = (cut_row_t*)realloc(g_rows, b->rows * sizeof(cut_row_t));
+        if (!p) return "alloc failed";
+        g_rows = p;
+        g_rows_cap = b->rows;
+    }
+    memset(g_rows, 0, b->rows * sizeof(cut_row_t));
+
+    // a slot holds every selected field plus a separator each (a field
+    // listed twice counts twice), then the slots are laid out back to back
+    for (size_t k = 0; k < g_nfields; ++k) {
+        if (g_fields[k] >= b->cols) continue;
+        const uint32_t* len = cp_columns_lengths(b, g_fields[k]);
+        for (uint32_t r = 0; r < b->rows; ++r) {
+            if (len[r] != CP_COLUMNS_ABSENT) g_rows[r].len += len[r] + g_sep_len;
+        }
+    }
+    size_t total = 0;
+    for (uint32_t r = 0; r < b->rows; ++r) {
+        if (g_rows[r].len > SIZE_MAX - total) return "column batch too large";
+        g_rows[r].at = total;
+        total += g_rows[r].len;
+        g_rows[r].len = 0;
+    }
+    if (reserve(total)) return "alloc failed";
+
+    const char* data = cp_columns_data(b);
+    for (size_t k = 0; k < g_nfields; ++k) {
+        if (g_fields[k] >= b->cols) continue;
+        const uint32_t* off = cp_columns_offsets(b, g_fields[k]);
+        const uint32_t* len = cp_columns_lengths(b, g_fields[k]);
+        for (uint32_t r = 0; r < b->rows; ++r) {
+            if (len[r] == CP_COLUMNS_ABSENT) continue;
+            cut_row_t* row = &g_rows[r];
+            char* dst = g_buf + row->at + row->len;
+            if (row->fields++) {
+                memcpy(dst, g_sep, g_sep_len);
+                dst += g_sep_len;
+                row->len += g_sep_len;
+            }
+            memcpy(dst, data + off[r], len[r]);
+            row->len += len[r];
+        }
+    }
+    for (uint32_t r = 0; r < b->rows; ++r) {
+        const char* err = common_plugin_emit(out, g_buf + g_rows[r].at, g_rows[r].len);
+        if (err) return err;
+    }
+    return NULL;
+}
+
+// Plain record: find the fields first, then join the selected ones
+static const char* cut_text(const char* s, plugin_emitter_t* out) {
+    const char* start[CUT_MAX_FIELDS];
+    size_t flen[CUT_MAX_FIELDS];
+    uint32_t want = 0;
+    for (size_t k = 0; k < g_nfields; ++k)
+        if (g_fields[k] + 1 > want) want = g_fields[k] + 1;
+
+    uint32_t n = 0;
+    const char* p = s;
+    while (n < want) {
+        while (*p == ' ' || *p == '\t') ++p;
+        if (!*p) break;
+        start[n] = p;
+        while (*p && *p != ' ' && *p != '\t') ++p;
+        flen[n] = (size_t)(p - start[n]);
+        ++n;
+    }
+    size_t need = 1; // the selected fields with a separator each, a field listed twice counts twice
+    for (size_t k = 0; k < g_nfields; ++k) {
+        if (g_fields[k] < n) need += flen[g_fields[k]] + g_sep_len;
+    }
+    if (reserve(need)) return "alloc failed";
+
+    size_t used = 0, written = 0;
+    for (size_t k = 0; k < g_nfields; ++k) {
+        if (g_fields[k] >= n) continue;
+        if (written++) {
+            memcpy(g_buf + used, g_sep, g_sep_len);
+            used += g_sep_len;
+        }
+        memcpy(g_buf + used, start[g_fields[k]], flen[g_fields[k]]);
+        used += flen[g_fields[k]];
+    }
+    return common_plugin_emit(out, g_buf, used);
+}
+
+const char* plugin_cut(const char* input, plugin_emitter_t* out) {
+    if (!input) return NULL;
+    if (common_plugin_item_flags() & CP_ITEM_COLUMNS) return cut_batch((const cp_columns_t*)input, out);
+    return cut_text(input, out);
+}
+
+const char* plugin_init(int queue_size) {
+    const char* fields = common_plugin_option("fields");
+    const char* sep    = common_plugin_option("sep");
+    if (!fields || !*fields) return "missing fields (e.g. fields=2\\,3)";
+    g_nfields = 0;
+    for (const char* p = fields; *p;) {
+        char* endp = NULL;
+        unsigned long n = strtoul(p, &endp, 10);
+        if (endp == p || n == 0 || n > CUT_MAX_FIELDS || g_nfields == CUT_MAX_FIELDS)
+            return "invalid fields (1-based numbers up to 32, comma separated)";
+        g_fields[g_nfields++] = (uint32_t)(n - 1);
+        if (*endp == ',' && endp[1]) p = endp + 1;
+        else if (*endp == '\0') p = endp;
+        else return "invalid fields (1-based numbers up to 32, comma separated)";
+    }
+    memcpy(g_sep, " ", 2);
+    g_sep_len = 1;
+    if (sep) {
+        size_t n = strlen(sep);
+        if (n >= sizeof(g_sep)) return "invalid sep";
+        memcpy(g_sep, sep, n + 1);
+        g_sep_len = n;
+    }
+    return common_plugin_init_emit(plugin_cut, "cut", queue_size, PLUGIN_FLAG_PURE | PLUGIN_FLAG_COLUMNS);
+}
@@ -4,27 +4,31 @@
 
 // Insert one space between every adjacent pair
 // Passthrough for NULL, "<END>", empty string, and single char
+// A fragment that continues a record also gets the space before its first char
 const char* plugin_transform(const char* input) {
     if (!input) return NULL;
 
+    int cont = (common_plugin_item_flags() & CP_ITEM_CONT) != 0;
+
     // Do not touch the sentinel
-    if (strcmp(input, "<END>") == 0) {
+    if (!cont && strcmp(input, "<END>") == 0) {
         return input; // passthrough
     }
 
     size_t n = strlen(input);
 
     // Empty or single char: no op, same pointer
-    if (n <= 1) {
+    if (n == 0 || (n == 1 && !cont)) {
         return input; // passthrough
     }
 
-    // For n chars, need n + (n-1) spaces = 2n-1 (+1 for NUL)
-    size_t outn = 2 * n - 1;
+    // For n chars, need n + (n-1) spaces = 2n-1 (+1 for NUL), one more when continuing
+    size_t outn = 2 * n - 1 + (size_t)cont;
     char* out = (char*)malloc(outn + 1);
     if (!out) return NULL;
 
     size_t j = 0;
+    if (cont) out[j++] = ' ';
     for (size_t i = 0; i < n; ++i) {
         out[j++] = input[i];
         if (i + 1 < n) out[j++] = ' ';
@@ -34,5 +38,6 @@ const char* plugin_transform(const char* input) {
 }
 
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(plugin_transform, "expander", queue_size);
+    return common_plugin_init_ex(plugin_transform, "expander", queue_size,
+                                 PLUGIN_FLAG_PURE | PLUGIN_FLAG_CHUNKS | PLUGIN_FLAG_REENTRANT);
 }
@@ -0,0 +1,223 @@
+#include "plugin_common.h"
+#include "log_ring.h"
+#include "zstd_shim.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Writes every record as a line (or in the host's --framing) to a file,
+// compressed with gzip or zstd, then passes it on unchanged. Records are
+// collected and compressed in large blocks; the file is complete once <END>
+// has gone through.
+#define FILESINK_IN_BYTES  (256u << 10) // lines collected per compression call
+#define FILESINK_OUT_BYTES (256u << 10)
+
+enum { FORMAT_GZIP, FORMAT_ZSTD, FORMAT_PLAIN };
+
+
+static int    g_fd = -1;
+static int    g_format;
+static int    g_level;
+static char*  g_in;         // lines not compressed yet
+static size_t g_in_len;
+static char*  g_out;        // compressor output
+static int    g_failed;     // write failed, later records are not written
+static void*  g_cs;         // zstd stream
+static const zstd_api_t* g_zstd;
+#ifdef HAVE_ZLIB
+static z_stream g_z;
+static int      g_z_ready;
+#endif
+
+static void fail(const char* what) {
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%s, dropping further records", what);
+    log_ring_write("ERROR", "filesink", msg);
+    g_failed = 1;
+}
+
+static void write_all(const char* p, size_t n) {
+    while (n > 0 && !g_failed) {
+        ssize_t w = write(g_fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) {
+            fail(strerror(errno));
+            return;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+}
+
+// Compress n bytes at p (none is fine) and write what comes out; finish ends the stream
+static void compress_bytes(const char* p, size_t n, int finish) {
+    if (g_failed) return;
+    if (g_format == FORMAT_PLAIN) {
+        write_all(p, n);
+        return;
+    }
+#ifdef HAVE_ZLIB
+    if (g_format == FORMAT_GZIP) {
+        g_z.next_in = (Bytef*)p;
+        g_z.avail_in = (uInt)n;
+        do {
+            g_z.next_out = (Bytef*)g_out;
+            g_z.avail_out = FILESINK_OUT_BYTES;
+            if (deflate(&g_z, finish ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR) {
+                fail("deflate failed");
+                return;
+            }
+            write_all(g_out, FILESINK_OUT_BYTES - g_z.avail_out);
+        } while (g_z.avail_out == 0 && !g_failed);
+        return;
+    }
+#endif
+    zstd_in_t in = { p, n, 0 };
+    while (in.pos < in.size && !g_failed) {
+        zstd_out_t out = { g_out, FILESINK_OUT_BYTES, 0 };
+        if (g_zstd->is_error(g_zstd->compress(g_cs, &out, &in))) {
+            fail("zstd compression failed");
+            return;
+        }
+        write_all(g_out, out.pos);
+    }
+    size_t left = finish ? 1 : 0;
+    while (left > 0 && !g_failed) {
+        zstd_out_t out = { g_out, FILESINK_OUT_BYTES, 0 };
+        left = g_zstd->end(g_cs, &out);
+        if (g_zstd->is_error(left)) {
+            fail("zstd compression failed");
+            return;
+        }
+        write_all(g_out, out.pos);
+    }
+}
+
+static void append(const char* s, size_t n) {
+    if (g_in_len + n > FILESINK_IN_BYTES) {
+        compress_bytes(g_in, g_in_len, 0);
+        g_in_len = 0;
+    }
+    if (n >= FILESINK_IN_BYTES) {
+        compress_bytes(s, n, 0); // too large to collect, straight from the record
+        return;
+    }
+    memcpy(g_in + g_in_len, s, n);
+    g_in_len += n;
+}
+
+const char* plugin_transform(const char* input) {
+    unsigned flags = common_plugin_item_flags();
+    if (!input || (flags == 0 && strcmp(input, "<END>") == 0)) return input;
+    if (g_fd < 0 || g_failed) return input;
+
+    // a chunked record becomes one line: newline (or the framing's
+    // terminator) after its last fragment
+    char frame[4];
+    size_t len = strlen(input);
+    if (!(flags & CP_ITEM_CONT)) append(frame, common_plugin_frame_head(len, frame));
+    append(input, len);
+    if (!(flags & CP_ITEM_MORE)) append(frame, common_plugin_frame_tail(frame));
+    return input; // passthrough
+}
+
+static void release(void) {
+    if (g_fd >= 0) close(g_fd);
+    g_fd = -1;
+#ifdef HAVE_ZLIB
+    if (g_z_ready) deflateEnd(&g_z);
+    g_z_ready = 0;
+#endif
+    if (g_cs) g_zstd->free_cs(g_cs);
+    g_cs = NULL;
+    free(g_in);
+    free(g_out);
+    g_in = g_out = NULL;
+    g_in_len = 0;
+}
+
+// Called once <END> arrives: compress what is left and end the stream
+static void finish_file(void) {
+    if (g_fd < 0) return;
+    compress_bytes(g_in, g_in_len, 1);
+    int rc = close(g_fd);
+    g_fd = -1;
+    if (rc != 0 && !g_failed) fail(strerror(errno));
+    release();
+}
+
+// Compressor state for g_format and g_level
+static const char* start_stream(void) {
+    if (g_format == FORMAT_ZSTD) {
+        const char* err = NULL;
+        if (!(g_zstd = zstd_shim_load(&err))) return err;
+        if (!(g_cs = g_zstd->create_cs())) return "alloc failed";
+        if (g_zstd->is_error(g_zstd->init_cs(g_cs, g_level))) return "invalid level";
+        return NULL;
+    }
+#ifdef HAVE_ZLIB
+    if (g_format == FORMAT_GZIP) {
+        memset(&g_z, 0, sizeof(g_z));
+        if (deflateInit2(&g_z, g_level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return "zlib init failed";
+        }
+        g_z_ready = 1;
+    }
+#else
+    if (g_format == FORMAT_GZIP) return "format=gzip needs a build with zlib";
+#endif
+    return NULL;
+}
+
+const char* plugin_init(int queue_size) {
+    static char errbuf[320];
+    const char* path   = common_plugin_option("path");
+    const char* format = common_plugin_option("format");
+    const char* level  = common_plugin_option("level");
+    if (!path || !*path) return "filesink needs path=FILE";
+
+    g_format = FORMAT_GZIP;
+    if (format) {
+        if (strcmp(format, "gzip") == 0)       g_format = FORMAT_GZIP;
+        else if (strcmp(format, "zstd") == 0)  g_format = FORMAT_ZSTD;
+        else if (strcmp(format, "plain") == 0) g_format = FORMAT_PLAIN;
+        else return "invalid format (use gzip, zstd or plain)";
+    }
+    g_level = (g_format == FORMAT_ZSTD) ? 3 : 6;
+    if (level) {
+        char* endp = NULL;
+        errno = 0;
+        long v = strtol(level, &endp, 10);
+        int max = (g_format == FORMAT_ZSTD) ? 19 : 9;
+        if (endp == level || *endp != '\0' || errno == ERANGE || v < 1 || v > max) return "invalid level";
+        g_level = (int)v;
+    }
+
+    g_failed = 0;
+    g_in_len = 0;
+    g_in = (char*)malloc(FILESINK_IN_BYTES);
+    g_out = (char*)malloc(FILESINK_OUT_BYTES);
+    const char* err = (g_in && g_out) ? start_stream() : "alloc failed";
+    if (!err) {
+        g_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (g_fd < 0) {
+            snprintf(errbuf, sizeof(errbuf), "cannot open '%s': %s", path, strerror(errno));
+            err = errbuf;
+        }
+    }
+    // a length prefix needs the whole record up front
+    unsigned flags = (common_plugin_framing() == PLUGIN_FRAMING_LEN32) ? 0 : PLUGIN_FLAG_CHUNKS;
+    if (!err) err = common_plugin_init_ex(plugin_transform, "filesink", queue_size, flags);
+    if (err) {
+        release();
+        return err;
+    }
+    common_plugin_set_end_hook(finish_file);
+    return NULL;
+}
@@ -0,0 +1,14 @@
+#ifndef FRAMING_H
+#define FRAMING_H
+
+/**
+* Record framing of the analyzer's input (--framing=) and of what sinks
+* write out. Records are NUL-terminated strings inside the pipeline, so any
+* byte but NUL can be carried; with nul or len32 framing that includes
+* '\n' and '\r'.
+*/
+#define PLUGIN_FRAMING_LINE  0 /* '\n' after each record (default) */
+#define PLUGIN_FRAMING_NUL   1 /* '\0' after each record */
+#define PLUGIN_FRAMING_LEN32 2 /* big-endian u32 byte count before each record */
+
+#endif // FRAMING_H
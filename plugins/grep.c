@@ -0,0 +1,613 @@
+#include "plugin_common.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Passes the lines matching a regular expression and drops the rest.
+// The pattern is parsed into a small syntax tree, compiled to a Thompson NFA
+// and searched with a DFA built lazily, one state per set of NFA states
+// actually reached. A literal every match must contain is extracted from the
+// tree and searched first (SSE2), so most non-matching lines never reach the DFA.
+//
+// Syntax: literals, . [set] [^set] with ranges, \d \w \s (and \D \W \S),
+// escapes \t \n \\ \. ..., grouping ( ), alternation |, * + ?, anchors ^ $.
+
+#define GREP_MAX_NODES     4096  // syntax tree and NFA size limit
+#define GREP_MAX_DSTATES   1024  // cached DFA states, flushed when exceeded
+#define GREP_END_SYMBOL    256   // virtual symbol fed at the end of the line
+
+typedef struct { uint64_t w[4]; } byteset_t;
+
+static void set_add(byteset_t* s, unsigned c) { s->w[c >> 6] |= 1ull << (c & 63); }
+static int  set_has(const byteset_t* s, unsigned c) { return (s->w[c >> 6] >> (c & 63)) & 1; }
+
+// ---------------------------------------------------------------- parsing
+
+enum { AST_SET, AST_CAT, AST_ALT, AST_STAR, AST_PLUS, AST_QUEST, AST_BOL, AST_EOL, AST_EMPTY };
+
+typedef struct
+{
+    int kind;
+    int a, b;      // children (CAT, ALT: a and b; repeats: a)
+    byteset_t set; // AST_SET
+} ast_t;
+
+typedef struct
+{
+    const char* p;
+    int icase;
+    ast_t* nodes;
+    int count;
+    const char* err;
+} parser_t;
+
+static int ast_new(parser_t* ps, int kind, int a, int b) {
+    if (ps->count >= GREP_MAX_NODES) {
+        ps->err = "pattern too complex";
+        return -1;
+    }
+    ast_t* n = &ps->nodes[ps->count];
+    memset(n, 0, sizeof(*n));
+    n->kind = kind;
+    n->a = a;
+    n->b = b;
+    return ps->count++;
+}
+
+static void add_byte(parser_t* ps, byteset_t* s, unsigned c) {
+    set_add(s, c);
+    if (ps->icase && c >= 'a' && c <= 'z') set_add(s, c - 'a' + 'A');
+    if (ps->icase && c >= 'A' && c <= 'Z') set_add(s, c - 'A' + 'a');
+}
+
+static void add_range(parser_t* ps, byteset_t* s, unsigned lo, unsigned hi) {
+    for (unsigned c = lo; c <= hi; ++c) add_byte(ps, s, c);
+}
+
+// \d \w \s and friends; returns 0 if c is not a class letter
+static int add_class(parser_t* ps, byteset_t* s, char c) {
+    byteset_t t = {{0}};
+    switch (c) {
+    case 'd': case 'D': add_range(ps, &t, '0', '9'); break;
+    case 'w': case 'W': add_range(ps, &t, '0', '9'); add_range(ps, &t, 'a', 'z');
+                        add_range(ps, &t, 'A', 'Z'); set_add(&t, '_'); break;
+    case 's': case 'S': set_add(&t, ' '); add_range(ps, &t, '\t', '\r'); break;
+    default: return 0;
+    }
+    int negate = (c == 'D' || c == 'W' || c == 'S');
+    for (int i = 0; i < 4; ++i) s->w[i] |= negate ? ~t.w[i] : t.w[i];
+    return 1;
+}
+
+static unsigned escaped_byte(char c) {
+    switch (c) {
+    case 't': return '\t';
+    case 'n': return '\n';
+    case 'r': return '\r';
+    default:  return (unsigned char)c;
+    }
+}
+
+static int parse_alt(parser_t* ps);
+
+static int parse_bracket(parser_t* ps) {
+    int id = ast_new(ps, AST_SET, -1, -1);
+    if (id < 0) return -1;
+    byteset_t s = {{0}};
+    int negate = (*ps->p == '^');
+    if (negate) ps->p++;
+    int first = 1;
+    while (*ps->p && (*ps->p != ']' || first)) {
+        first = 0;
+        unsigned lo;
+        if (*ps->p == '\\' && ps->p[1]) {
+            if (add_class(ps, &s, ps->p[1])) {
+                ps->p += 2;
+                continue;
+            }
+            lo = escaped_byte(ps->p[1]);
+            ps->p += 2;
+        } else {
+            lo = (unsigned char)*ps->p++;
+        }
+        if (ps->p[0] == '-' && ps->p[1] && ps->p[1] != ']') {
+            unsigned hi = (unsigned char)ps->p[1];
+            if (ps->p[1] == '\\' && ps->p[2]) {
+                hi = escaped_byte(ps->p[2]);
+                ps->p++;
+            }
+            ps->p += 2;
+            if (hi < lo) {
+                ps->err = "invalid range in [ ]";
+                return -1;
+            }
+            add_range(ps, &s, lo, hi);
+        } else {
+            add_byte(ps, &s, lo);
+        }
+    }
+    if (*ps->p != ']') {
+        ps->err = "missing ]";
+        return -1;
+    }
+    ps->p++;
+    if (negate) for (int i = 0; i < 4; ++i) s.w[i] = ~s.w[i];
+    ps->nodes[id].set = s;
+    return id;
+}
+
+static int parse_atom(parser_t* ps) {
+    char c = *ps->p;
+    if (c == '(') {
+        ps->p++;
+        int id = parse_alt(ps);
+        if (id < 0) return -1;
+        if (*ps->p != ')') {
+            ps->err = "missing )";
+            return -1;
+        }
+        ps->p++;
+        return id;
+    }
+    if (c == '[') {
+        ps->p++;
+        return parse_bracket(ps);
+    }
+    if (c == '^') { ps->p++; return ast_new(ps, AST_BOL, -1, -1); }
+    if (c == '$') { ps->p++; return ast_new(ps, AST_EOL, -1, -1); }
+    if (c == '*' || c == '+' || c == '?') {
+        ps->err = "nothing to repeat";
+        return -1;
+    }
+
+    int id = ast_new(ps, AST_SET, -1, -1);
+    if (id < 0) return -1;
+    byteset_t s = {{0}};
+    if (c == '.') {
+        for (int i = 0; i < 4; ++i) s.w[i] = ~0ull;
+        ps->p++;
+    } else if (c == '\\') {
+        if (!ps->p[1]) {
+            ps->err = "trailing backslash";
+            return -1;
+        }
+        if (!add_class(ps, &s, ps->p[1])) add_byte(ps, &s, escaped_byte(ps->p[1]));
+        ps->p += 2;
+    } else {
+        add_byte(ps, &s, (unsigned char)c);
+        ps->p++;
+    }
+    ps->nodes[id].set = s;
+    return id;
+}
+
+static int parse_repeat(parser_t* ps) {
+    int id = parse_atom(ps);
+    while (id >= 0 && (*ps->p == '*' || *ps->p == '+' || *ps->p == '?')) {
+        int kind = (*ps->p == '*') ? AST_STAR : (*ps->p == '+') ? AST_PLUS : AST_QUEST;
+        ps->p++;
+        id = ast_new(ps, kind, id, -1);
+    }
+    return id;
+}
+
+static int parse_cat(parser_t* ps) {
+    int id = -1;
+    while (*ps->p && *ps->p != '|' && *ps->p != ')') {
+        int next = parse_repeat(ps);
+        if (next < 0) return -1;
+        id = (id < 0) ? next : ast_new(ps, AST_CAT, id, next);
+        if (id < 0) return -1;
+    }
+    return id < 0 ? ast_new(ps, AST_EMPTY, -1, -1) : id;
+}
+
+static int parse_alt(parser_t* ps) {
+    int id = parse_cat(ps);
+    while (id >= 0 && *ps->p == '|') {
+        ps->p++;
+        int rhs = parse_cat(ps);
+        if (rhs < 0) return -1;
+        id = ast_new(ps, AST_ALT, id, rhs);
+    }
+    return id;
+}
+
+// ---------------------------------------------------------------- literal prefilter
+
+static int single_byte(const byteset_t* s, unsigned char* out) {
+    int n = 0;
+    for (int i = 0; i < 4; ++i) n += __builtin_popcountll(s->w[i]);
+    if (n != 1) return 0;
+    for (unsigned c = 0; c < 256; ++c) {
+        if (set_has(s, c)) { *out = (unsigned char)c; return 1; }
+    }
+    return 0;
+}
+
+// Flatten a concatenation into its items, left to right
+static void cat_items(const ast_t* nodes, int id, int* out, int* n) {
+    if (nodes[id].kind == AST_CAT) {
+        cat_items(nodes, nodes[id].a, out, n);
+        cat_items(nodes, nodes[id].b, out, n);
+    } else {
+        out[(*n)++] = id;
+    }
+}
+
+// Longest byte string that every match of node id contains (best into buf/len)
+static void required_literal(const ast_t* nodes, int id, char* buf, size_t* len, size_t cap) {
+    const ast_t* n = &nodes[id];
+    if (n->kind == AST_PLUS) { // at least one copy
+        required_literal(nodes, n->a, buf, len, cap);
+        return;
+    }
+    if (n->kind != AST_CAT && n->kind != AST_SET) return;
+
+    int* items = (int*)malloc(GREP_MAX_NODES * sizeof(int));
+    if (!items) return; // no prefilter, the DFA alone still answers
+    int count = 0;
+    cat_items(nodes, id, items, &count);
+    char run[256];
+    size_t run_len = 0;
+    for (int i = 0; i <= count; ++i) {
+        unsigned char c;
+        if (i < count && nodes[items[i]].kind == AST_SET && single_byte(&nodes[items[i]].set, &c)
+            && run_len < sizeof(run) && run_len < cap) {
+            run[run_len++] = (char)c;
+            continue;
+        }
+        if (run_len > *len) {
+            memcpy(buf, run, run_len);
+            *len = run_len;
+        }
+        run_len = 0;
+        if (i < count && nodes[items[i]].kind != AST_SET) required_literal(nodes, items[i], buf, len, cap);
+    }
+    free(items);
+}
+
+static int is_pure_literal(const ast_t* nodes, int id) {
+    int items[GREP_MAX_NODES];
+    int count = 0;
+    cat_items(nodes, id, items, &count);
+    unsigned char c;
+    for (int i = 0; i < count; ++i) {
+        if (nodes[items[i]].kind != AST_SET || !single_byte(&nodes[items[i]].set, &c)) return 0;
+    }
+    return 1;
+}
+
+// Position of needle in hay, or NULL. Compares the needle's first and last
+// bytes against 16 candidate positions at once, memcmp only on a double hit.
+static const char* find_literal(const char* hay, size_t hlen, const char* needle, size_t nlen) {
+    if (nlen == 0) return hay;
+    if (hlen < nlen) return NULL;
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last  = _mm_set1_epi8(needle[nlen - 1]);
+    for (; i + nlen - 1 + 16 <= hlen; i += 16) {
+        __m128i bf = _mm_loadu_si128((const __m128i*)(hay + i));
+        __m128i bl = _mm_loadu_si128((const __m128i*)(hay + i + nlen - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, bf),
+                                                                   _mm_cmpeq_epi8(last, bl)));
+        while (mask) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (nlen <= 2 || memcmp(hay + i + bit + 1, needle + 1, nlen - 2) == 0) return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i + nlen <= hlen; ++i) {
+        const char* p = (const char*)memchr(hay + i, needle[0], hlen - nlen + 1 - i);
+        if (!p) return NULL;
+        i = (size_t)(p - hay);
+        if (memcmp(p, needle, nlen) == 0) return p;
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------- NFA
+
+enum { NFA_SET, NFA_EPS, NFA_SPLIT, NFA_BOL, NFA_EOL, NFA_MATCH };
+
+typedef struct
+{
+    int kind;
+    int out, out1;
+    byteset_t set;
+} nfa_node_t;
+
+typedef struct
+{
+    nfa_node_t* nodes;
+    int count;
+    int start;
+} nfa_t;
+
+static int nfa_new(nfa_t* nfa, int kind) {
+    if (nfa->count >= 2 * GREP_MAX_NODES) return -1;
+    nfa_node_t* n = &nfa->nodes[nfa->count];
+    memset(n, 0, sizeof(*n));
+    n->kind = kind;
+    n->out = n->out1 = -1;
+    return nfa->count++;
+}
+
+// Compile node id into a fragment entered at *start that leaves through the
+// returned EPS node (its out is patched by the caller). -1 if too large.
+static int compile(nfa_t* nfa, const ast_t* ast, int id, int* start) {
+    const ast_t* n = &ast[id];
+    int s, e, s2, e2, split;
+    switch (n->kind) {
+    case AST_SET:
+    case AST_BOL:
+    case AST_EOL:
+    case AST_EMPTY:
+        s = nfa_new(nfa, n->kind == AST_SET ? NFA_SET : n->kind == AST_BOL ? NFA_BOL
+                       : n->kind == AST_EOL ? NFA_EOL : NFA_EPS);
+        e = nfa_new(nfa, NFA_EPS);
+        if (s < 0 || e < 0) return -1;
+        nfa->nodes[s].set = n->set;
+        nfa->nodes[s].out = e;
+        *start = s;
+        return e;
+    case AST_CAT:
+        if ((e = compile(nfa, ast, n->a, &s)) < 0 || (e2 = compile(nfa, ast, n->b, &s2)) < 0) return -1;
+        nfa->nodes[e].out = s2;
+        *start = s;
+        return e2;
+    case AST_ALT:
+        if ((e = compile(nfa, ast, n->a, &s)) < 0 || (e2 = compile(nfa, ast, n->b, &s2)) < 0) return -1;
+        if ((split = nfa_new(nfa, NFA_SPLIT)) < 0) return -1;
+        nfa->nodes[split].out = s;
+        nfa->nodes[split].out1 = s2;
+        nfa->nodes[e2].out = e;
+        *start = split;
+        return e;
+    default: // STAR, PLUS, QUEST
+        if ((e = compile(nfa, ast, n->a, &s)) < 0) return -1;
+        if ((split = nfa_new(nfa, NFA_SPLIT)) < 0 || (e2 = nfa_new(nfa, NFA_EPS)) < 0) return -1;
+        nfa->nodes[split].out = s;
+        nfa->nodes[split].out1 = e2;
+        nfa->nodes[e].out = (n->kind == AST_QUEST) ? e2 : split; // loop back for * and +
+        *start = (n->kind == AST_PLUS) ? s : split;
+        return e2;
+    }
+}
+
+// ---------------------------------------------------------------- lazy DFA
+
+typedef struct
+{
+    int* states;      // sorted NFA SET/EOL/MATCH nodes
+    int  nstates;
+    int  accept;      // contains MATCH
+    int  next[GREP_END_SYMBOL + 1]; // -1 = not built yet; [256] = after end of line
+} dstate_t;
+
+static nfa_t     g_nfa;
+static dstate_t  g_dstates[GREP_MAX_DSTATES];
+static int       g_dcount;
+static int       g_dstart = -1;      // state at position 0, -1 = not built
+static int*      g_closure_mark;  // per NFA node, generation it was added in
+static int       g_closure_gen;
+static int*      g_stack;
+static int*      g_scratch;
+static int       g_anchored_start;   // pattern can only match at position 0 (no restart)
+
+static char     g_literal[256];      // required substring, empty if none
+static size_t   g_literal_len;
+static int      g_literal_only;      // the pattern is exactly g_literal
+static int      g_invert;
+
+// Add node and everything reachable by epsilon moves; at_begin allows ^
+static void closure_add(int node, int at_begin, int* out, int* n) {
+    int sp = 0;
+    g_stack[sp++] = node;
+    while (sp > 0) {
+        int id = g_stack[--sp];
+        if (id < 0 || g_closure_mark[id] == g_closure_gen) continue;
+        g_closure_mark[id] = g_closure_gen;
+        const nfa_node_t* nd = &g_nfa.nodes[id];
+        switch (nd->kind) {
+        case NFA_EPS:   g_stack[sp++] = nd->out; break;
+        case NFA_SPLIT: g_stack[sp++] = nd->out1; g_stack[sp++] = nd->out; break;
+        case NFA_BOL:   if (at_begin) g_stack[sp++] = nd->out; break;
+        default:        out[(*n)++] = id; break; // SET, EOL, MATCH
+        }
+    }
+}
+
+static int cmp_int(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static void dfa_flush(void) {
+    for (int i = 0; i < g_dcount; ++i) free(g_dstates[i].states);
+    g_dcount = 0;
+    g_dstart = -1;
+}
+
+// Find or add the DFA state for a set of NFA nodes (sorted in place)
+static int dfa_state(int* set, int n) {
+    qsort(set, (size_t)n, sizeof(int), cmp_int);
+    for (int i = 0; i < g_dcount; ++i) {
+        if (g_dstates[i].nstates == n && memcmp(g_dstates[i].states, set, (size_t)n * sizeof(int)) == 0) return i;
+    }
+    if (g_dcount == GREP_MAX_DSTATES) return -1;
+    dstate_t* d = &g_dstates[g_dcount];
+    d->states = (int*)malloc((size_t)(n ? n : 1) * sizeof(int));
+    if (!d->states) return -1;
+    memcpy(d->states, set, (size_t)n * sizeof(int));
+    d->nstates = n;
+    d->accept = 0;
+    for (int i = 0; i < n; ++i) d->accept |= (g_nfa.nodes[set[i]].kind == NFA_MATCH);
+    for (int c = 0; c <= GREP_END_SYMBOL; ++c) d->next[c] = -1;
+    return g_dcount++;
+}
+
+static int dfa_start(void) {
+    if (g_dstart >= 0) return g_dstart;
+    int n = 0;
+    g_closure_gen++;
+    closure_add(g_nfa.start, 1, g_scratch, &n);
+    g_dstart = dfa_state(g_scratch, n);
+    return g_dstart;
+}
+
+// Build the transition of state from on symbol c. -1 when out of memory.
+static int dfa_step_slow(int from, int c) {
+    int n = 0;
+    g_closure_gen++;
+    const dstate_t* d = &g_dstates[from];
+    for (int i = 0; i < d->nstates; ++i) {
+        const nfa_node_t* nd = &g_nfa.nodes[d->states[i]];
+        if (c == GREP_END_SYMBOL) {
+            if (nd->kind == NFA_EOL) closure_add(nd->out, 0, g_scratch, &n);
+            if (nd->kind == NFA_MATCH) closure_add(d->states[i], 0, g_scratch, &n);
+        } else if (nd->kind == NFA_SET && set_has(&nd->set, (unsigned)c)) {
+            closure_add(nd->out, 0, g_scratch, &n);
+        }
+    }
+    // unanchored search: a match may also start after this byte
+    if (c != GREP_END_SYMBOL && !g_anchored_start) closure_add(g_nfa.start, 0, g_scratch, &n);
+
+    int to = dfa_state(g_scratch, n);
+    if (to < 0) {
+        // cache full: keep the target set, drop every state, rebuild lazily
+        int* keep = (int*)malloc((size_t)(n ? n : 1) * sizeof(int));
+        if (!keep) return -1;
+        memcpy(keep, g_scratch, (size_t)n * sizeof(int));
+        dfa_flush();
+        to = dfa_state(keep, n);
+        free(keep);
+        return to; // the caller restarts its lookups from this state
+    }
+    g_dstates[from].next[c] = to;
+    return to;
+}
+
+static int dfa_match(const char* s, size_t len) {
+    int st = dfa_start();
+    if (st < 0) return 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (g_dstates[st].accept) return 1;
+        if (g_dstates[st].nstates == 0) return 0; // anchored pattern already failed
+        int c = (unsigned char)s[i];
+        int to = g_dstates[st].next[c];
+        if (to < 0 && (to = dfa_step_slow(st, c)) < 0) return 0;
+        st = to;
+    }
+    if (g_dstates[st].accept) return 1;
+    int to = g_dstates[st].next[GREP_END_SYMBOL];
+    if (to < 0 && (to = dfa_step_slow(st, GREP_END_SYMBOL)) < 0) return 0;
+    return g_dstates[to].accept;
+}
+
+// ---------------------------------------------------------------- plugin
+
+static int line_matches(const char* s) {
+    size_t len = strlen(s);
+    if (g_literal_len) {
+        if (!find_literal(s, len, g_literal, g_literal_len)) return 0;
+        if (g_literal_only) return 1;
+    }
+    return dfa_match(s, len);
+}
+
+const char* plugin_transform(const char* input) {
+    if (!input) return NULL;
+    return (line_matches(input) != g_invert) ? input : PLUGIN_DROP;
+}
+
+static void release(void) {
+    dfa_flush();
+    free(g_nfa.nodes);
+    free(g_closure_mark);
+    free(g_stack);
+    free(g_scratch);
+    g_nfa = (nfa_t){0};
+    g_closure_mark = g_stack = g_scratch = NULL;
+    g_literal_len = 0;
+    g_literal_only = 0;
+}
+
+static int parse_flag(const char* v, int* out) {
+    if (!v) return 0;
+    if (strcmp(v, "1") == 0 || strcmp(v, "yes") == 0) { *out = 1; return 0; }
+    if (strcmp(v, "0") == 0 || strcmp(v, "no") == 0)  { *out = 0; return 0; }
+    return -1;
+}
+
+static char g_error[160];
+
+static const char* build(const char* pattern, int icase) {
+    parser_t ps = { pattern, icase, NULL, 0, NULL };
+    ps.nodes = (ast_t*)malloc(GREP_MAX_NODES * sizeof(ast_t));
+    if (!ps.nodes) return "alloc failed";
+    int root = parse_alt(&ps);
+    if (root >= 0 && *ps.p != '\0') ps.err = "unbalanced )";
+    if (ps.err || root < 0) {
+        snprintf(g_error, sizeof(g_error), "invalid pattern: %s", ps.err ? ps.err : "parse failed");
+        free(ps.nodes);
+        return g_error;
+    }
+
+    g_literal_len = 0;
+    required_literal(ps.nodes, root, g_literal, &g_literal_len, sizeof(g_literal));
+    g_literal_only = g_literal_len > 0 && is_pure_literal(ps.nodes, root);
+    // only a leading ^ on every path pins the match to the line start; the
+    // common case is one ^ at the front of a concatenation
+    int items[GREP_MAX_NODES];
+    int count = 0;
+    cat_items(ps.nodes, root, items, &count);
+    g_anchored_start = (count > 0 && ps.nodes[items[0]].kind == AST_BOL);
+
+    g_nfa.nodes = (nfa_node_t*)malloc(2 * GREP_MAX_NODES * sizeof(nfa_node_t));
+    if (!g_nfa.nodes) {
+        free(ps.nodes);
+        return "alloc failed";
+    }
+    int start = -1;
+    int end = compile(&g_nfa, ps.nodes, root, &start);
+    int match = (end >= 0) ? nfa_new(&g_nfa, NFA_MATCH) : -1;
+    free(ps.nodes);
+    if (match < 0) return "invalid pattern: pattern too complex";
+    g_nfa.nodes[end].out = match;
+    g_nfa.start = start;
+
+    g_closure_mark = (int*)calloc((size_t)g_nfa.count, sizeof(int));
+    g_stack   = (int*)malloc(((size_t)g_nfa.count * 2 + 1) * sizeof(int));
+    g_scratch = (int*)malloc((size_t)g_nfa.count * sizeof(int));
+    if (!g_closure_mark || !g_stack || !g_scratch) return "alloc failed";
+    g_closure_gen = 0;
+    return NULL;
+}
+
+const char* plugin_init(int queue_size) {
+    release();
+    const char* pattern = common_plugin_option("pattern");
+    const char* icase   = common_plugin_option("icase");
+    const char* invert  = common_plugin_option("invert");
+    if (!pattern || !*pattern) return "grep needs pattern=REGEX";
+    int ic = 0;
+    g_invert = 0;
+    if (parse_flag(icase, &ic) != 0)        return "invalid icase (use 1 or 0)";
+    if (parse_flag(invert, &g_invert) != 0) return "invalid invert (use 1 or 0)";
+
+    const char* err = build(pattern, ic);
+    if (!err) err = common_plugin_init_ex(plugin_transform, "grep", queue_size, PLUGIN_FLAG_PURE);
+    if (err) {
+        release();
+        return err;
+    }
+    common_plugin_set_end_hook(release); // no transform runs after <END>
+    return NULL;
+}
@@ -0,0 +1,474 @@
+#include "plugin_common.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Projects JSON lines onto a few fields: fields=a\,user.id keeps those values
+// (dotted names reach into nested objects) and passes on a compact record,
+// {"a":1,"user.id":"x"} or, with format=tsv, the values separated by tabs.
+// where=PATH=V (also !=, <, <=, >, >=) passes only the records whose value compares
+// so; = and != compare strings by their bytes between the quotes, the others
+// compare numbers. A missing field is null (empty in tsv) and fails every
+// comparison except !=.
+//
+// Parsing is done in two stages, as simdjson does:
+// 1. structural index: 64 bytes at a time, SSE2 compares give bit masks of
+//    quotes, backslashes and { } [ ] : , ; escaped quotes and the inside of
+//    strings are masked out with carry and prefix-xor arithmetic, leaving the
+//    positions of the structural characters and the quotes around strings.
+// 2. a walk over those positions only, descending into the objects a path
+//    goes through and skipping other values by their brackets.
+// Blocks are indexed as the walk reaches them, and the walk stops as soon as
+// every wanted field has been seen, so the rest of the line is never read.
+// What is read is checked: brackets, strings and the key : value , order,
+// scalars by their first byte. Lines found not to be a JSON object are
+// dropped and counted.
+
+#define JP_MAX_PATHS 16
+#define JP_MAX_SEGS  8
+#define JP_MAX_DEPTH 64 // nesting skipped over
+
+typedef struct
+{
+    char*       name; // as given, the key in the output
+    const char* seg[JP_MAX_SEGS];
+    size_t      seg_len[JP_MAX_SEGS];
+    int         nseg;
+} jp_path_t;
+
+enum { JP_EQ, JP_NE, JP_LT, JP_LE, JP_GT, JP_GE };
+
+static jp_path_t g_paths[JP_MAX_PATHS + 1]; // projected fields, then the where= field
+static int       g_nfields;
+static int       g_npaths;
+static int       g_where = -1; // index in g_paths, -1 without where=
+static int       g_op;
+static char*     g_value;
+static size_t    g_value_len;
+static double    g_value_num;
+static int       g_tsv;
+static uint64_t  g_invalid;
+
+// Structural index of the current line, per thread (the stage is reentrant)
+static __thread uint32_t* t_idx;
+static __thread size_t    t_idx_cap;
+
+// ---------------------------------------------------------------- stage 1
+
+static uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Quotes preceded by an odd run of backslashes are escaped. *carry tells
+// whether the previous block ended in the middle of such a run.
+static uint64_t find_escaped(uint64_t bs, uint64_t* carry) {
+    const uint64_t even = 0x5555555555555555ull;
+    bs &= ~*carry;
+    uint64_t follows = (bs << 1) | *carry;
+    uint64_t odd_starts = bs & ~even & ~follows;
+    uint64_t seq_even;
+    *carry = __builtin_add_overflow(odd_starts, bs, &seq_even);
+    return (even ^ (seq_even << 1)) & follows;
+}
+
+static void classify64(const char* p, uint64_t* quote, uint64_t* bslash, uint64_t* op) {
+    uint64_t q = 0, b = 0, o = 0;
+#ifdef __SSE2__
+    const __m128i vq = _mm_set1_epi8('"');
+    const __m128i vb = _mm_set1_epi8('\\');
+    const __m128i vlo = _mm_set1_epi8(0x20);
+    const __m128i vopen = _mm_set1_epi8('{'); // '[' | 0x20
+    const __m128i vclose = _mm_set1_epi8('}'); // ']' | 0x20
+    const __m128i vcolon = _mm_set1_epi8(':');
+    const __m128i vcomma = _mm_set1_epi8(',');
+    for (int k = 0; k < 4; ++k) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * k));
+        __m128i l = _mm_or_si128(v, vlo);
+        __m128i s = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(l, vopen), _mm_cmpeq_epi8(l, vclose)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, vcolon), _mm_cmpeq_epi8(v, vcomma)));
+        q |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vq)) << (16 * k);
+        b |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vb)) << (16 * k);
+        o |= (uint64_t)(unsigned)_mm_movemask_epi8(s) << (16 * k);
+    }
+#else
+    for (int k = 0; k < 64; ++k) {
+        char c = p[k];
+        q |= (uint64_t)(c == '"') << k;
+        b |= (uint64_t)(c == '\\') << k;
+        o |= (uint64_t)(c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') << k;
+    }
+#endif
+    *quote = q;
+    *bslash = b;
+    *op = o;
+}
+
+// A line being indexed and walked
+typedef struct
+{
+    const char* s;
+    size_t      len;
+    uint32_t*   idx;   // structural positions found so far
+    size_t      n;
+    size_t      base;  // next block to index
+    uint64_t    esc_carry, in_str_carry;
+    size_t      i;     // walk position in idx
+    uint32_t    want;  // bit per path
+    uint32_t    found;
+    const char* val[JP_MAX_PATHS + 1];
+    size_t      val_len[JP_MAX_PATHS + 1];
+} walk_t;
+
+// Index the next 64 bytes: positions of the structural characters outside
+// strings and of the quotes around strings
+static void index_block(walk_t* w) {
+    uint64_t q, b, o;
+    if (w->base + 64 <= w->len) {
+        classify64(w->s + w->base, &q, &b, &o);
+    } else { // last partial block, padded with spaces
+        char tail[64];
+        memset(tail, ' ', sizeof(tail));
+        memcpy(tail, w->s + w->base, w->len - w->base);
+        classify64(tail, &q, &b, &o);
+    }
+    q &= ~find_escaped(b, &w->esc_carry);
+    uint64_t in_str = prefix_xor(q) ^ w->in_str_carry;
+    w->in_str_carry = (uint64_t)((int64_t)in_str >> 63);
+    uint64_t st = (o & ~in_str) | q;
+    while (st) {
+        w->idx[w->n++] = (uint32_t)(w->base + (size_t)__builtin_ctzll(st));
+        st &= st - 1;
+    }
+    w->base += 64;
+}
+
+// ---------------------------------------------------------------- stage 2
+
+// Structural character number i, indexing blocks as the walk reaches them;
+// NUL past the end
+static char at(walk_t* w, size_t i) {
+    while (i >= w->n && w->base < w->len) index_block(w);
+    return i < w->n ? w->s[w->idx[i]] : '\0';
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Skip the array or object starting at w->i, strings included
+static int skip_nested(walk_t* w) {
+    char stack[JP_MAX_DEPTH];
+    int depth = 0;
+    do {
+        char c = at(w, w->i);
+        if (c == '"') {
+            if (at(w, w->i + 1) != '"') return -1;
+            w->i += 2;
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            if (depth == JP_MAX_DEPTH) return -1;
+            stack[depth++] = c;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0 || stack[--depth] != (c == '}' ? '{' : '[')) return -1;
+        } else if (c != ',' && c != ':') {
+            return -1; // ran off the end
+        }
+        w->i++;
+    } while (depth);
+    return 0;
+}
+
+static int key_is(const jp_path_t* p, int depth, const char* key, size_t len) {
+    return p->nseg > depth && p->seg_len[depth] == len && memcmp(p->seg[depth], key, len) == 0;
+}
+
+// Object at w->i whose keys are compared with segment depth of the paths in
+// alive. Returns 1 once every wanted path was found, 0 at the closing brace,
+// -1 on malformed input.
+static int walk_object(walk_t* w, int depth, uint32_t alive) {
+    w->i++; // '{'
+    if (at(w, w->i) == '}') {
+        w->i++;
+        return 0;
+    }
+    for (;;) {
+        if (at(w, w->i) != '"' || at(w, w->i + 1) != '"' || at(w, w->i + 2) != ':') return -1;
+        const char* key = w->s + w->idx[w->i] + 1;
+        size_t key_len = w->idx[w->i + 1] - w->idx[w->i] - 1;
+        size_t colon = w->idx[w->i + 2];
+        w->i += 3;
+
+        uint32_t ends = 0, deeper = 0;
+        for (uint32_t m = alive; m; m &= m - 1) {
+            int k = __builtin_ctz(m);
+            if (!key_is(&g_paths[k], depth, key, key_len)) continue;
+            if (g_paths[k].nseg == depth + 1) ends |= 1u << k;
+            else deeper |= 1u << k;
+        }
+
+        const char* v;
+        size_t vlen;
+        char c = at(w, w->i);
+        if (c == '"') {
+            if (at(w, w->i + 1) != '"') return -1;
+            v = w->s + w->idx[w->i];
+            vlen = w->idx[w->i + 1] - w->idx[w->i] + 1;
+            w->i += 2;
+        } else if (c == '{' || c == '[') {
+            size_t start = w->idx[w->i];
+            if (c == '{' && deeper) {
+                int rc = walk_object(w, depth + 1, deeper);
+                if (rc) return rc;
+            } else if (skip_nested(w)) {
+                return -1;
+            }
+            v = w->s + start;
+            vlen = w->idx[w->i - 1] + 1 - start;
+        } else if (c == ',' || c == '}') { // scalar, up to the next structural
+            v = w->s + colon + 1;
+            const char* e = w->s + w->idx[w->i];
+            while (v < e && is_space(*v)) v++;
+            while (e > v && is_space(e[-1])) e--;
+            if (v == e || !strchr("-0123456789tfn", *v)) return -1;
+            vlen = (size_t)(e - v);
+        } else {
+            return -1;
+        }
+
+        for (uint32_t m = ends & ~w->found; m; m &= m - 1) { // the first occurrence wins
+            int k = __builtin_ctz(m);
+            w->val[k] = v;
+            w->val_len[k] = vlen;
+        }
+        w->found |= ends;
+        if ((w->found & w->want) == w->want) return 1;
+
+        c = at(w, w->i++);
+        if (c == '}') return 0;
+        if (c != ',') return -1;
+    }
+}
+
+// ---------------------------------------------------------------- transform
+
+static int where_passes(const walk_t* w) {
+    const char* v = w->val[g_where];
+    size_t len = w->val_len[g_where];
+    if (!(w->found & (1u << g_where))) return g_op == JP_NE;
+    if (g_op == JP_EQ || g_op == JP_NE) {
+        if (len >= 2 && v[0] == '"') {
+            v++;
+            len -= 2;
+        }
+        int eq = len == g_value_len && memcmp(v, g_value, len) == 0;
+        return (g_op == JP_EQ) == eq;
+    }
+    char num[64];
+    if (len >= sizeof(num) || v[0] == '"') return 0;
+    memcpy(num, v, len);
+    num[len] = '\0';
+    char* end = NULL;
+    double x = strtod(num, &end);
+    if (end == num || *end) return 0;
+    switch (g_op) {
+    case JP_LT: return x < g_value_num;
+    case JP_LE: return x <= g_value_num;
+    case JP_GT: return x > g_value_num;
+    default:    return x >= g_value_num;
+    }
+}
+
+const char* plugin_transform(const char* input) {
+    if (!input) return NULL;
+    size_t len = strlen(input);
+    if (len + 1 > t_idx_cap) {
+        size_t cap = t_idx_cap ? t_idx_cap : 256;
+        while (cap < len + 1) cap *= 2;
+        uint32_t* p = (uint32_t*)realloc(t_idx, cap * sizeof(uint32_t));
+        if (!p) return NULL;
+        t_idx = p;
+        t_idx_cap = cap;
+    }
+    walk_t w;
+    memset(&w, 0, offsetof(walk_t, val));
+    w.s = input;
+    w.len = len;
+    w.idx = t_idx;
+    w.want = (1u << g_npaths) - 1;
+    int rc = -1;
+    if (at(&w, 0) == '{') {
+        size_t first = w.idx[0];
+        while (first && is_space(input[first - 1])) first--;
+        if (first == 0) rc = walk_object(&w, 0, w.want);
+    }
+    if (rc == 0) { // the whole object was read: only blanks may follow
+        if (at(&w, w.i) != '\0' || w.in_str_carry) rc = -1;
+        for (size_t k = w.idx[w.n - 1] + 1; rc == 0 && k < len; ++k)
+            if (!is_space(input[k])) rc = -1;
+    }
+    if (rc < 0) {
+        __atomic_fetch_add(&g_invalid, 1, __ATOMIC_RELAXED);
+        return PLUGIN_DROP;
+    }
+    if (g_where >= 0 && !where_passes(&w)) return PLUGIN_DROP;
+
+    size_t size = 3;
+    for (int k = 0; k < g_nfields; ++k)
+        size += strlen(g_paths[k].name) + 4 + (w.found & (1u << k) ? w.val_len[k] : 4);
+    char* out = (char*)malloc(size);
+    if (!out) return NULL;
+    char* p = out;
+    if (!g_tsv) *p++ = '{';
+    for (int k = 0; k < g_nfields; ++k) {
+        int has = (w.found >> k) & 1;
+        const char* v = w.val[k];
+        size_t vlen = has ? w.val_len[k] : 0;
+        if (g_tsv) {
+            if (k) *p++ = '\t';
+            if (has && vlen >= 2 && v[0] == '"') {
+                v++;
+                vlen -= 2;
+            }
+        } else {
+            if (k) *p++ = ',';
+            size_t nlen = strlen(g_paths[k].name);
+            *p++ = '"';
+            memcpy(p, g_paths[k].name, nlen);
+            p += nlen;
+            *p++ = '"';
+            *p++ = ':';
+            if (!has) {
+                v = "null";
+                vlen = 4;
+            }
+        }
+        memcpy(p, v, vlen);
+        p += vlen;
+    }
+    if (!g_tsv) *p++ = '}';
+    *p = '\0';
+    return out;
+}
+
+// ---------------------------------------------------------------- options
+
+static void release(void) {
+    for (int k = 0; k < g_npaths; ++k) free(g_paths[k].name);
+    memset(g_paths, 0, sizeof(g_paths));
+    g_npaths = g_nfields = 0;
+    g_where = -1;
+    free(g_value);
+    g_value = NULL;
+}
+
+static const char* add_path(const char* s, size_t len) {
+    if (g_npaths == JP_MAX_PATHS + 1) return "too many fields (at most 16)";
+    jp_path_t* p = &g_paths[g_npaths];
+    if (len == 0) return "empty field name";
+    p->name = (char*)malloc(len + 1);
+    if (!p->name) return "alloc failed";
+    memcpy(p->name, s, len);
+    p->name[len] = '\0';
+    g_npaths++;
+    const char* seg = p->name;
+    for (const char* c = p->name;; ++c) {
+        if (*c == '"' || *c == '\\') return "field names cannot hold quotes or backslashes";
+        if (*c != '.' && *c != '\0') continue;
+        if (c == seg) return "empty field name segment";
+        if (p->nseg == JP_MAX_SEGS) return "field path too deep (at most 8 names)";
+        p->seg[p->nseg] = seg;
+        p->seg_len[p->nseg++] = (size_t)(c - seg);
+        if (!*c) return NULL;
+        seg = c + 1;
+    }
+}
+
+static const char* parse_where(const char* spec) {
+    const char* op = spec + strcspn(spec, "!=<>");
+    if (!*op || op == spec) return "invalid where (PATH=V, PATH!=V, PATH<N or PATH>N)";
+    const char* value = op + 1;
+    switch (*op) {
+    case '=': g_op = JP_EQ; break;
+    case '<': g_op = JP_LT; break;
+    case '>': g_op = JP_GT; break;
+    default:
+        if (op[1] != '=') return "invalid where (PATH=V, PATH!=V, PATH<N or PATH>N)";
+        g_op = JP_NE;
+    }
+    if (g_op != JP_EQ && *value == '=') {
+        if (g_op == JP_LT) g_op = JP_LE;
+        if (g_op == JP_GT) g_op = JP_GE;
+        value++;
+    }
+    if (g_op != JP_EQ && g_op != JP_NE) {
+        char* end = NULL;
+        g_value_num = strtod(value, &end);
+        if (end == value || *end) return "invalid where: <, <=, > and >= need a number";
+    }
+    g_value_len = strlen(value);
+    g_value = (char*)malloc(g_value_len + 1);
+    if (!g_value) return "alloc failed";
+    memcpy(g_value, value, g_value_len + 1);
+    const char* err = add_path(spec, (size_t)(op - spec));
+    if (!err) g_where = g_npaths - 1;
+    return err;
+}
+
+static const char* configure(void) {
+    const char* fields = common_plugin_option("fields");
+    const char* where  = common_plugin_option("where");
+    const char* format = common_plugin_option("format");
+    if (!fields || !*fields) return "missing fields (e.g. fields=id\\,user.name)";
+    for (const char* p = fields;;) {
+        size_t n = strcspn(p, ",");
+        if (g_npaths == JP_MAX_PATHS) return "too many fields (at most 16)";
+        const char* err = add_path(p, n);
+        if (err) return err;
+        if (!p[n]) break;
+        p += n + 1;
+    }
+    g_nfields = g_npaths;
+    if (where) {
+        const char* err = parse_where(where);
+        if (err) return err;
+    }
+    g_tsv = 0;
+    if (format) {
+        if (strcmp(format, "tsv") == 0)       g_tsv = 1;
+        else if (strcmp(format, "json") != 0) return "invalid format (use json or tsv)";
+    }
+    return NULL;
+}
+
+// At <END>, after the last transform
+static void finish(void) {
+    uint64_t n = __atomic_load_n(&g_invalid, __ATOMIC_RELAXED);
+    if (n) fprintf(stderr, "[jsonpick] not JSON objects: %llu\n", (unsigned long long)n);
+    release();
+}
+
+const char* plugin_init(int queue_size) {
+    release();
+    g_invalid = 0;
+    const char* err = configure();
+    if (!err) err = common_plugin_init_ex(plugin_transform, "jsonpick", queue_size,
+                                          PLUGIN_FLAG_PURE | PLUGIN_FLAG_REENTRANT);
+    if (err) {
+        release();
+        return err;
+    }
+    common_plugin_set_end_hook(finish);
+    return NULL;
+}
@@ -0,0 +1,325 @@
+#include "log_ring.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct log_ring
+{
+    struct log_ring* next;      /* registry link, set once before publication */
+    _Atomic unsigned head;      /* next slot the writer reads */
+    _Atomic unsigned tail;      /* next slot the owner thread fills */
+    char slots[LOG_RING_SLOTS][LOG_RING_MSG_MAX];
+
+    /* the owner's pending counts, which the writer also prints once a period */
+    pthread_mutex_t lock;          /* uncontended but for that periodic flush */
+    char   last[LOG_RING_MSG_MAX]; /* last accepted message, for duplicate collapsing */
+    char   last_level[16];
+    char   last_name[64];
+    unsigned long repeats;         /* identical messages since `last` */
+    unsigned long suppressed;      /* dropped by the rate limit or a full ring */
+
+    /* owner-thread-only state */
+    double tokens;                 /* token bucket */
+    double refilled_at;            /* seconds, monotonic */
+} log_ring_t;
+
+static _Atomic(log_ring_t*) g_rings;     /* lock-free push-front registry */
+static _Atomic unsigned     g_generation = 1; /* bumped on shutdown, invalidates thread rings */
+static _Atomic int          g_running;   /* writer thread is up */
+static _Atomic int          g_stop;
+static pthread_mutex_t      g_start_lock = PTHREAD_MUTEX_INITIALIZER; /* start/stop only */
+static pthread_t            g_writer;
+static sem_t                g_wakeup;    /* initialized once, outlives writer restarts */
+static int                  g_wakeup_ready;
+
+/* flush barrier: log_ring_flush takes a ticket, the writer completes every
+ * ticket taken before its drain started */
+static pthread_mutex_t      g_flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t       g_flush_cond = PTHREAD_COND_INITIALIZER;
+static unsigned long        g_flush_asked, g_flush_done;
+
+static __thread log_ring_t* t_ring;
+static __thread unsigned    t_generation;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void format_line(char* out, const char* level, const char* name, const char* message) {
+    int n = snprintf(out, LOG_RING_MSG_MAX, "[%s][%s] - %s\n", level, name, message);
+    if (n >= LOG_RING_MSG_MAX) {
+        // keep the line terminated even when the message was cut
+        memcpy(out + LOG_RING_MSG_MAX - 5, "...\n", 5);
+    }
+}
+
+// The repeat count for the previous message as a line, 0 when there is none
+// (caller holds r->lock; the count is taken)
+static int take_repeats(log_ring_t* r, char* line) {
+    if (r->repeats == 0) return 0;
+    char msg[96];
+    snprintf(msg, sizeof(msg), "(previous message repeated %lu more times)", r->repeats);
+    format_line(line, r->last_level, r->last_name, msg);
+    r->repeats = 0;
+    return 1;
+}
+
+// The suppressed count as a line, 0 when there is none (caller holds r->lock)
+static int take_suppressed(log_ring_t* r, const char* name, char* line) {
+    if (r->suppressed == 0) return 0;
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%lu log messages suppressed (rate limit)", r->suppressed);
+    format_line(line, "INFO", name, msg);
+    r->suppressed = 0;
+    return 1;
+}
+
+// Writer side: print and release every message queued in one ring
+static void drain_ring(log_ring_t* r) {
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    while (head != tail) {
+        fputs(r->slots[head & (LOG_RING_SLOTS - 1)], stderr);
+        head++;
+        atomic_store_explicit(&r->head, head, memory_order_release);
+    }
+}
+
+// Writer side: print what a ring holds, then its pending counts, so a
+// message that keeps repeating (or a thread held at the rate limit) is still
+// reported while it lasts
+static void drain_counts(log_ring_t* r) {
+    char line[LOG_RING_MSG_MAX];
+    pthread_mutex_lock(&r->lock);
+    drain_ring(r);
+    if (take_repeats(r, line)) fputs(line, stderr);
+    if (take_suppressed(r, r->last_name[0] ? r->last_name : "unknown", line)) fputs(line, stderr);
+    pthread_mutex_unlock(&r->lock);
+}
+
+static void drain_all(int with_counts) {
+    for (log_ring_t* r = atomic_load_explicit(&g_rings, memory_order_acquire); r; r = r->next) {
+        if (with_counts) drain_counts(r);
+        else drain_ring(r);
+    }
+    fflush(stderr);
+}
+
+// Complete the flush tickets up to done
+static void flush_completed(unsigned long done) {
+    pthread_mutex_lock(&g_flush_lock);
+    if (done > g_flush_done) g_flush_done = done;
+    pthread_cond_broadcast(&g_flush_cond);
+    pthread_mutex_unlock(&g_flush_lock);
+}
+
+static void* writer_main(void* arg) {
+    (void)arg;
+    double counts_at = now_sec();
+    while (!atomic_load(&g_stop)) {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until); // sem_timedwait's clock
+        until.tv_sec += LOG_COUNT_PERIOD_MS / 1000;
+        until.tv_nsec += (long)(LOG_COUNT_PERIOD_MS % 1000) * 1000000L;
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        while (sem_timedwait(&g_wakeup, &until) != 0 && errno == EINTR) { }
+
+        pthread_mutex_lock(&g_flush_lock);
+        unsigned long asked = g_flush_asked;
+        pthread_mutex_unlock(&g_flush_lock);
+        double now = now_sec();
+        int with_counts = (now - counts_at) * 1000.0 >= LOG_COUNT_PERIOD_MS;
+        if (with_counts) counts_at = now;
+        drain_all(with_counts);
+        flush_completed(asked);
+    }
+    return NULL;
+}
+
+static int ensure_writer(void) {
+    if (atomic_load_explicit(&g_running, memory_order_acquire)) return 0;
+
+    pthread_mutex_lock(&g_start_lock);
+    int rc = 0;
+    if (!atomic_load(&g_running)) {
+        atomic_store(&g_stop, 0);
+        if (!g_wakeup_ready) g_wakeup_ready = (sem_init(&g_wakeup, 0, 0) == 0);
+        if (!g_wakeup_ready || pthread_create(&g_writer, NULL, writer_main, NULL) != 0) {
+            rc = -1;
+        } else {
+            atomic_store_explicit(&g_running, 1, memory_order_release);
+        }
+    }
+    pthread_mutex_unlock(&g_start_lock);
+    return rc;
+}
+
+static log_ring_t* thread_ring(void) {
+    unsigned gen = atomic_load_explicit(&g_generation, memory_order_acquire);
+    if (t_ring && t_generation == gen) return t_ring;
+
+    log_ring_t* r = (log_ring_t*)calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    if (pthread_mutex_init(&r->lock, NULL) != 0) {
+        free(r);
+        return NULL;
+    }
+    r->tokens = LOG_RATE_BURST;
+    r->refilled_at = now_sec();
+
+    log_ring_t* head = atomic_load(&g_rings);
+    do {
+        r->next = head;
+    } while (!atomic_compare_exchange_weak(&g_rings, &head, r));
+
+    t_ring = r;
+    t_generation = gen;
+    return r;
+}
+
+// Owner side: copy one finished line into the ring, 0 when queued
+static int push(log_ring_t* r, const char* line) {
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (tail - head == LOG_RING_SLOTS) return -1; // full
+
+    char* slot = r->slots[tail & (LOG_RING_SLOTS - 1)];
+    size_t n = strlen(line);
+    if (n >= LOG_RING_MSG_MAX) n = LOG_RING_MSG_MAX - 1;
+    memcpy(slot, line, n);
+    slot[n] = '\0';
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return 0;
+}
+
+static void direct_write(const char* level, const char* name, const char* message) {
+    fprintf(stderr, "[%s][%s] - %s\n", level, name, message);
+    fflush(stderr);
+}
+
+// Queue the pending counts, then line (caller holds r->lock). 0 when queued.
+static int push_after_counts(log_ring_t* r, const char* name, const char* line) {
+    char count[LOG_RING_MSG_MAX];
+    if (take_repeats(r, count) && push(r, count) != 0) r->suppressed++;
+    if (take_suppressed(r, name, count) && push(r, count) != 0) r->suppressed = 1; // still pending
+    return push(r, line);
+}
+
+void log_ring_write(const char* level, const char* name, const char* message) {
+    log_ring_t* r = (ensure_writer() == 0) ? thread_ring() : NULL;
+    if (!r) {
+        direct_write(level, name, message);
+        return;
+    }
+
+    // collapse identical consecutive messages
+    char line[LOG_RING_MSG_MAX];
+    format_line(line, level, name, message);
+    pthread_mutex_lock(&r->lock);
+    if (r->last[0] && strcmp(line, r->last) == 0) {
+        r->repeats++;
+        pthread_mutex_unlock(&r->lock);
+        return;
+    }
+
+    // token bucket
+    double now = now_sec();
+    r->tokens += (now - r->refilled_at) * LOG_RATE_PER_SEC;
+    if (r->tokens > LOG_RATE_BURST) r->tokens = LOG_RATE_BURST;
+    r->refilled_at = now;
+    if (r->tokens < 1.0) {
+        r->suppressed++;
+        pthread_mutex_unlock(&r->lock);
+        return;
+    }
+    r->tokens -= 1.0;
+
+    if (push_after_counts(r, name, line) != 0) {
+        r->suppressed++;
+        pthread_mutex_unlock(&r->lock);
+        return;
+    }
+    memcpy(r->last, line, sizeof(line));
+    snprintf(r->last_level, sizeof(r->last_level), "%s", level);
+    snprintf(r->last_name, sizeof(r->last_name), "%s", name);
+    pthread_mutex_unlock(&r->lock);
+    sem_post(&g_wakeup);
+}
+
+// Stop the writer thread (caller holds g_start_lock); the caller becomes the
+// rings' only reader. The semaphore stays valid: a logging thread may still
+// post to it after seeing the writer running.
+static void stop_writer(void) {
+    if (atomic_load(&g_running)) {
+        atomic_store(&g_stop, 1);
+        sem_post(&g_wakeup);
+        pthread_join(g_writer, NULL);
+        atomic_store(&g_running, 0);
+    }
+    // nobody is left to complete a flush, the caller prints what remains
+    pthread_mutex_lock(&g_flush_lock);
+    unsigned long asked = g_flush_asked;
+    pthread_mutex_unlock(&g_flush_lock);
+    flush_completed(asked);
+}
+
+void log_ring_shutdown(void) {
+    pthread_mutex_lock(&g_start_lock);
+    stop_writer();
+
+    // the writer is gone: print leftovers and pending counts, then free
+    log_ring_t* r = atomic_exchange(&g_rings, NULL);
+    atomic_fetch_add(&g_generation, 1);
+    while (r) {
+        log_ring_t* next = r->next;
+        drain_counts(r);
+        pthread_mutex_destroy(&r->lock);
+        free(r);
+        r = next;
+    }
+    fflush(stderr);
+    pthread_mutex_unlock(&g_start_lock);
+}
+
+void log_ring_write_control(const char* level, const char* name, const char* message) {
+    log_ring_t* r = (ensure_writer() == 0) ? thread_ring() : NULL;
+    if (!r) {
+        direct_write(level, name, message);
+        return;
+    }
+    char line[LOG_RING_MSG_MAX];
+    format_line(line, level, name, message);
+    pthread_mutex_lock(&r->lock);
+    while (push_after_counts(r, name, line) != 0) { // full: let the writer make room
+        pthread_mutex_unlock(&r->lock);
+        log_ring_flush();
+        pthread_mutex_lock(&r->lock);
+    }
+    pthread_mutex_unlock(&r->lock);
+}
+
+void log_ring_flush(void) {
+    if (ensure_writer() != 0) return; // nothing was queued, lines went out directly
+    pthread_mutex_lock(&g_flush_lock);
+    if (!atomic_load(&g_running)) { // stopping: stop_writer completed every ticket
+        pthread_mutex_unlock(&g_flush_lock);
+        return;
+    }
+    unsigned long ticket = ++g_flush_asked;
+    pthread_mutex_unlock(&g_flush_lock);
+    sem_post(&g_wakeup);
+    pthread_mutex_lock(&g_flush_lock);
+    while (g_flush_done < ticket) pthread_cond_wait(&g_flush_cond, &g_flush_lock);
+    pthread_mutex_unlock(&g_flush_lock);
+}
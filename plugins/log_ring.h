@@ -0,0 +1,44 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+/**
+* Asynchronous stderr logging for plugin threads.
+* Each thread writes into its own single-producer ring (lock free); a
+* background writer thread drains the rings to stderr. Identical consecutive
+* messages are collapsed into a repeat count, and each thread is rate limited
+* (token bucket); what gets dropped is reported as a count instead. Pending
+* counts are also printed once a period while they keep growing.
+*/
+
+#define LOG_RING_SLOTS    256 /* messages buffered per thread (power of two) */
+#define LOG_RING_MSG_MAX  256 /* bytes per message, longer ones are truncated */
+#define LOG_RATE_PER_SEC  200 /* sustained messages per second per thread */
+#define LOG_RATE_BURST    100 /* messages a quiet thread may emit at once */
+#define LOG_COUNT_PERIOD_MS 1000 /* pending repeat and suppressed counts are printed this often */
+
+/**
+* Queue one line "[<level>][<name>] - <message>" for the writer thread.
+* Never blocks; falls back to a direct write only if the writer cannot start.
+*/
+void log_ring_write(const char* level, const char* name, const char* message);
+
+/**
+* Queue one control-plane line (stats) like log_ring_write, but never
+* collapsed or rate limited; waits for room if this thread's ring is full.
+*/
+void log_ring_write_control(const char* level, const char* name, const char* message);
+
+/**
+* Wait until the writer has printed everything queued before the call, by
+* any thread. For output whose order relative to other stages matters.
+*/
+void log_ring_flush(void);
+
+/**
+* Stop the writer thread, print everything still buffered (including pending
+* repeat and suppression counts) and release all rings. Logging afterwards
+* starts a new writer on demand.
+*/
+void log_ring_shutdown(void);
+
+#endif // LOG_RING_H
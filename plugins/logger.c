@@ -3,22 +3,31 @@
 #include <string.h>
 
 
+#define LOGGER_PREFIX "[logger] "
+
 /* exact END token check */
 static int is_end_token(const char* s) {
     return s && strcmp(s, "<END>") == 0;
 }
 
 const char* plugin_transform(const char* input) {
-    if (!input || is_end_token(input)) {
+    unsigned flags = common_plugin_item_flags();
+    if (!input || (flags == 0 && is_end_token(input))) {
         // NULL: passthrough NULL; "<END>": passthrough same pointer, no output
         return input;
     }
 
     // // Print with the required prefix and a newline, even for empty strings
+    // A chunked record prints as one line: prefix before its first fragment,
+    // newline (or the framing's terminator) after its last
     // plugin_print_lock();
-    fputs("[logger] ", stdout);
+    char frame[4];
+    if (!(flags & CP_ITEM_CONT)) {
+        fwrite(frame, 1, common_plugin_frame_head(sizeof(LOGGER_PREFIX) - 1 + strlen(input), frame), stdout);
+        fputs(LOGGER_PREFIX, stdout);
+    }
     fputs(input, stdout);
-    fputc('\n', stdout);
+    if (!(flags & CP_ITEM_MORE)) fwrite(frame, 1, common_plugin_frame_tail(frame), stdout);
     fflush(stdout);
     // plugin_print_unlock();
 
@@ -27,5 +36,7 @@ const char* plugin_transform(const char* input) {
 }
 
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(plugin_transform, "logger", queue_size);
+    // a length prefix needs the whole record up front
+    unsigned flags = (common_plugin_framing() == PLUGIN_FRAMING_LEN32) ? 0 : PLUGIN_FLAG_CHUNKS;
+    return common_plugin_init_ex(plugin_transform, "logger", queue_size, flags);
 }
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "memo_cache.h"
+
+#include <stdlib.h> // malloc/free
+#include <string.h> // memcpy/memcmp/strlen
+
+#define MEMO_MUL1 0x9E3779B97F4A7C15ull
+#define MEMO_MUL2 0xC2B2AE3D27D4EB4Full
+
+static uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ull;
+    k ^= k >> 33;
+    return k;
+}
+
+uint64_t memo_hash(const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = (uint64_t)len * MEMO_MUL1;
+
+    // 8 bytes per step, unaligned loads through memcpy
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ (w * MEMO_MUL2)) * MEMO_MUL1;
+        h ^= h >> 29;
+        p += 8;
+        len -= 8;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p, len);
+    h = (h ^ (tail * MEMO_MUL2)) * MEMO_MUL1;
+    return fmix64(h);
+}
+
+const char* memo_cache_init(memo_cache_t* cache, int capacity, size_t max_bytes) {
+    if (cache == NULL) return "cache is NULL";
+    if (capacity <= 0 || capacity > (1 << 24)) return "invalid cache capacity";
+
+    *cache = (memo_cache_t){0};
+    int nb = 1;
+    while (nb < capacity * 2) nb <<= 1; // load factor <= 0.5
+
+    cache->entries = (memo_entry_t*)calloc((size_t)capacity, sizeof(memo_entry_t));
+    cache->buckets = (int*)malloc((size_t)nb * sizeof(int));
+    if (!cache->entries || !cache->buckets) {
+        free(cache->entries);
+        free(cache->buckets);
+        *cache = (memo_cache_t){0};
+        return "cache alloc failed";
+    }
+    for (int i = 0; i < nb; ++i) cache->buckets[i] = -1;
+    cache->capacity  = capacity;
+    cache->nbuckets  = nb;
+    cache->max_bytes = max_bytes;
+    return NULL;
+}
+
+void memo_cache_destroy(memo_cache_t* cache) {
+    if (cache == NULL || cache->entries == NULL) return;
+    for (int i = 0; i < cache->capacity; ++i) {
+        free(cache->entries[i].key);
+        free(cache->entries[i].value);
+    }
+    free(cache->entries);
+    free(cache->buckets);
+    *cache = (memo_cache_t){0};
+}
+
+const char* memo_cache_lookup(memo_cache_t* cache, const char* key, size_t key_len, uint64_t hash) {
+    int i = cache->buckets[hash & (uint64_t)(cache->nbuckets - 1)];
+    while (i >= 0) {
+        memo_entry_t* e = &cache->entries[i];
+        if (e->hash == hash && e->key_len == key_len && memcmp(e->key, key, key_len) == 0) {
+            e->referenced = 1;
+            cache->hits++;
+            return e->value ? e->value : e->key;
+        }
+        i = e->next;
+    }
+    cache->misses++;
+    return NULL;
+}
+
+// Unlink slot i from its bucket chain and free its contents
+static void evict(memo_cache_t* cache, int i) {
+    memo_entry_t* e = &cache->entries[i];
+    int* link = &cache->buckets[e->hash & (uint64_t)(cache->nbuckets - 1)];
+    while (*link != i) link = &cache->entries[*link].next;
+    *link = e->next;
+
+    cache->bytes -= e->bytes;
+    cache->count--;
+    cache->evictions++;
+    free(e->key);
+    free(e->value);
+    *e = (memo_entry_t){0};
+}
+
+// CLOCK: sweep, clearing reference bits, until an unreferenced slot turns up
+static int pick_victim(memo_cache_t* cache) {
+    for (;;) {
+        int i = cache->hand;
+        cache->hand = (cache->hand + 1) % cache->capacity;
+        memo_entry_t* e = &cache->entries[i];
+        if (!e->used) return i;
+        if (!e->referenced) {
+            evict(cache, i);
+            return i;
+        }
+        e->referenced = 0;
+    }
+}
+
+int memo_cache_insert(memo_cache_t* cache, const char* key, size_t key_len, uint64_t hash, char* value) {
+    size_t bytes = key_len + 1 + (value ? strlen(value) + 1 : 0);
+    if (cache->max_bytes && bytes > cache->max_bytes) return -1; // would never fit
+
+    // make room: one free slot, and enough byte budget
+    int slot = -1;
+    if (cache->count == cache->capacity) slot = pick_victim(cache);
+    while (cache->max_bytes && cache->count > 0 && cache->bytes + bytes > cache->max_bytes) {
+        int victim = pick_victim(cache);
+        if (slot < 0) slot = victim;
+    }
+    if (slot < 0) {
+        // a free slot exists; the hand finds it without evicting anything
+        while (cache->entries[cache->hand].used) cache->hand = (cache->hand + 1) % cache->capacity;
+        slot = cache->hand;
+    }
+
+    char* k = (char*)malloc(key_len + 1);
+    if (!k) return -1;
+    memcpy(k, key, key_len);
+    k[key_len] = '\0';
+
+    memo_entry_t* e = &cache->entries[slot];
+    int b = (int)(hash & (uint64_t)(cache->nbuckets - 1));
+    e->hash       = hash;
+    e->key        = k;
+    e->key_len    = key_len;
+    e->value      = value;
+    e->bytes      = bytes;
+    e->used       = 1;
+    e->referenced = 0;
+    e->next       = cache->buckets[b];
+    cache->buckets[b] = slot;
+    cache->count++;
+    cache->bytes += bytes;
+    return 0;
+}
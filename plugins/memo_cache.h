@@ -0,0 +1,72 @@
+#ifndef MEMO_CACHE_H
+#define MEMO_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+* Bounded result cache for pure transforms, keyed by the input bytes.
+* Eviction uses the CLOCK (second chance) policy. Not thread safe: a stage
+* uses it from its consumer thread only.
+*/
+
+typedef struct
+{
+    uint64_t hash;   /* memo_hash of the key */
+    char*    key;    /* owned copy of the input */
+    size_t   key_len;
+    char*    value;  /* owned output, NULL when the transform returned its input */
+    size_t   bytes;  /* key + value bytes charged to the cache */
+    int      next;   /* next entry in the same bucket, -1 ends the chain */
+    int      used;   /* slot holds an entry */
+    int      referenced; /* CLOCK bit, set on every hit */
+} memo_entry_t;
+
+typedef struct
+{
+    memo_entry_t* entries; /* slot array, capacity long */
+    int*  buckets;         /* heads of the hash chains, -1 when empty */
+    int   capacity;        /* max number of entries */
+    int   nbuckets;        /* power of two */
+    int   count;           /* entries in use */
+    int   hand;            /* CLOCK hand */
+    size_t bytes;          /* key + value bytes held */
+    size_t max_bytes;      /* 0 = bounded by entry count only */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} memo_cache_t;
+
+/**
+* Hash a byte range (fast, non cryptographic)
+*/
+uint64_t memo_hash(const void* data, size_t len);
+
+/**
+* Initialize a cache
+* @param cache Cache to initialize
+* @param capacity Max number of entries (> 0)
+* @param max_bytes Max key + value bytes, 0 = unlimited
+* @return NULL on success, error message on failure
+*/
+const char* memo_cache_init(memo_cache_t* cache, int capacity, size_t max_bytes);
+
+/**
+* Free every entry and the index
+*/
+void memo_cache_destroy(memo_cache_t* cache);
+
+/**
+* Look up the cached output for a key
+* @return The cached output (owned by the cache, valid until the next insert), or NULL on a miss
+*/
+const char* memo_cache_lookup(memo_cache_t* cache, const char* key, size_t key_len, uint64_t hash);
+
+/**
+* Remember an output. The cache copies the key and takes ownership of value.
+* @param value Heap-allocated output, or NULL when the transform returned its input unchanged
+* @return 0 when stored (value now belongs to the cache), -1 otherwise (caller keeps value)
+*/
+int memo_cache_insert(memo_cache_t* cache, const char* key, size_t key_len, uint64_t hash, char* value);
+
+#endif // MEMO_CACHE_H
@@ -0,0 +1,131 @@
+#include "net_link.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+int net_link_read_full(int fd, void* buf, size_t n) {
+    char* p = (char*)buf;
+    while (n > 0) {
+        ssize_t r = recv(fd, p, n, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+int net_link_write_full(int fd, const void* buf, size_t n) {
+    const char* p = (const char*)buf;
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return -1;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+int net_link_connect(const char* host, const char* port, int timeout_ms, const char** err) {
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0 || !res) {
+        *err = "cannot resolve host";
+        return -1;
+    }
+
+    int fd = -1;
+    for (int waited = 0;; waited += 100) {
+        int refused = 0;
+        for (struct addrinfo* ai = res; ai && fd < 0; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+                refused |= (errno == ECONNREFUSED);
+                close(fd);
+                fd = -1;
+            }
+        }
+        // the receiver may still be starting: retry refused connections
+        if (fd >= 0 || !refused || waited >= timeout_ms) break;
+        struct timespec ts = { 0, 100 * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    freeaddrinfo(res);
+    if (fd < 0) {
+        *err = "connect failed";
+        return -1;
+    }
+    int one = 1; // frames are already batched, never wait for more
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+int net_link_listen(const char* spec, const char** err) {
+    // "PORT" stays on the loopback interface: the link is plaintext and
+    // unauthenticated, so listening beyond it takes an explicit address
+    char host[256] = "127.0.0.1";
+    const char* port = spec;
+    if (spec[0] == '[') { // "[IPv6]:PORT"
+        const char* close_br = strchr(spec, ']');
+        size_t n = close_br ? (size_t)(close_br - spec - 1) : 0;
+        if (!close_br || close_br[1] != ':' || n == 0 || n >= sizeof(host)) { *err = "invalid address"; return -1; }
+        memcpy(host, spec + 1, n);
+        host[n] = '\0';
+        port = close_br + 2;
+    } else if (strchr(spec, ':')) {
+        const char* colon = strrchr(spec, ':');
+        size_t n = (size_t)(colon - spec);
+        if (n == 0 || n >= sizeof(host) || memchr(spec, ':', n)) {
+            *err = "invalid address (write IPv6 addresses as [ADDR]:PORT)";
+            return -1;
+        }
+        memcpy(host, spec, n);
+        host[n] = '\0';
+        port = colon + 1;
+    }
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    if (!port[0] || getaddrinfo(host, port, &hints, &res) != 0 || !res) {
+        *err = "invalid address or port";
+        return -1;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype | SOCK_CLOEXEC, res->ai_protocol);
+    int one = 1;
+    if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (fd < 0 || bind(fd, res->ai_addr, res->ai_addrlen) != 0 || listen(fd, 1) != 0) {
+        *err = strerror(errno);
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+int net_link_local_port(int fd) {
+    struct sockaddr_storage ss;
+    socklen_t len = sizeof(ss);
+    if (getsockname(fd, (struct sockaddr*)&ss, &len) != 0) return -1;
+    if (ss.ss_family == AF_INET) return ntohs(((struct sockaddr_in*)&ss)->sin_port);
+    if (ss.ss_family == AF_INET6) return ntohs(((struct sockaddr_in6*)&ss)->sin6_port);
+    return -1;
+}
+
+int net_link_grant(int fd, uint32_t n) {
+    uint32_t be = htonl(n);
+    return net_link_write_full(fd, &be, sizeof(be));
+}
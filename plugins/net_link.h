@@ -0,0 +1,57 @@
+#ifndef NET_LINK_H
+#define NET_LINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+* TCP stage boundary shared by the netsend plugin (sender) and the
+* analyzer's --input=tcp: receiver.
+*
+* Sender to receiver, batch frames (all integers big-endian):
+*   u32 payload_bytes, u32 item_count, then item_count times
+*   u32 len, u32 flags, len bytes (no NUL)
+* flags carries CP_ITEM_* fragment bits, or NET_LINK_END for <END>.
+*
+* Receiver to sender, credit frames: u32 items. The receiver grants its
+* window up front and returns one credit per item it has placed into its
+* first stage, so a full receiving queue stops the sender.
+*/
+
+#define NET_LINK_END         0x80000000u
+#define NET_LINK_MAX_FRAME   (16u << 20) // payload bytes per batch frame
+#define NET_LINK_ITEM_HEADER 8u
+
+// Read or write exactly n bytes. Returns 0, or -1 on error / peer closed.
+int net_link_read_full(int fd, void* buf, size_t n);
+int net_link_write_full(int fd, const void* buf, size_t n);
+
+/**
+* Connect to host:port, retrying while nobody listens yet
+* @param timeout_ms How long to keep retrying refused connections
+* @param err Set to a static message on failure
+* @return Connected socket, -1 on failure
+*/
+int net_link_connect(const char* host, const char* port, int timeout_ms, const char** err);
+
+/**
+* Listen on "PORT" (loopback only), "ADDR:PORT" or "[IPv6]:PORT". Other
+* hosts can only connect when ADDR says so, e.g. 0.0.0.0 or [::].
+* Port 0 picks a free port, see net_link_local_port.
+* @return Listening socket, -1 on failure with *err set
+*/
+int net_link_listen(const char* spec, const char** err);
+
+/**
+* Port a listening socket is bound to
+* @return Port number, -1 on failure
+*/
+int net_link_local_port(int fd);
+
+/**
+* Send one credit frame granting n items
+* @return 0, or -1 if the sender is gone
+*/
+int net_link_grant(int fd, uint32_t n);
+
+#endif // NET_LINK_H
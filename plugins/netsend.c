@@ -0,0 +1,133 @@
+#include "plugin_common.h"
+#include "log_ring.h"
+#include "net_link.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Sends every record to an analyzer on another host (--input=tcp:PORT) in
+// batch frames, spending one credit per record, then passes it on unchanged
+#define NETSEND_CONNECT_MS 5000
+
+static int      g_fd = -1;
+static uint32_t g_credits;        // records the receiver can still take
+static char*    g_batch;          // frame being filled, header included
+static size_t   g_batch_len;
+static size_t   g_batch_cap;
+static uint32_t g_batch_items;
+static unsigned g_batch_max = 64; // records per frame
+static int      g_failed;         // link lost, later records are dropped
+
+static void fail(const char* what) {
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%s, dropping further records", what);
+    log_ring_write("ERROR", "netsend", msg);
+    g_failed = 1;
+}
+
+static int flush_batch(void) {
+    if (g_batch_items == 0) return 0;
+    uint32_t hdr[2] = { htonl((uint32_t)(g_batch_len - 8)), htonl(g_batch_items) };
+    memcpy(g_batch, hdr, sizeof(hdr));
+    int rc = net_link_write_full(g_fd, g_batch, g_batch_len);
+    g_batch_len = 8;
+    g_batch_items = 0;
+    return rc;
+}
+
+// Block until the receiver has room for one more record
+static int take_credit(void) {
+    while (g_credits == 0) {
+        if (flush_batch() != 0) return -1; // what we hold may be what it waits for
+        uint32_t be;
+        if (net_link_read_full(g_fd, &be, sizeof(be)) != 0) return -1;
+        g_credits += ntohl(be);
+    }
+    g_credits--;
+    return 0;
+}
+
+static int append(const char* s, uint32_t flags) {
+    size_t len = strlen(s);
+    size_t need = NET_LINK_ITEM_HEADER + len;
+    if (need > NET_LINK_MAX_FRAME) return -1;
+    if (g_batch_len - 8 + need > NET_LINK_MAX_FRAME && flush_batch() != 0) return -1;
+    if (g_batch_len + need > g_batch_cap) {
+        size_t cap = g_batch_cap ? g_batch_cap : 4096;
+        while (cap < g_batch_len + need) cap *= 2;
+        char* p = (char*)realloc(g_batch, cap);
+        if (!p) return -1;
+        g_batch = p;
+        g_batch_cap = cap;
+    }
+    uint32_t hdr[2] = { htonl((uint32_t)len), htonl(flags) };
+    memcpy(g_batch + g_batch_len, hdr, sizeof(hdr));
+    memcpy(g_batch + g_batch_len + NET_LINK_ITEM_HEADER, s, len);
+    g_batch_len += need;
+    g_batch_items++;
+    return 0;
+}
+
+const char* plugin_transform(const char* input) {
+    if (!input) return NULL;
+    if (g_fd < 0 || g_failed) return input;
+
+    if (take_credit() != 0) {
+        fail("receiver closed the link");
+    } else if (append(input, common_plugin_item_flags()) != 0) {
+        fail("record too large or out of memory");
+    } else if ((g_batch_items >= g_batch_max || common_plugin_backlog() == 0) && flush_batch() != 0) {
+        // full frame, or nothing else queued behind this record: send now
+        fail("send failed");
+    }
+    return input; // passthrough
+}
+
+// Called once <END> arrives: send it, then wait for the receiver to hang up
+static void send_end(void) {
+    if (g_fd < 0) return;
+    if (!g_failed && (append("<END>", NET_LINK_END) != 0 || flush_batch() != 0)) fail("send failed");
+    shutdown(g_fd, SHUT_WR);
+    char buf[64];
+    while (recv(g_fd, buf, sizeof(buf), 0) > 0) { } // leftover credits, then EOF
+    close(g_fd);
+    g_fd = -1;
+    free(g_batch);
+    g_batch = NULL;
+    g_batch_cap = 0;
+}
+
+const char* plugin_init(int queue_size) {
+    const char* host  = common_plugin_option("host");
+    const char* port  = common_plugin_option("port");
+    const char* batch = common_plugin_option("batch");
+    if (!port) return "netsend needs port=PORT";
+    if (batch) {
+        char* endp = NULL;
+        errno = 0;
+        unsigned long v = strtoul(batch, &endp, 10);
+        if (endp == batch || *endp != '\0' || errno == ERANGE || v == 0 || v > 65536) return "invalid batch";
+        g_batch_max = (unsigned)v;
+    }
+
+    const char* err = NULL;
+    g_fd = net_link_connect(host ? host : "127.0.0.1", port, NETSEND_CONNECT_MS, &err);
+    if (g_fd < 0) return err;
+    g_credits = 0;
+    g_failed = 0;
+    g_batch_len = 8; // room for the frame header
+    g_batch_items = 0;
+
+    err = common_plugin_init_ex(plugin_transform, "netsend", queue_size, PLUGIN_FLAG_CHUNKS);
+    if (err) {
+        close(g_fd);
+        g_fd = -1;
+        return err;
+    }
+    common_plugin_set_end_hook(send_end);
+    return NULL;
+}
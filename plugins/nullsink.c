@@ -0,0 +1,33 @@
+#include "plugin_common.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+// Counts what reaches it and nothing else, for load tests of the stages in front
+static uint64_t g_items;
+static uint64_t g_bytes;
+
+const char* plugin_transform(const char* input) {
+    if (!input) return NULL;
+
+    if (!(common_plugin_item_flags() & CP_ITEM_MORE)) g_items++; // count a chunked record once
+    g_bytes += strlen(input);
+    return input; // passthrough, no output
+}
+
+// Called once <END> arrives. The summary is not a record: with nul or
+// len32 framing it goes to stderr so stdout stays a clean record stream.
+static void print_summary(void) {
+    FILE* out = common_plugin_framing() == PLUGIN_FRAMING_LINE ? stdout : stderr;
+    fprintf(out, "[nullsink] items=%" PRIu64 " bytes=%" PRIu64 "\n", g_items, g_bytes);
+    fflush(out);
+}
+
+const char* plugin_init(int queue_size) {
+    g_items = 0;
+    g_bytes = 0;
+    const char* err = common_plugin_init_ex(plugin_transform, "nullsink", queue_size, PLUGIN_FLAG_CHUNKS);
+    if (err) return err;
+    common_plugin_set_end_hook(print_summary);
+    return NULL;
+}
@@ -1,79 +1,511 @@
 #include "plugin_common.h"
+#include "log_ring.h"
 #include <stdio.h> // printf/fprintf
 #include <string.h> // string manipulation functions
 #include <stdlib.h> // malloc/free
+#include <errno.h>  // option parsing
+#include <inttypes.h> // PRIu64 for stats
+#include <time.h>     // direct handoff pacing, busy time
+#include <stdint.h>   // intptr_t slot numbers
 
 
 static const char* k_default_plugin_name = "unknown";
 
+// address of PLUGIN_DROP, private to each plugin's copy of the SDK
+__attribute__((visibility("hidden"))) const char plugin_drop_marker[1] = "";
+
 // single instance per plugin
 static plugin_context_t g_context_instance; // global plugin context instance, (zero initialized)
 
+// composed kernel when this stage hosts a fused run (see plugin_fuse)
+static chain_kernel_t g_fused_kernel;
+static int g_fused;
+static char g_fused_name[128];
+
+// host tracer (see plugin_set_tracer), NULL when tracing is off
+static const trace_hook_t* g_tracer;
+
+// host memory limits (see plugin_set_budget)
+static mem_budget_t* g_shared_budget;
+static size_t g_default_queue_bytes;
+
+// single-thread engine requested by the host (see plugin_set_inline)
+static int g_inline;
+
+// direct handoff requested by the host (see plugin_set_latency)
+static int g_latency;
+
+// record framing requested by the host (see plugin_set_framing)
+static int g_framing;
+
+// CP_ITEM_* of the item the calling thread is transforming (replicas run
+// transforms side by side)
+static __thread unsigned t_item_flags;
+
+// replica_state per slot of plugin_context_t
+enum { REPLICA_NONE = 0, REPLICA_RUNNING, REPLICA_EXITED };
+
+// ticket of an item served outside the consumer threads (inline engine,
+// direct handoff), which needs no ordering
+#define NO_TICKET UINT64_MAX
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// While the host samples load, busy_ns adds up the time spent in the
+// stage's own code (transform or emit) only, not waiting for a turn or for
+// room downstream, so a stage held up by its successor does not look busy
+static uint64_t busy_start(const plugin_context_t* ctx) {
+    return __atomic_load_n(&ctx->sample_busy, __ATOMIC_RELAXED) ? now_ns() : 0;
+}
+
+static void busy_stop(plugin_context_t* ctx, uint64_t t0) {
+    if (t0) __atomic_fetch_add(&ctx->busy_ns, now_ns() - t0, __ATOMIC_RELAXED);
+}
+
+static const char* fused_transform(const char* input) {
+    return chain_kernel_apply(&g_fused_kernel, input);
+}
+
 // one global print mutex per .so to keep stdout messages safe
 //static pthread_mutex_t g_print_mutex = PTHREAD_MUTEX_INITIALIZER; 
 
+// Small internal helper: duplicate a C string without using strdup 
+static char* dup_cstr(const char* s) {
+    if (!s) return NULL;
+    size_t n = strlen(s);
+    char* p = (char*)malloc(n + 1);
+    if (!p) return NULL;
+    memcpy(p, s, n + 1);  // includes the '\0'
+    return p;
+}
 
-void* plugin_consumer_thread(void* arg) {
-    plugin_context_t* ctx = (plugin_context_t*)arg;
+// Release every stored option (safe to call repeatedly)
+static void free_options(plugin_context_t* ctx) {
+    for (int i = 0; i < ctx->option_count; ++i) {
+        free(ctx->options[i].key);
+        free(ctx->options[i].value);
+        ctx->options[i] = (plugin_option_t){0};
+    }
+    ctx->option_count = 0;
+}
 
-    for (;;) {
-        char* s = consumer_producer_get(ctx->queue);
-        if (!s) break; // finished+empty
+// Wait while the stage is paused, then take the downstream target for one
+// handoff. plugin_pause returns only when no handoff is in flight.
+// *next_meta and *next_batch receive the metadata-aware and batch targets,
+// if the downstream has them.
+static const char* (*begin_handoff(plugin_context_t* ctx, plugin_place_work_meta_fn* next_meta,
+                                   plugin_place_work_batch_fn* next_batch))(const char*) {
+    if (ctx->inline_mode) { // one thread: nobody pauses or rewires the stage
+        if (next_meta) *next_meta = ctx->next_place_work ? ctx->next_place_work_meta : NULL;
+        if (next_batch) *next_batch = ctx->next_place_work ? ctx->next_place_work_batch : NULL;
+        return ctx->next_place_work;
+    }
+    pthread_mutex_lock(&ctx->lock_state);
+    while (ctx->paused) {
+        pthread_cond_wait(&ctx->state_cond, &ctx->lock_state);
+    }
+    ctx->in_handoff = 1;
+    const char* (*next_fn)(const char*) = ctx->next_place_work;
+    if (next_meta) *next_meta = next_fn ? ctx->next_place_work_meta : NULL;
+    if (next_batch) *next_batch = next_fn ? ctx->next_place_work_batch : NULL;
+    pthread_mutex_unlock(&ctx->lock_state);
+    return next_fn;
+}
+
+static void end_handoff(plugin_context_t* ctx) {
+    if (ctx->inline_mode) return;
+    pthread_mutex_lock(&ctx->lock_state);
+    ctx->in_handoff = 0;
+    pthread_cond_broadcast(&ctx->state_cond);
+    pthread_mutex_unlock(&ctx->lock_state);
+}
 
-        if (strcmp(s, "<END>") == 0) {
-            free(s);
+// Apply the stage transform, consulting the result cache for pure stages.
+// *out_cached is set when the result belongs to the cache (caller must not free it).
+static const char* run_transform(plugin_context_t* ctx, char* s, int* out_cached) {
+    *out_cached = 0;
+    if (!ctx->process_function) return s;
+    if (!ctx->cache || (t_item_flags & (CP_ITEM_MORE | CP_ITEM_CONT))) {
+        return ctx->process_function(s); // fragments bypass the cache
+    }
+
+    size_t len = strlen(s);
+    uint64_t h = memo_hash(s, len);
+    const char* hit = memo_cache_lookup(ctx->cache, s, len, h);
+    if (hit) {
+        *out_cached = 1;
+        return hit;
+    }
+
+    const char* out = ctx->process_function(s);
+    if (out && out != PLUGIN_DROP && memo_cache_insert(ctx->cache, s, len, h, out == s ? NULL : (char*)out) == 0) {
+        *out_cached = (out != s);
+    }
+    return out;
+}
 
-            
-            const char* (*next_fn)(const char*) = NULL;
-            pthread_mutex_lock(&ctx->lock_state);
-            if (!ctx->end_pushed) {
-                ctx->end_pushed = 1;
-                next_fn = ctx->next_place_work;
+// Collect the fragments of a record for a stage without PLUGIN_FLAG_CHUNKS.
+// Takes ownership of frag. Returns the whole record (caller frees) once its
+// last fragment arrived, NULL while more are expected.
+static char* reassemble(plugin_context_t* ctx, char* frag, unsigned flags) {
+    if (!(flags & CP_ITEM_CONT)) { // a new record starts
+        ctx->reasm_len = 0;
+        ctx->reasm_failed = 0;
+    }
+    size_t n = strlen(frag);
+    if (!ctx->reasm_failed && ctx->reasm_len + n + 1 > ctx->reasm_cap) {
+        size_t cap = ctx->reasm_cap ? ctx->reasm_cap : 256;
+        while (cap < ctx->reasm_len + n + 1) cap *= 2;
+        char* grown = (char*)realloc(ctx->reasm, cap);
+        if (!grown) {
+            log_error(ctx, "record too large to reassemble, dropped");
+            ctx->reasm_failed = 1;
+        } else {
+            ctx->reasm = grown;
+            ctx->reasm_cap = cap;
+        }
+    }
+    if (!ctx->reasm_failed) {
+        memcpy(ctx->reasm + ctx->reasm_len, frag, n + 1);
+        ctx->reasm_len += n;
+    }
+    free(frag);
+    if ((flags & CP_ITEM_MORE) || ctx->reasm_failed) return NULL;
+
+    // hand the buffer over, the next record starts a fresh one
+    char* whole = ctx->reasm;
+    ctx->reasm = NULL;
+    ctx->reasm_len = ctx->reasm_cap = 0;
+    return whole;
+}
+
+// One input of an emitting stage: collect its outputs, then hand them over
+// in one batch (or one by one when the next stage takes no batches)
+static void run_emit(plugin_context_t* ctx, const char* s, cp_item_meta_t* meta, const trace_hook_t* tr,
+                     uint64_t t_got) {
+    plugin_emitter_t* em = &ctx->emitter;
+    em->len = 0;
+    em->count = 0;
+    uint64_t t_busy = busy_start(ctx);
+    const char* err = ctx->emit_function(s, em);
+    busy_stop(ctx, t_busy);
+    if (err) log_error(ctx, err);
+    if (t_got) tr->span(ctx->name, "transform", meta->trace_id, t_got, tr->now_ns());
+
+    plugin_place_work_meta_fn next_meta = NULL;
+    plugin_place_work_batch_fn next_batch = NULL;
+    const char* (*next_fn)(const char*) = begin_handoff(ctx, &next_meta, &next_batch);
+    if (next_fn && em->count) {
+        uint64_t t_put = 0;
+        if (tr) {
+            tr->set_current(meta->trace_id);
+            if (meta->trace_id) t_put = tr->now_ns();
+        }
+        // emitted pieces are whole records, and data even when one reads "<END>"
+        cp_item_meta_t m = *meta;
+        m.flags = CP_ITEM_DATA;
+        const char* nerr = NULL;
+        if (next_batch) {
+            nerr = next_batch(em->buf, em->count, &m);
+        } else {
+            const char* p = em->buf;
+            for (size_t i = 0; i < em->count && !nerr; ++i) {
+                nerr = next_meta ? next_meta(p, &m) : next_fn(p);
+                p += strlen(p) + 1;
             }
-            pthread_mutex_unlock(&ctx->lock_state);
+        }
+        if (t_put) tr->span(ctx->name, "put", meta->trace_id, t_put, tr->now_ns());
+        if (nerr) log_error(ctx, nerr);
+    }
+    if (next_fn && em->columns) {
+        cp_item_meta_t m = *meta;
+        m.flags |= CP_ITEM_COLUMNS;
+        if (tr) tr->set_current(meta->trace_id);
+        const char* nerr = next_meta ? next_meta((const char*)em->columns, &m)
+                                     : "next stage cannot take column batches";
+        if (nerr) log_error(ctx, nerr);
+    }
+    end_handoff(ctx);
+    free(em->columns);
+    em->columns = NULL;
+}
 
-            if (next_fn) (void)next_fn("<END>");
+// A column batch for a stage without PLUGIN_FLAG_COLUMNS: serve each record
+// as a whole record of its own, in order. Takes ownership of batch.
+static int serve_item(plugin_context_t* ctx, char* s, cp_item_meta_t* meta, const trace_hook_t* tr,
+                      uint64_t ticket);
 
-            // Signal that the consumer is finished
-            consumer_producer_signal_finished(ctx->queue);
-            break;
+static void serve_rows(plugin_context_t* ctx, char* batch, const cp_item_meta_t* meta, const trace_hook_t* tr) {
+    const cp_columns_t* b = (const cp_columns_t*)batch;
+    for (uint32_t r = 0; r < b->rows; ++r) {
+        char* row = dup_cstr(cp_columns_row(b, r));
+        cp_item_meta_t m = {0};
+        m.flags = CP_ITEM_DATA; // a row reading "<END>" is not the sentinel
+        m.trace_id = meta->trace_id;
+        m.enqueued_ns = meta->enqueued_ns;
+        if (!row) {
+            log_error(ctx, "alloc failed for a batch record");
+            continue;
         }
+        (void)serve_item(ctx, row, &m, tr, NO_TICKET);
+    }
+    free(batch);
+}
 
-        // Transform
-        const char* out = ctx->process_function ? ctx->process_function(s) : s;
-        if (ctx->process_function && out == NULL) log_error(ctx, "transform failed");
+static void report_stats(plugin_context_t* ctx);
 
+// Replicas transform side by side but hand off in queue order: wait until
+// every earlier item has gone downstream. Returns at once for a lone thread.
+static void wait_turn(plugin_context_t* ctx, uint64_t ticket) {
+    if (ticket == NO_TICKET || __atomic_load_n(&ctx->next_out, __ATOMIC_SEQ_CST) == ticket) return;
+    pthread_mutex_lock(&ctx->lock_state);
+    __atomic_fetch_add(&ctx->turn_waiters, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&ctx->next_out, __ATOMIC_SEQ_CST) != ticket) {
+        pthread_cond_wait(&ctx->turn_cond, &ctx->lock_state);
+    }
+    __atomic_fetch_sub(&ctx->turn_waiters, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&ctx->lock_state);
+}
 
-        // Get the next function under lock to avoid race conditions with attach
-        const char* (*next_fn)(const char*) = NULL;
+// The item with this ticket is done (handed off, dropped or absorbed)
+static void pass_turn(plugin_context_t* ctx, uint64_t ticket) {
+    if (ticket == NO_TICKET) return;
+    __atomic_store_n(&ctx->next_out, ticket + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ctx->turn_waiters, __ATOMIC_SEQ_CST)) { // waiters count up before checking
         pthread_mutex_lock(&ctx->lock_state);
-        next_fn = ctx->next_place_work;
+        pthread_cond_broadcast(&ctx->turn_cond);
         pthread_mutex_unlock(&ctx->lock_state);
+    }
+}
+
+// Serve control-lane requests. Returns 1 when the stage must stop now.
+static int handle_control(plugin_context_t* ctx, unsigned ctl) {
+    if (ctl & CP_CTL_SPILL_ERROR) { // the item stays spilled, the next get retries it
+        log_error(ctx, "spill replay failed: out of memory, retrying");
+        struct timespec ts = { 0, 10 * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    if (ctl & CP_CTL_STATS) report_stats(ctx);
+    if (ctl & CP_CTL_FLUSH) {
+        fflush(stdout);
+        fflush(stderr);
+    }
+    if (!(ctl & CP_CTL_STOP)) return 0;
+
+    // immediate stop: the queue already discarded its items; drop any
+    // half-reassembled record and end without forwarding <END>
+    ctx->reasm_len = 0;
+    pthread_mutex_lock(&ctx->lock_state);
+    ctx->end_pushed = 1;
+    pthread_mutex_unlock(&ctx->lock_state);
+    consumer_producer_signal_finished(ctx->queue);
+    return 1;
+}
+
+// One item taken from the queue: transform (or emit) it and hand the result
+// downstream once its ticket's turn has come (the caller passes the turn
+// afterwards). Takes ownership of s. Returns 1 once <END> went through.
+static int serve_item(plugin_context_t* ctx, char* s, cp_item_meta_t* meta, const trace_hook_t* tr,
+                      uint64_t ticket) {
+    // sampled items: time spent queued, then this stage's own spans
+    uint64_t t_got = (tr && meta->trace_id) ? tr->now_ns() : 0;
+    if (t_got) tr->async_span(ctx->name, "wait", meta->trace_id, meta->enqueued_ns, t_got);
 
-        if (next_fn && out) { // if there is a next function and output is valid- transform it
-            const char* nerr = next_fn(out);
-            if (nerr) log_error(ctx, nerr);
+    if (meta->flags == 0 && strcmp(s, "<END>") == 0) {
+        wait_turn(ctx, ticket); // after everything queued before it
+        free(s);
+        if (ctx->end_hook) ctx->end_hook();
+        if (ctx->emit_function) { // last call: a stateful stage emits what it holds
+            cp_item_meta_t none = {0};
+            run_emit(ctx, NULL, &none, NULL, 0);
         }
 
+        
+        const char* (*next_fn)(const char*) = begin_handoff(ctx, NULL, NULL);
+        pthread_mutex_lock(&ctx->lock_state);
+        if (ctx->end_pushed) next_fn = NULL;
+        ctx->end_pushed = 1;
+        pthread_mutex_unlock(&ctx->lock_state);
 
-        // memory management, s is always ours (from the queue) ,always free at the end of the round
-        // out: assuming the transform allocates new when it changes, can free after sending/if no next
-        if (out != s) {
-            free(s);
-            if (out) free((void*)out);
-        } else {
-            free(s);
+        if (next_fn) (void)next_fn("<END>");
+        end_handoff(ctx);
+
+        // Signal that the consumer is finished
+        consumer_producer_signal_finished(ctx->queue);
+        return 1;
+    }
+
+    // A stage that cannot take column batches sees their records one by one
+    if ((meta->flags & CP_ITEM_COLUMNS) && !(ctx->flags & PLUGIN_FLAG_COLUMNS)) {
+        wait_turn(ctx, ticket); // the records go downstream before later items
+        serve_rows(ctx, s, meta, tr);
+        return 0;
+    }
+
+    // A stage that cannot take fragments sees whole records
+    if ((meta->flags & (CP_ITEM_MORE | CP_ITEM_CONT)) && !(ctx->flags & PLUGIN_FLAG_CHUNKS)) {
+        wait_turn(ctx, ticket); // one record at a time, fragments in order
+        s = reassemble(ctx, s, meta->flags);
+        if (!s) return 0;
+        meta->flags &= CP_ITEM_DATA; // a whole record again
+    }
+    t_item_flags = meta->flags;
+
+    if (ctx->emit_function) {
+        wait_turn(ctx, ticket);
+        run_emit(ctx, s, meta, tr, t_got);
+        free(s);
+        return 0;
+    }
+
+    // Transform
+    int out_cached = 0;
+    uint64_t t_busy = busy_start(ctx);
+    const char* out = run_transform(ctx, s, &out_cached);
+    busy_stop(ctx, t_busy);
+    if (ctx->process_function && out == NULL) log_error(ctx, "transform failed");
+    if (out == PLUGIN_DROP) {
+        __atomic_fetch_add(&ctx->dropped, 1, __ATOMIC_RELAXED);
+        out = NULL; // filtered out: nothing goes downstream
+    }
+    if (t_got) tr->span(ctx->name, "transform", meta->trace_id, t_got, tr->now_ns());
+
+
+    // Get the next function under lock to avoid race conditions with attach
+    wait_turn(ctx, ticket);
+    plugin_place_work_meta_fn next_meta = NULL;
+    const char* (*next_fn)(const char*) = begin_handoff(ctx, &next_meta, NULL);
+
+    if (next_fn && out) { // if there is a next function and output is valid- transform it
+        uint64_t t_put = 0;
+        if (tr) {
+            tr->set_current(meta->trace_id); // seen by a downstream place_work without meta
+            if (meta->trace_id) t_put = tr->now_ns();
         }
+        const char* nerr = next_meta ? next_meta(out, meta) : next_fn(out);
+        if (t_put) tr->span(ctx->name, "put", meta->trace_id, t_put, tr->now_ns());
+        if (nerr) log_error(ctx, nerr);
     }
+    end_handoff(ctx);
 
-    
+
+    // memory management, s is always ours (from the queue) ,always free at the end of the round
+    // out: assuming the transform allocates new when it changes, can free after sending/if no next
+    // (unless the result cache owns it)
+    if (out != s && out && !out_cached) free((void*)out);
+    free(s);
+    return 0;
+}
+
+static void mark_finished(plugin_context_t* ctx) {
     pthread_mutex_lock(&ctx->lock_state);
     ctx->finished = 1;
     pthread_mutex_unlock(&ctx->lock_state);
     monitor_signal(&ctx->finished_monitor);
+}
+
+// A consumer thread leaves the stage: when the stage ends, or, with
+// only_if_surplus, when its slot is above the thread target (returns 0 and
+// stays if it is not). The last thread to leave marks the stage finished.
+static int thread_leave(plugin_context_t* ctx, int slot, int only_if_surplus) {
+    pthread_mutex_lock(&ctx->lock_state);
+    if (only_if_surplus && slot < ctx->threads_target) {
+        pthread_mutex_unlock(&ctx->lock_state);
+        return 0;
+    }
+    int last = (--ctx->threads_live == 0);
+    if (slot > 0) ctx->replica_state[slot] = REPLICA_EXITED;
+    pthread_mutex_unlock(&ctx->lock_state);
+    if (last) mark_finished(ctx);
+    return 1;
+}
+
+// Body of the consumer thread (slot 0) and of its replicas
+static void consumer_loop(plugin_context_t* ctx, int slot) {
+    const trace_hook_t* tr = g_tracer;
+    if (tr) tr->name_thread(ctx->name);
+
+    for (;;) {
+        cp_item_meta_t meta;
+        unsigned ctl = 0;
+        uint64_t ticket = 0;
+        char* s = consumer_producer_get_seq(ctx->queue, &meta, &ctl, &ticket);
+        if (ctl) { // control lane, served before the next data item
+            if (handle_control(ctx, ctl)) break;
+            continue;
+        }
+        if (!s) break; // finished+empty
+
+        int ended = serve_item(ctx, s, &meta, tr, ticket);
+        pass_turn(ctx, ticket);
+        if (ended) break;
+
+        // scaled down: replicas above the target retire between items
+        if (slot > 0 && slot >= __atomic_load_n(&ctx->threads_target, __ATOMIC_RELAXED) &&
+            thread_leave(ctx, slot, 1)) {
+            return;
+        }
+    }
+    thread_leave(ctx, slot, 0);
+}
+
+void* plugin_consumer_thread(void* arg) {
+    consumer_loop((plugin_context_t*)arg, 0);
     return NULL;
 }
 
+static void* replica_thread(void* arg) {
+    consumer_loop(&g_context_instance, (int)(intptr_t)arg);
+    return NULL;
+}
+
+// Inline engine: serve what is queued on the calling thread, until the queue
+// is empty (the stage yields to its producer) or the stage has ended. The
+// next stage runs inside the handoff, so a chain is served depth first.
+static void run_inline(plugin_context_t* ctx) {
+    if (ctx->inline_running || ctx->finished) return;
+    ctx->inline_running = 1;
+    for (;;) {
+        cp_item_meta_t meta;
+        unsigned ctl = 0;
+        char* s = consumer_producer_pop_inline(ctx->queue, &meta, &ctl);
+        if (ctl) {
+            if (handle_control(ctx, ctl)) {
+                mark_finished(ctx);
+                break;
+            }
+            continue;
+        }
+        if (!s) break;
+        if (serve_item(ctx, s, &meta, g_tracer, NO_TICKET)) {
+            mark_finished(ctx);
+            break;
+        }
+    }
+    ctx->inline_running = 0;
+}
+
+// Latency mode: claim an idle stage so the producer's thread serves items
+// itself. The producer backs off while its last handoff took longer than the
+// time it has spent elsewhere since, so under load items go to the consumer
+// thread again. Returns 1 with *start set if count items were claimed;
+// finish with end_direct.
+static int begin_direct(plugin_context_t* ctx, size_t count, uint64_t* start) {
+    *start = now_ns();
+    if (*start - ctx->direct_end_ns < ctx->direct_cost_ns) return 0;
+    return consumer_producer_try_claim(ctx->queue, count);
+}
+
+static void end_direct(plugin_context_t* ctx, uint64_t start) {
+    consumer_producer_release_claim(ctx->queue);
+    ctx->direct_end_ns = now_ns();
+    ctx->direct_cost_ns = ctx->direct_end_ns - start;
+}
+
 const char* plugin_get_name(void) {
     plugin_context_t* ctx = &g_context_instance;
     if (!ctx || !ctx->initialized || !ctx->name || ctx->name[0] == '\0') {
@@ -85,45 +517,141 @@ void log_error(plugin_context_t* context, const char* message) {
     const char* name = (context && context->name) ? context->name : plugin_get_name();
     const char* msg  = message ? message : "(null)";
 
-    fprintf(stderr, "[ERROR][%s] - %s\n", name, msg);
-    fflush(stderr);
-  
-
+    log_ring_write("ERROR", name, msg);
 }
 
 void log_info(plugin_context_t* context, const char* message) {
     const char* name = (context && context->name) ? context->name : plugin_get_name();
     const char* msg  = message ? message : "(null)";
 
-   
-    fprintf(stderr, "[INFO][%s] - %s\n", name, msg);
-    fflush(stderr);
-  
+    log_ring_write("INFO", name, msg);
 }
 
 const char* common_plugin_init(const char* (*process_function)(const char*), const char* name, int queue_size) {
-    // 1) Basic validation
+    return common_plugin_init_ex(process_function, name, queue_size, 0);
+}
+
+static const char* init_stage(const char* (*process_function)(const char*), plugin_emit_fn emit_function,
+                              const char* name, int queue_size, unsigned flags);
+
+const char* common_plugin_init_ex(const char* (*process_function)(const char*), const char* name, int queue_size,
+                                  unsigned flags) {
     if (process_function == NULL) return "process_function is NULL";
-    if (queue_size <= 0)          return "invalid queue_size";
+    return init_stage(process_function, NULL, name, queue_size, flags);
+}
+
+const char* common_plugin_init_emit(plugin_emit_fn emit_function, const char* name, int queue_size,
+                                    unsigned flags) {
+    if (emit_function == NULL)     return "emit_function is NULL";
+    if (flags & PLUGIN_FLAG_CHUNKS) return "emitting stages take whole records";
+    return init_stage(NULL, emit_function, name, queue_size, flags);
+}
+
+static const char* init_stage(const char* (*process_function)(const char*), plugin_emit_fn emit_function,
+                              const char* name, int queue_size, unsigned flags) {
+    // 1) Basic validation
+    if (queue_size < 0)           return "invalid queue_size";
     if (g_context_instance.initialized) return "already initialized";
     if (name == NULL || strcmp(name, "") == 0) return "name is invalid";
 
+    // 1b) Common stage options (plugin-specific ones were consumed already)
+    cp_overflow_policy_t policy = CP_OVERFLOW_BLOCK;
+    unsigned long sample_every = 10;
+    size_t byte_budget = g_default_queue_bytes;
+    const char* opt = common_plugin_option("overflow");
+    if (opt && consumer_producer_parse_policy(opt, &policy) != 0) return "invalid overflow policy";
+    opt = common_plugin_option("sample");
+    if (opt) {
+        char* endp = NULL;
+        errno = 0;
+        sample_every = strtoul(opt, &endp, 10);
+        if (endp == opt || *endp != '\0' || errno == ERANGE || sample_every == 0 || sample_every > UINT32_MAX) {
+            return "invalid sample rate";
+        }
+    }
+    opt = common_plugin_option("budget");
+    if (opt && mem_budget_parse_size(opt, &byte_budget) != 0) return "invalid byte budget";
+    if (queue_size == 0 && byte_budget == 0 && !g_shared_budget) return "queue_size 0 requires a byte budget";
+    const char* spill_dir = common_plugin_option("spill");
+    if (spill_dir && spill_dir[0] == '\0') return "invalid spill directory";
+    if (spill_dir && policy != CP_OVERFLOW_BLOCK) return "spill cannot be combined with overflow";
+    if (g_inline && (spill_dir || policy != CP_OVERFLOW_BLOCK)) return "overflow and spill need the threaded engine";
+    unsigned long cache_entries = 0;
+    size_t cache_bytes = 0;
+    opt = common_plugin_option("cache");
+    if (opt) {
+        char* endp = NULL;
+        errno = 0;
+        cache_entries = strtoul(opt, &endp, 10);
+        if (endp == opt || *endp != '\0' || errno == ERANGE || cache_entries == 0 || cache_entries > (1ul << 24)) {
+            return "invalid cache size";
+        }
+        if (!(flags & PLUGIN_FLAG_PURE)) return "cache requires a pure plugin";
+        if (emit_function) return "cache is not available to emitting stages";
+    }
+    opt = common_plugin_option("cache_bytes");
+    if (opt && mem_budget_parse_size(opt, &cache_bytes) != 0) return "invalid cache byte limit";
+    if (opt && !cache_entries) return "cache_bytes requires cache";
+    for (int i = 0; i < g_context_instance.option_count; ++i) {
+        if (!g_context_instance.options[i].used) {
+            snprintf(g_context_instance.error_buf, sizeof(g_context_instance.error_buf),
+                     "unknown option '%s'", g_context_instance.options[i].key);
+            return g_context_instance.error_buf;
+        }
+    }
+
+    // 1c) A fused stage runs the composed kernel under the run's combined name
+    if (g_fused) {
+        process_function = fused_transform;
+        name = g_fused_name;
+        flags = (flags | PLUGIN_FLAG_PURE) & ~(PLUGIN_FLAG_CHUNKS | PLUGIN_FLAG_REENTRANT); // one kernel map cache
+    }
+
     // 2) Put the context in a known state (before any allocations)
     g_context_instance.name            = name ? name : k_default_plugin_name;
+    g_context_instance.flags           = flags;
     g_context_instance.process_function= process_function;
+    g_context_instance.emit_function   = emit_function;
+    g_context_instance.emitter         = (plugin_emitter_t){0};
     g_context_instance.next_place_work = NULL;
 
     g_context_instance.finished        = 0;
     g_context_instance.thread_created  = 0;
     g_context_instance.thread_joined   = 0;
     g_context_instance.end_pushed      = 0;
+    g_context_instance.paused          = 0;
+    g_context_instance.in_handoff      = 0;
+    g_context_instance.dropped         = 0;
+    g_context_instance.inline_mode     = g_inline;
+    g_context_instance.inline_running  = 0;
+    g_context_instance.latency_mode    = g_latency && !g_inline;
+    g_context_instance.direct_end_ns   = 0;
+    g_context_instance.direct_cost_ns  = 0;
+    g_context_instance.threads_target  = 1;
+    g_context_instance.threads_live    = 0;
+    g_context_instance.threads_peak    = 1;
+    g_context_instance.next_out        = 0;
+    g_context_instance.turn_waiters    = 0;
+    g_context_instance.sample_busy     = 0;
+    g_context_instance.busy_ns         = 0;
     g_context_instance.queue           = NULL; // set after successful init
 
     // 3) Init common synchronization
     if (pthread_mutex_init(&g_context_instance.lock_state, NULL) != 0) {
         return "lock_state init failed";
     }
+    if (pthread_cond_init(&g_context_instance.state_cond, NULL) != 0) {
+        pthread_mutex_destroy(&g_context_instance.lock_state);
+        return "state_cond init failed";
+    }
+    if (pthread_cond_init(&g_context_instance.turn_cond, NULL) != 0) {
+        pthread_cond_destroy(&g_context_instance.state_cond);
+        pthread_mutex_destroy(&g_context_instance.lock_state);
+        return "turn_cond init failed";
+    }
     if (monitor_init(&g_context_instance.finished_monitor) != 0) {
+        pthread_cond_destroy(&g_context_instance.turn_cond);
+        pthread_cond_destroy(&g_context_instance.state_cond);
         pthread_mutex_destroy(&g_context_instance.lock_state);
         return "finished_monitor init failed";
     }
@@ -132,6 +660,8 @@ const char* common_plugin_init(const char* (*process_function)(const char*), con
     consumer_producer_t* q = (consumer_producer_t*)malloc(sizeof(*q));
     if (!q) {
         monitor_destroy(&g_context_instance.finished_monitor);
+        pthread_cond_destroy(&g_context_instance.turn_cond);
+        pthread_cond_destroy(&g_context_instance.state_cond);
         pthread_mutex_destroy(&g_context_instance.lock_state);
         return "queue alloc failed";
     }
@@ -139,40 +669,80 @@ const char* common_plugin_init(const char* (*process_function)(const char*), con
     if (qerr != NULL) {
         free(q);
         monitor_destroy(&g_context_instance.finished_monitor);
+        pthread_cond_destroy(&g_context_instance.turn_cond);
+        pthread_cond_destroy(&g_context_instance.state_cond);
         pthread_mutex_destroy(&g_context_instance.lock_state);
         return "queue init failed";
     }
     g_context_instance.queue = q;
+    (void)consumer_producer_set_overflow(q, policy, (unsigned)sample_every, byte_budget);
+    if (g_inline) (void)consumer_producer_set_inline(q); // never full, so budgets do not apply
+    else if (g_shared_budget) (void)consumer_producer_set_shared_budget(q, g_shared_budget);
+    if (g_context_instance.latency_mode) (void)consumer_producer_set_latency(q);
 
-    // 5) Launch the consumer thread for this plugin
-    int rc = pthread_create(&g_context_instance.consumer_thread,
+    // 4a) Optional disk spill taking over while the queue is full
+    if (spill_dir) {
+        const char* serr = NULL;
+        spill_t* spill = spill_create(spill_dir, &serr);
+        if (!spill) {
+            snprintf(g_context_instance.error_buf, sizeof(g_context_instance.error_buf), "spill: %s", serr);
+            consumer_producer_destroy(q);
+            free(q);
+            g_context_instance.queue = NULL;
+            monitor_destroy(&g_context_instance.finished_monitor);
+            pthread_cond_destroy(&g_context_instance.turn_cond);
+            pthread_cond_destroy(&g_context_instance.state_cond);
+            pthread_mutex_destroy(&g_context_instance.lock_state);
+            return g_context_instance.error_buf;
+        }
+        (void)consumer_producer_set_spill(q, spill);
+    }
+
+    // 4b) Optional result cache (pure stages only)
+    if (cache_entries) {
+        memo_cache_t* cache = (memo_cache_t*)malloc(sizeof(*cache));
+        if (!cache || memo_cache_init(cache, (int)cache_entries, cache_bytes) != NULL) {
+            free(cache);
+            consumer_producer_destroy(q);
+            free(q);
+            g_context_instance.queue = NULL;
+            monitor_destroy(&g_context_instance.finished_monitor);
+            pthread_cond_destroy(&g_context_instance.turn_cond);
+            pthread_cond_destroy(&g_context_instance.state_cond);
+            pthread_mutex_destroy(&g_context_instance.lock_state);
+            return "cache init failed";
+        }
+        g_context_instance.cache = cache;
+    }
+
+    // 5) Launch the consumer thread for this plugin (the inline engine has none)
+    g_context_instance.threads_live = g_inline ? 0 : 1; // before it can leave
+    int rc = g_inline ? 0 : pthread_create(&g_context_instance.consumer_thread,
                             NULL,
                             plugin_consumer_thread,
                             &g_context_instance);
     if (rc != 0) {
+        if (g_context_instance.cache) {
+            memo_cache_destroy(g_context_instance.cache);
+            free(g_context_instance.cache);
+            g_context_instance.cache = NULL;
+        }
         consumer_producer_destroy(q);
         free(q);
         g_context_instance.queue = NULL;
         monitor_destroy(&g_context_instance.finished_monitor);
+        pthread_cond_destroy(&g_context_instance.turn_cond);
+        pthread_cond_destroy(&g_context_instance.state_cond);
         pthread_mutex_destroy(&g_context_instance.lock_state);
         return "pthread_create failed";
     }
-    g_context_instance.thread_created = 1;
+    g_context_instance.thread_created = !g_inline;
 
     // 6) Mark as initialized on success
     g_context_instance.initialized = 1;
     return NULL; // success
 }
 
-// Small internal helper: duplicate a C string without using strdup 
-static char* dup_cstr(const char* s) {
-    if (!s) return NULL;
-    size_t n = strlen(s);
-    char* p = (char*)malloc(n + 1);
-    if (!p) return NULL;
-    memcpy(p, s, n + 1);  // includes the '\0'
-    return p;
-}
 
 
 const char* plugin_fini(void) {
@@ -184,6 +754,10 @@ const char* plugin_fini(void) {
         (void)pthread_join(ctx->consumer_thread, NULL);
         ctx->thread_joined = 1;
     }
+    for (int i = 1; i < PLUGIN_MAX_THREADS; ++i) { // replicas end with the queue too
+        if (ctx->replica_state[i] != REPLICA_NONE) (void)pthread_join(ctx->replica_thread[i], NULL);
+        ctx->replica_state[i] = REPLICA_NONE;
+    }
 
     if (ctx->queue) {
         consumer_producer_destroy(ctx->queue);
@@ -191,7 +765,15 @@ const char* plugin_fini(void) {
         ctx->queue = NULL;
     }
 
+    if (ctx->cache) {
+        memo_cache_destroy(ctx->cache);
+        free(ctx->cache);
+        ctx->cache = NULL;
+    }
+
     monitor_destroy(&ctx->finished_monitor);
+    pthread_cond_destroy(&ctx->turn_cond);
+    pthread_cond_destroy(&ctx->state_cond);
     pthread_mutex_destroy(&ctx->lock_state);
 
     
@@ -200,15 +782,40 @@ const char* plugin_fini(void) {
     ctx->thread_created  = 0;
     ctx->end_pushed      = 0;
     ctx->thread_joined   = 0;
+    ctx->paused          = 0;
+    ctx->in_handoff      = 0;
     ctx->next_place_work = NULL;
     ctx->process_function= NULL;
+    ctx->emit_function   = NULL;
+    free(ctx->emitter.buf);
+    free(ctx->emitter.columns);
+    ctx->emitter         = (plugin_emitter_t){0};
+    ctx->next_place_work_batch = NULL;
+    ctx->flags           = 0;
+    ctx->end_hook        = NULL;
+    ctx->next_place_work_meta = NULL;
+    ctx->inline_mode     = 0;
+    ctx->inline_running  = 0;
+    ctx->latency_mode    = 0;
+    ctx->threads_target  = 0;
+    ctx->threads_live    = 0;
+    ctx->sample_busy     = 0;
+    free(ctx->reasm);
+    ctx->reasm           = NULL;
+    ctx->reasm_len       = 0;
+    ctx->reasm_cap       = 0;
+    ctx->reasm_failed    = 0;
+    if (g_fused) chain_kernel_destroy(&g_fused_kernel);
+    g_fused              = 0;
+    free_options(ctx);
+    log_ring_shutdown(); // the consumer thread is gone: flush what it logged
     
 
     return NULL;
 }
 
 
-const char* plugin_place_work(const char* str) {
+static const char* place_work(const char* str, const cp_item_meta_t* in_meta) {
 
     plugin_context_t* ctx = &g_context_instance;
 
@@ -218,13 +825,46 @@ const char* plugin_place_work(const char* str) {
     if (str == NULL)
         return "string is NULL";
 
-    // Copy the string so ownership is clear and safe
-    char* copy = dup_cstr(str);
+    // Copy the string (or column batch) so ownership is clear and safe
+    size_t size = consumer_producer_item_size(str, in_meta);
+    char* copy = (char*)malloc(size);
     if (!copy)
         return "alloc failed";
+    memcpy(copy, str, size);
+
+    // Sampled items carry their trace id, in the metadata or set by the
+    // caller's thread. A fragment that reads "<END>" is data, not the sentinel.
+    int is_end = (!in_meta || in_meta->flags == 0) && strcmp(copy, "<END>") == 0;
+    const trace_hook_t* tr = g_tracer;
+    cp_item_meta_t meta = {0};
+    if (in_meta && !is_end)  meta = *in_meta;
+    else if (tr && !is_end)  meta.trace_id = tr->current();
+    if (!tr) meta.trace_id = 0;
+    uint64_t t_start = meta.trace_id ? tr->now_ns() : 0;
 
-    // Push into the bounded queue (blocks if full, as required)
-    const char* qerr = consumer_producer_put(ctx->queue, copy);
+    // Push into the bounded queue (blocks if full unless the stage sheds load;
+    // the <END> sentinel is never shed), or serve it right here inline
+    if (ctx->inline_mode) {
+        const char* qerr = consumer_producer_push_inline(ctx->queue, copy, &meta);
+        if (t_start) tr->span(ctx->name, "enqueue", meta.trace_id, t_start, tr->now_ns());
+        if (qerr) {
+            free(copy);
+            return qerr;
+        }
+        run_inline(ctx);
+        return NULL;
+    }
+    uint64_t t_direct = 0;
+    if (ctx->latency_mode && begin_direct(ctx, 1, &t_direct)) {
+        if (meta.trace_id) meta.enqueued_ns = t_direct; // traced as served, never queued
+        (void)serve_item(ctx, copy, &meta, tr, NO_TICKET); // <END> finishes the queue, the thread then exits
+        end_direct(ctx, t_direct);
+        return NULL;
+    }
+    const char* qerr = is_end
+                     ? consumer_producer_put_blocking(ctx->queue, copy)
+                     : consumer_producer_put_meta(ctx->queue, copy, &meta);
+    if (t_start) tr->span(ctx->name, "enqueue", meta.trace_id, t_start, tr->now_ns());
     if (qerr != NULL) {
         // On failure, caller keeps ownership; free our copy to avoid a leak
         free(copy);
@@ -235,6 +875,80 @@ const char* plugin_place_work(const char* str) {
     
 }
 
+const char* plugin_place_work(const char* str) {
+    return place_work(str, NULL);
+}
+
+const char* plugin_place_work_meta(const char* str, const cp_item_meta_t* meta) {
+    return place_work(str, meta);
+}
+
+const char* plugin_place_work_batch(const char* items, size_t count, const cp_item_meta_t* meta) {
+    plugin_context_t* ctx = &g_context_instance;
+    if (!ctx->initialized) return "plugin not initialized";
+    if (items == NULL)     return "items is NULL";
+
+    // batched items are whole data records (never the sentinel), only the
+    // trace id carries over
+    cp_item_meta_t m = {0};
+    m.flags = CP_ITEM_DATA;
+    if (meta) m.trace_id = meta->trace_id;
+    if (!g_tracer) m.trace_id = 0;
+    if (ctx->inline_mode) { // one at a time, each served before the next is copied
+        const char* err = NULL;
+        for (size_t i = 0; i < count && !err; ++i) {
+            err = place_work(items, &m);
+            items += strlen(items) + 1;
+        }
+        return err;
+    }
+    uint64_t t_direct = 0;
+    if (ctx->latency_mode && begin_direct(ctx, count, &t_direct)) { // the whole batch, in order
+        const char* err = NULL;
+        for (size_t i = 0; i < count && !err; ++i) {
+            char* copy = dup_cstr(items);
+            cp_item_meta_t im = m;
+            if (im.trace_id) im.enqueued_ns = t_direct;
+            if (copy) (void)serve_item(ctx, copy, &im, g_tracer, NO_TICKET);
+            else err = "alloc failed";
+            items += strlen(items) + 1;
+        }
+        end_direct(ctx, t_direct);
+        return err;
+    }
+    return consumer_producer_put_packed(ctx->queue, items, count, &m);
+}
+
+const char* common_plugin_emit_columns(plugin_emitter_t* out, cp_columns_t* batch) {
+    if (!out || !batch) {
+        free(batch);
+        return "invalid emit";
+    }
+    if (out->columns) {
+        free(batch);
+        return "one column batch per input";
+    }
+    out->columns = batch;
+    return NULL;
+}
+
+const char* common_plugin_emit(plugin_emitter_t* out, const char* s, size_t len) {
+    if (!out || (!s && len)) return "invalid emit";
+    if (out->len + len + 1 > out->cap) {
+        size_t cap = out->cap ? out->cap : 256;
+        while (cap < out->len + len + 1) cap *= 2;
+        char* grown = (char*)realloc(out->buf, cap);
+        if (!grown) return "alloc failed for emitted output";
+        out->buf = grown;
+        out->cap = cap;
+    }
+    if (len) memcpy(out->buf + out->len, s, len);
+    out->buf[out->len + len] = '\0';
+    out->len += len + 1;
+    out->count++;
+    return NULL;
+}
+
 void plugin_attach(const char* (*next_place_work)(const char*)) {
     plugin_context_t* ctx = &g_context_instance;
 
@@ -269,6 +983,294 @@ out:
 const char* plugin_wait_finished(void) {
     plugin_context_t* ctx = &g_context_instance;
     if (!ctx->initialized) return "plugin not initialized";
+    if (ctx->inline_mode) { // nothing runs by itself: serve a pending stop now
+        run_inline(ctx);
+        return ctx->finished ? NULL : "stage has not received <END>";
+    }
     if (monitor_wait(&ctx->finished_monitor) != 0) return "wait failed";
     return NULL;
 }
+
+void common_plugin_set_end_hook(void (*hook)(void)) {
+    plugin_context_t* ctx = &g_context_instance;
+    pthread_mutex_lock(&ctx->lock_state);
+    ctx->end_hook = hook;
+    pthread_mutex_unlock(&ctx->lock_state);
+}
+
+unsigned common_plugin_item_flags(void) {
+    return t_item_flags;
+}
+
+int common_plugin_backlog(void) {
+    return consumer_producer_count(g_context_instance.queue);
+}
+
+const char* common_plugin_option(const char* key) {
+    plugin_context_t* ctx = &g_context_instance;
+    if (!key) return NULL;
+    const char* value = NULL;
+    for (int i = 0; i < ctx->option_count; ++i) {
+        if (strcmp(ctx->options[i].key, key) == 0) {
+            ctx->options[i].used = 1;
+            value = ctx->options[i].value; // last one wins
+        }
+    }
+    return value;
+}
+
+const char* plugin_configure(const char* key, const char* value) {
+    plugin_context_t* ctx = &g_context_instance;
+    if (ctx->initialized) return "configure after init is not allowed";
+    if (!key || !*key || !value) return "invalid option";
+    if (ctx->option_count == PLUGIN_MAX_OPTIONS) return "too many options";
+
+    plugin_option_t* o = &ctx->options[ctx->option_count];
+    o->key   = dup_cstr(key);
+    o->value = dup_cstr(value);
+    o->used  = 0;
+    if (!o->key || !o->value) {
+        free(o->key);
+        free(o->value);
+        *o = (plugin_option_t){0};
+        return "alloc failed";
+    }
+    ctx->option_count++;
+    return NULL;
+}
+
+void plugin_attach_meta(plugin_place_work_meta_fn next) {
+    plugin_context_t* ctx = &g_context_instance;
+    pthread_mutex_lock(&ctx->lock_state);
+    ctx->next_place_work_meta = next;
+    pthread_mutex_unlock(&ctx->lock_state);
+}
+
+void plugin_attach_batch(plugin_place_work_batch_fn next) {
+    plugin_context_t* ctx = &g_context_instance;
+    pthread_mutex_lock(&ctx->lock_state);
+    ctx->next_place_work_batch = next;
+    pthread_mutex_unlock(&ctx->lock_state);
+}
+
+void plugin_set_budget(void* shared, size_t queue_bytes) {
+    g_shared_budget = (mem_budget_t*)shared;
+    g_default_queue_bytes = queue_bytes;
+}
+
+void plugin_set_inline(int on) {
+    g_inline = (on != 0);
+}
+
+void plugin_set_framing(int framing) {
+    g_framing = framing;
+}
+
+int common_plugin_framing(void) {
+    return g_framing;
+}
+
+size_t common_plugin_frame_head(size_t record_len, char out[4]) {
+    if (g_framing != PLUGIN_FRAMING_LEN32) return 0;
+    uint32_t n = record_len > UINT32_MAX ? UINT32_MAX : (uint32_t)record_len;
+    out[0] = (char)(n >> 24);
+    out[1] = (char)(n >> 16);
+    out[2] = (char)(n >> 8);
+    out[3] = (char)n;
+    return 4;
+}
+
+size_t common_plugin_frame_tail(char out[1]) {
+    if (g_framing == PLUGIN_FRAMING_LEN32) return 0;
+    out[0] = (g_framing == PLUGIN_FRAMING_NUL) ? '\0' : '\n';
+    return 1;
+}
+
+void plugin_set_latency(int on) {
+    g_latency = (on != 0);
+}
+
+// Stages whose items may be served by several threads at once
+static int replicable(const plugin_context_t* ctx) {
+    return (ctx->flags & PLUGIN_FLAG_REENTRANT) && ctx->process_function && !ctx->emit_function &&
+           !ctx->cache && !ctx->inline_mode && !ctx->latency_mode;
+}
+
+const char* plugin_sample_load(stage_load_t* out) {
+    plugin_context_t* ctx = &g_context_instance;
+    if (!ctx->initialized) return "plugin not initialized";
+    if (!out)              return "out is NULL";
+
+    __atomic_store_n(&ctx->sample_busy, 1, __ATOMIC_RELAXED);
+    cp_stats_t st;
+    consumer_producer_get_stats(ctx->queue, &st);
+    out->queued      = consumer_producer_count(ctx->queue);
+    out->capacity    = ctx->queue->max_items;
+    out->blocked_ns  = st.blocked_ns;
+    out->busy_ns     = __atomic_load_n(&ctx->busy_ns, __ATOMIC_RELAXED);
+    out->max_threads = replicable(ctx) ? PLUGIN_MAX_THREADS : 1;
+    // the target: a retired replica waiting for work leaves with its next item
+    out->threads     = __atomic_load_n(&ctx->threads_target, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+const char* plugin_set_threads(int n) {
+    plugin_context_t* ctx = &g_context_instance;
+    if (!ctx->initialized)                  return "plugin not initialized";
+    if (n < 1 || n > PLUGIN_MAX_THREADS)    return "invalid thread count";
+    if (n > 1 && !replicable(ctx))          return "stage cannot run on several threads";
+
+    const char* err = NULL;
+    pthread_mutex_lock(&ctx->lock_state);
+    if (ctx->end_pushed || ctx->threads_live == 0) {
+        err = "stage has finished";
+    } else {
+        __atomic_store_n(&ctx->threads_target, n, __ATOMIC_RELAXED);
+        for (int i = 1; i < n; ++i) {
+            if (ctx->replica_state[i] == REPLICA_RUNNING) continue;
+            // a retired replica has left (it takes no lock on its way out)
+            if (ctx->replica_state[i] == REPLICA_EXITED) (void)pthread_join(ctx->replica_thread[i], NULL);
+            ctx->replica_state[i] = REPLICA_NONE;
+            if (pthread_create(&ctx->replica_thread[i], NULL, replica_thread, (void*)(intptr_t)i) != 0) {
+                __atomic_store_n(&ctx->threads_target, i, __ATOMIC_RELAXED);
+                err = "pthread_create failed";
+                break;
+            }
+            ctx->replica_state[i] = REPLICA_RUNNING;
+            ctx->threads_live++;
+        }
+        if (ctx->threads_live > ctx->threads_peak) ctx->threads_peak = ctx->threads_live;
+    }
+    pthread_mutex_unlock(&ctx->lock_state);
+    return err;
+}
+
+void plugin_set_tracer(const void* hook) {
+    g_tracer = (const trace_hook_t*)hook;
+}
+
+static void report_stats(plugin_context_t* ctx) {
+    // stats are on stderr before this returns, so stages print in pipeline order
+    cp_stats_t st;
+    consumer_producer_get_stats(ctx->queue, &st);
+
+    char line[384];
+    snprintf(line, sizeof(line),
+             "queue: puts=%" PRIu64 " gets=%" PRIu64 " dropped_newest=%" PRIu64
+             " dropped_oldest=%" PRIu64 " dropped_sampled=%" PRIu64 " budget_sheds=%" PRIu64
+             " discarded=%" PRIu64 " peak_items=%d peak_bytes=%zu",
+             st.puts, st.gets, st.dropped_newest, st.dropped_oldest, st.dropped_sampled,
+             st.budget_sheds, st.discarded, st.peak_count, st.peak_bytes);
+    log_ring_write_control("INFO", plugin_get_name(), line);
+
+    if (ctx->dropped) {
+        snprintf(line, sizeof(line), "filter: dropped=%" PRIu64, ctx->dropped);
+        log_ring_write_control("INFO", plugin_get_name(), line);
+    }
+
+    if (ctx->latency_mode) {
+        snprintf(line, sizeof(line), "latency: direct=%" PRIu64 " queued=%" PRIu64,
+                 st.direct, st.puts - st.direct);
+        log_ring_write_control("INFO", plugin_get_name(), line);
+    }
+
+    if (ctx->threads_peak > 1) {
+        snprintf(line, sizeof(line), "threads: now=%d peak=%d",
+                 __atomic_load_n(&ctx->threads_target, __ATOMIC_RELAXED), ctx->threads_peak);
+        log_ring_write_control("INFO", plugin_get_name(), line);
+    }
+
+    if (ctx->queue->spill) {
+        snprintf(line, sizeof(line), "spill: spilled=%" PRIu64 " peak_spill_bytes=%" PRIu64,
+                 st.spilled, st.peak_spill_bytes);
+        log_ring_write_control("INFO", plugin_get_name(), line);
+    }
+
+    if (ctx->cache) {
+        const memo_cache_t* c = ctx->cache;
+        uint64_t lookups = c->hits + c->misses;
+        snprintf(line, sizeof(line),
+                 "cache: hits=%" PRIu64 " misses=%" PRIu64 " hit_rate=%.1f%% evictions=%" PRIu64
+                 " entries=%d/%d bytes=%zu",
+                 c->hits, c->misses, lookups ? 100.0 * (double)c->hits / (double)lookups : 0.0,
+                 c->evictions, c->count, c->capacity, c->bytes);
+        log_ring_write_control("INFO", plugin_get_name(), line);
+    }
+    log_ring_flush();
+}
+
+const char* plugin_report_stats(void) {
+    plugin_context_t* ctx = &g_context_instance;
+    if (!ctx->initialized) return "plugin not initialized";
+    report_stats(ctx);
+    return NULL;
+}
+
+const char* plugin_control(unsigned ctl) {
+    plugin_context_t* ctx = &g_context_instance;
+    if (!ctx->initialized) return "plugin not initialized";
+    return consumer_producer_post_control(ctx->queue, ctl);
+}
+
+const char* plugin_pause(void) {
+    plugin_context_t* ctx = &g_context_instance;
+    if (!ctx->initialized) return "plugin not initialized";
+
+    pthread_mutex_lock(&ctx->lock_state);
+    ctx->paused = 1;
+    while (ctx->in_handoff) {
+        pthread_cond_wait(&ctx->state_cond, &ctx->lock_state);
+    }
+    pthread_mutex_unlock(&ctx->lock_state);
+    return NULL;
+}
+
+const char* plugin_resume(void) {
+    plugin_context_t* ctx = &g_context_instance;
+    if (!ctx->initialized) return "plugin not initialized";
+
+    pthread_mutex_lock(&ctx->lock_state);
+    ctx->paused = 0;
+    pthread_cond_broadcast(&ctx->state_cond);
+    pthread_mutex_unlock(&ctx->lock_state);
+    return NULL;
+}
+
+const char* plugin_reattach(const char* (*next_place_work)(const char*)) {
+    plugin_context_t* ctx = &g_context_instance;
+    if (!ctx->initialized) return "plugin not initialized";
+
+    const char* err = NULL;
+    pthread_mutex_lock(&ctx->lock_state);
+    if (!ctx->paused) {
+        err = "reattach requires a paused stage";
+    } else {
+        ctx->next_place_work = next_place_work;
+    }
+    pthread_mutex_unlock(&ctx->lock_state);
+    return err;
+}
+
+const char* plugin_fuse(const char* const* stages, size_t count) {
+    plugin_context_t* ctx = &g_context_instance;
+    if (ctx->initialized) return "fuse after init is not allowed";
+    if (!stages || count < 2) return "nothing to fuse";
+
+    chain_kernel_t kernel;
+    const char* err = chain_kernel_compile(&kernel, stages, count);
+    if (err) return err;
+
+    // combined name, e.g. "uppercaser+rotator"
+    size_t used = 0;
+    g_fused_name[0] = '\0';
+    for (size_t i = 0; i < count; ++i) {
+        int n = snprintf(g_fused_name + used, sizeof(g_fused_name) - used, "%s%s",
+                         i ? "+" : "", stages[i]);
+        if (n < 0 || (size_t)n >= sizeof(g_fused_name) - used) return "fused name too long";
+        used += (size_t)n;
+    }
+
+    g_fused_kernel = kernel;
+    g_fused = 1;
+    return NULL;
+}
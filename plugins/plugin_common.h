@@ -2,12 +2,68 @@
 #define PLUGIN_COMMON_H
 
 #include "sync/consumer_producer.h"
+#include "memo_cache.h"
+#include "chain_kernel.h"
+#include "trace_hook.h"
+#include "stage_load.h"
+#include "framing.h"
 #include <pthread.h>
 
 /**
 * Common SDK structures and functions for plugin implementation
 */
 
+#define PLUGIN_MAX_OPTIONS 16
+
+// Stage capability flags for common_plugin_init_ex
+#define PLUGIN_FLAG_PURE   0x1u // output depends only on the input bytes, no side effects (cacheable)
+#define PLUGIN_FLAG_CHUNKS 0x2u // transforms record fragments one by one (see common_plugin_item_flags);
+                                // stages without it are given whole, reassembled records
+#define PLUGIN_FLAG_REENTRANT 0x4u // the transform may run on several threads at once (no
+                                   // shared mutable state), so the stage can be replicated
+#define PLUGIN_FLAG_COLUMNS 0x8u // takes column batches as they are (input is a cp_columns_t
+                                 // when common_plugin_item_flags has CP_ITEM_COLUMNS); stages
+                                 // without it see each record of a batch on its own
+
+#define PLUGIN_MAX_THREADS 8 // consumer threads per stage, replicas included
+
+// Transform result that consumes the item without passing anything downstream
+// (filters). Whole records only: a PLUGIN_FLAG_CHUNKS stage must not drop a
+// single fragment of a record.
+extern const char plugin_drop_marker[];
+#define PLUGIN_DROP (plugin_drop_marker)
+
+// Downstream entry that also takes the item's metadata
+typedef const char* (*plugin_place_work_meta_fn)(const char*, const cp_item_meta_t*);
+
+// Downstream entry taking count NUL-terminated strings stored back to back
+typedef const char* (*plugin_place_work_batch_fn)(const char* items, size_t count, const cp_item_meta_t*);
+
+// Outputs of one input of an emitting stage (see common_plugin_init_emit),
+// packed back to back in a buffer the stage reuses for every input
+typedef struct plugin_emitter
+{
+    char*  buf;
+    size_t len;
+    size_t cap;
+    size_t count;
+    cp_columns_t* columns; // column batch handed on after the strings (see common_plugin_emit_columns)
+} plugin_emitter_t;
+
+// Transform of an emitting stage: calls common_plugin_emit zero or more times
+// per input. Returns NULL, or an error message to log (outputs emitted so far
+// still go downstream). It is called once more with input NULL when <END>
+// arrives, so a stateful stage can emit what it holds before <END> moves on.
+typedef const char* (*plugin_emit_fn)(const char* input, plugin_emitter_t* out);
+
+// Per-stage option set through plugin_configure before plugin_init
+typedef struct
+{
+    char* key;
+    char* value;
+    int   used; // consumed by common_plugin_init or by the plugin itself
+} plugin_option_t;
+
 // Plugin context structure
 typedef struct
 {
@@ -15,7 +71,14 @@ typedef struct
     consumer_producer_t* queue; // Input queue
     pthread_t consumer_thread; // Consumer thread
     const char* (*next_place_work)(const char*); // Next plugin's place_work function
+    plugin_place_work_meta_fn next_place_work_meta; // Next plugin's place_work_meta, NULL if it has none
     const char* (*process_function)(const char*); // Plugin-specific processing function
+    plugin_emit_fn emit_function; // One-to-many transform, replaces process_function (optional)
+    plugin_emitter_t emitter; // Outputs of the current input (emit_function stages)
+    plugin_place_work_batch_fn next_place_work_batch; // Next plugin's place_work_batch, NULL if it has none
+    void (*end_hook)(void); // Called by the consumer thread when <END> arrives (optional)
+    unsigned flags; // PLUGIN_FLAG_* declared by the plugin
+    memo_cache_t* cache; // Result cache (pure stages with cache=N), NULL otherwise
     int initialized; // Initialization flag
     int finished; // Finished processing flag
     
@@ -25,6 +88,37 @@ typedef struct
     int thread_created;           // pthread_create succeeded 
     int thread_joined;            // pthread_join already done
     int end_pushed;               // we already pushed "<END>" downstream
+
+    int paused;                   // plugin_pause: hold handoffs downstream
+    int in_handoff;               // worker is inside next_place_work
+    pthread_cond_t state_cond;    // paired with lock_state for pause/handoff changes
+
+    int inline_mode;              // no consumer thread: the stage runs on its producer's thread
+    int inline_running;           // run_inline is serving the queue (guards re-entry)
+    int latency_mode;             // producers serve items themselves while the stage is idle
+    uint64_t direct_end_ns;       // latency mode: when the last direct handoff returned
+    uint64_t direct_cost_ns;      // latency mode: how long it took the producer
+
+    int threads_target;           // consumer threads wanted (see plugin_set_threads)
+    int threads_live;             // consumer threads running, replicas included
+    pthread_t replica_thread[PLUGIN_MAX_THREADS]; // slot 0 is consumer_thread
+    int replica_state[PLUGIN_MAX_THREADS];        // REPLICA_* per slot
+    uint64_t next_out;            // sequence number whose result goes downstream next
+    int turn_waiters;             // threads waiting in wait_turn
+    pthread_cond_t turn_cond;     // paired with lock_state, signaled as next_out moves
+    int threads_peak;             // most consumer threads running at once
+    int sample_busy;              // the host samples load: time every item
+    uint64_t busy_ns;             // total time consumer threads spent serving items
+
+    uint64_t dropped;             // items the transform answered with PLUGIN_DROP
+    char*  reasm;                 // record being reassembled (stages without PLUGIN_FLAG_CHUNKS)
+    size_t reasm_len;
+    size_t reasm_cap;
+    int    reasm_failed;          // out of memory: skip the rest of the record
+
+    plugin_option_t options[PLUGIN_MAX_OPTIONS]; // stage options (see plugin_configure)
+    int option_count;
+    char error_buf[128];          // backing store for formatted init errors
 } plugin_context_t;
 
 /**
@@ -64,6 +158,98 @@ __attribute__((visibility("default"))) const char* plugin_get_name(void);
 */
 const char* common_plugin_init(const char* (*process_function)(const char*), const char* name, int queue_size);
 
+/**
+* Same as common_plugin_init, and declares the stage's capabilities
+* @param flags PLUGIN_FLAG_* bits (PLUGIN_FLAG_PURE allows the cache=N option)
+* @return NULL on success, error message on failure
+*/
+const char* common_plugin_init_ex(const char* (*process_function)(const char*), const char* name, int queue_size,
+                                  unsigned flags);
+
+/**
+* Same as common_plugin_init_ex for a stage that emits zero, one or many
+* outputs per input. The outputs of one input reach the next stage in a
+* single batched put. Emitting stages see whole records and cannot use cache=N.
+* @param emit_function Transform calling common_plugin_emit for each output
+* @param flags PLUGIN_FLAG_* bits (PLUGIN_FLAG_CHUNKS is not allowed)
+* @return NULL on success, error message on failure
+*/
+const char* common_plugin_init_emit(plugin_emit_fn emit_function, const char* name, int queue_size,
+                                    unsigned flags);
+
+/**
+* Emit one output from an emit_function. The bytes are copied, so s may point
+* into the input.
+* @param out The emitter passed to the transform
+* @param s Output bytes (no NUL inside)
+* @param len Number of bytes
+* @return NULL on success, error message on failure
+*/
+const char* common_plugin_emit(plugin_emitter_t* out, const char* s, size_t len);
+
+/**
+* Emit a column batch from an emit_function, after any strings emitted for
+* the same input. At most one batch per input.
+* @param out The emitter passed to the transform
+* @param batch Block allocated with malloc, ownership passes to the stage
+* @return NULL on success, error message on failure (batch is freed)
+*/
+const char* common_plugin_emit_columns(plugin_emitter_t* out, cp_columns_t* batch);
+
+/**
+* Look up a per-stage option and mark it as consumed.
+* Plugins must read their own options before calling common_plugin_init,
+* which rejects any option nobody consumed.
+* @param key Option name
+* @return The value of the last matching option, or NULL if it was not given
+*/
+const char* common_plugin_option(const char* key);
+
+/**
+* Register a function the consumer thread calls when <END> arrives, before
+* forwarding it (e.g. to print a summary). Call after common_plugin_init.
+* @param hook Function to call, NULL to clear
+*/
+void common_plugin_set_end_hook(void (*hook)(void));
+
+/**
+* Fragment flags of the item being transformed, for PLUGIN_FLAG_CHUNKS stages.
+* Call from the transform function only.
+* @return CP_ITEM_MORE / CP_ITEM_CONT bits, 0 for a whole record
+*/
+unsigned common_plugin_item_flags(void);
+
+/**
+* Record framing chosen by the host (PLUGIN_FRAMING_*), for sinks that write
+* records out. Valid from plugin_init on. With PLUGIN_FRAMING_LEN32 the
+* length goes first, so a sink then asks for whole records (no PLUGIN_FLAG_CHUNKS).
+* @return The framing
+*/
+int common_plugin_framing(void);
+
+/**
+* Bytes that go before a record of record_len bytes in the host's framing:
+* the length with PLUGIN_FRAMING_LEN32, nothing otherwise
+* @param out Receives up to 4 bytes
+* @return Number of bytes written to out
+*/
+size_t common_plugin_frame_head(size_t record_len, char out[4]);
+
+/**
+* Bytes that go after a record in the host's framing: '\n' or '\0', nothing
+* with PLUGIN_FRAMING_LEN32
+* @param out Receives up to 1 byte
+* @return Number of bytes written to out
+*/
+size_t common_plugin_frame_tail(char out[1]);
+
+/**
+* Number of items waiting in this stage's queue behind the current one, so a
+* transform can batch while more work is pending and flush when it runs dry.
+* @return Queued item count
+*/
+int common_plugin_backlog(void);
+
 /**
 * Initialize the plugin with the specified queue size - calls common_plugin_init
 * This function should be implemented by each plugin
@@ -98,6 +284,160 @@ __attribute__((visibility("default"))) void plugin_attach(const char* (*next_pla
 */
 __attribute__((visibility("default"))) const char* plugin_wait_finished(void);
 
+/**
+* Set a per-stage option (optional SDK entry point, called before plugin_init)
+* Options understood by every plugin:
+*   overflow=block|drop-newest|drop-oldest|sample   what a full input queue does
+*   sample=N                                        admit 1 in N items while full (overflow=sample)
+*   budget=BYTES[K|M|G]                             cap on queued payload bytes
+*   cache=N                                         memoize up to N results (pure plugins only)
+*   cache_bytes=BYTES[K|M|G]                        also cap the cache's key + result bytes
+* @param key Option name
+* @param value Option value
+* @return NULL on success, error message on failure
+*/
+__attribute__((visibility("default"))) const char* plugin_configure(const char* key, const char* value);
+
+/**
+* Stop handing items downstream (optional SDK entry point, used for live rewiring).
+* Returns once no handoff is in flight; the worker keeps its current item.
+* @return NULL on success, error message on failure
+*/
+__attribute__((visibility("default"))) const char* plugin_pause(void);
+
+/**
+* Resume handing items downstream after plugin_pause
+* @return NULL on success, error message on failure
+*/
+__attribute__((visibility("default"))) const char* plugin_resume(void);
+
+/**
+* Point a paused stage at a different next stage (NULL makes it the last stage)
+* @param next_place_work Function pointer to the new next plugin's place_work function
+* @return NULL on success, error message on failure
+*/
+__attribute__((visibility("default"))) const char* plugin_reattach(const char* (*next_place_work)(const char*));
+
+/**
+* Make this stage run a whole run of built-in stages as one composed kernel
+* (optional SDK entry point, called before plugin_init). The stage then
+* answers to the combined name, e.g. "uppercaser+rotator".
+* @param stages Plugin names of the run, in chain order (this plugin first)
+* @param count Number of names (>= 2)
+* @return NULL on success, error message when the run cannot be fused
+*/
+__attribute__((visibility("default"))) const char* plugin_fuse(const char* const* stages, size_t count);
+
+/**
+* Place work with its metadata, such as record fragment flags (optional SDK entry point)
+* @param str The string to process (plugin takes ownership of a copy)
+* @param meta Item metadata, NULL for a whole untraced record
+* @return NULL on success, error message on failure
+*/
+__attribute__((visibility("default"))) const char* plugin_place_work_meta(const char* str, const cp_item_meta_t* meta);
+
+/**
+* Hand items and their metadata to next instead of the plain place_work set by
+* attach (optional SDK entry point). Call after attach or, on a paused stage,
+* after reattach.
+* @param next Downstream plugin_place_work_meta, NULL to fall back to place_work
+*/
+__attribute__((visibility("default"))) void plugin_attach_meta(plugin_place_work_meta_fn next);
+
+/**
+* Place several items at once (optional SDK entry point), queued in one lock
+* round with one wakeup of the consumer
+* @param items count NUL-terminated strings stored back to back (copied)
+* @param count Number of strings
+* @param meta Metadata for every item, NULL for none
+* @return NULL on success, error message on failure
+*/
+__attribute__((visibility("default"))) const char* plugin_place_work_batch(const char* items, size_t count,
+                                                                           const cp_item_meta_t* meta);
+
+/**
+* Hand the outputs of an emitting stage to next in one call (optional SDK
+* entry point). Call after attach or, on a paused stage, after reattach.
+* @param next Downstream plugin_place_work_batch, NULL to place items one by one
+*/
+__attribute__((visibility("default"))) void plugin_attach_batch(plugin_place_work_batch_fn next);
+
+/**
+* Memory limits from the host (optional SDK entry point, called before plugin_init)
+* @param shared A mem_budget_t* charged by this stage's queue, or NULL
+* @param queue_bytes Byte budget for the queue when the stage has no budget= option, 0 = none
+*/
+__attribute__((visibility("default"))) void plugin_set_budget(void* shared, size_t queue_bytes);
+
+/**
+* Select the single-thread engine (optional SDK entry point, called before
+* plugin_init). The stage then starts no consumer thread: place_work queues
+* the item and serves the queue right away on the caller's thread, so a whole
+* chain runs depth first on the thread that feeds it. Control requests are
+* served between items, and wait_finished serves whatever is still pending.
+* @param on Non-zero for the inline engine, 0 for a consumer thread (default)
+*/
+__attribute__((visibility("default"))) void plugin_set_inline(int on);
+
+/**
+* Select direct handoff for light traffic (optional SDK entry point, called
+* before plugin_init; ignored on the inline engine). When the queue is empty
+* and the consumer thread idle, place_work serves the item on the caller's
+* thread instead of waking the consumer. Items are queued as usual as soon as
+* the stage is busy, or while direct handoffs would take up more than half of
+* the producer's time.
+* @param on Non-zero to enable, 0 to always queue (default)
+*/
+__attribute__((visibility("default"))) void plugin_set_latency(int on);
+
+/**
+* Select the record framing sinks write in (optional SDK entry point, called
+* before plugin_init)
+* @param framing PLUGIN_FRAMING_*, PLUGIN_FRAMING_LINE by default
+*/
+__attribute__((visibility("default"))) void plugin_set_framing(int framing);
+
+/**
+* Current load of the stage (optional SDK entry point, for the host's
+* autoscaler). The first call also starts timing every item.
+* @param out Receives the counters
+* @return NULL on success, error message on failure
+*/
+__attribute__((visibility("default"))) const char* plugin_sample_load(stage_load_t* out);
+
+/**
+* Run the stage on n consumer threads (optional SDK entry point, any time
+* after plugin_init). Only PLUGIN_FLAG_REENTRANT stages without an emit
+* function or result cache can take more than one, and not on the inline
+* engine or in latency mode. Threads take items in queue order, transform
+* them in parallel and pass results downstream in that same order; <END> goes
+* last. Threads above n retire after the item they are serving or waiting for.
+* @param n Thread count, 1 to PLUGIN_MAX_THREADS
+* @return NULL on success, error message on failure
+*/
+__attribute__((visibility("default"))) const char* plugin_set_threads(int n);
+
+/**
+* Record per-item spans through the host's tracer (optional SDK entry point,
+* called before plugin_init; the hook must outlive the plugin)
+* @param hook A const trace_hook_t*, or NULL to stop tracing
+*/
+__attribute__((visibility("default"))) void plugin_set_tracer(const void* hook);
+
+/**
+* Post requests on the stage's control lane, served by its consumer thread
+* before any queued data (optional SDK entry point)
+* @param ctl CP_CTL_STATS, CP_CTL_FLUSH and/or CP_CTL_STOP (discard everything and end)
+* @return NULL on success, error message on failure
+*/
+__attribute__((visibility("default"))) const char* plugin_control(unsigned ctl);
+
+/**
+* Print the stage's counters to stderr (optional SDK entry point)
+* @return NULL on success, error message on failure
+*/
+__attribute__((visibility("default"))) const char* plugin_report_stats(void);
+
 
 // // Acquire/release a global print lock so stdout prints don't interleave across threads
 // __attribute__((visibility("default"))) void plugin_print_lock(void); // call before any printf
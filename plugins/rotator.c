@@ -30,5 +30,5 @@ const char* plugin_transform(const char* input) {
 }
 
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(plugin_transform, "rotator", queue_size);
+    return common_plugin_init_ex(plugin_transform, "rotator", queue_size, PLUGIN_FLAG_PURE | PLUGIN_FLAG_REENTRANT);
 }
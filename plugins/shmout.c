@@ -0,0 +1,81 @@
+#include "plugin_common.h"
+#include "log_ring.h"
+#include "sync/shm_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Hands every record to another analyzer process through a shared-memory
+// ring (read there with --input=shm:NAME), then passes it on unchanged.
+// A record longer than the ring takes at once crosses as fragments
+// (CP_ITEM_MORE/CP_ITEM_CONT), which the reading side reassembles.
+static shm_ring_t* g_ring;
+static int g_failed;  // the reader went away, later records are dropped
+static char* g_piece; // one fragment of an oversized record, NUL-terminated
+static size_t g_piece_max;
+
+static const char* write_record(const char* input, uint32_t flags) {
+    size_t len = strlen(input);
+    if (len <= g_piece_max) return shm_ring_write(g_ring, input, flags);
+    if (!g_piece && !(g_piece = (char*)malloc(g_piece_max + 1))) return "alloc failed";
+    for (size_t off = 0; off < len; off += g_piece_max) {
+        size_t n = len - off < g_piece_max ? len - off : g_piece_max;
+        memcpy(g_piece, input + off, n);
+        g_piece[n] = '\0';
+        uint32_t f = flags & (CP_ITEM_MORE | CP_ITEM_CONT | CP_ITEM_DATA);
+        if (off > 0) f |= CP_ITEM_CONT;
+        if (off + n < len) f |= CP_ITEM_MORE;
+        const char* err = shm_ring_write(g_ring, g_piece, f);
+        if (err) return err;
+    }
+    return NULL;
+}
+
+const char* plugin_transform(const char* input) {
+    if (!input) return NULL;
+    if (g_ring && !g_failed) {
+        const char* err = write_record(input, common_plugin_item_flags());
+        if (err) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "%s, dropping further records", err);
+            log_ring_write("ERROR", "shmout", msg);
+            g_failed = 1;
+        }
+    }
+    return input; // passthrough
+}
+
+// Called once <END> arrives: it crosses the boundary too, even after a
+// failure, so a reader that is still there stops reading
+static void send_end(void) {
+    if (!g_ring) return;
+    (void)shm_ring_write(g_ring, "<END>", SHM_RING_END);
+    shm_ring_detach(g_ring);
+    g_ring = NULL;
+    free(g_piece);
+    g_piece = NULL;
+}
+
+const char* plugin_init(int queue_size) {
+    const char* name = common_plugin_option("name");
+    const char* size = common_plugin_option("size");
+    if (!name) return "shmout needs name=RING";
+
+    size_t bytes = SHM_RING_DEFAULT_BYTES;
+    if (size && mem_budget_parse_size(size, &bytes) != 0) return "invalid size";
+
+    const char* err = NULL;
+    g_failed = 0;
+    g_ring = shm_ring_attach(name, bytes, SHM_RING_WRITER, &err);
+    if (!g_ring) return err;
+    g_piece_max = shm_ring_max_record(g_ring);
+
+    err = common_plugin_init_ex(plugin_transform, "shmout", queue_size, PLUGIN_FLAG_CHUNKS);
+    if (err) {
+        shm_ring_detach(g_ring);
+        g_ring = NULL;
+        return err;
+    }
+    common_plugin_set_end_hook(send_end);
+    return NULL;
+}
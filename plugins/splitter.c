@@ -0,0 +1,43 @@
+#include "plugin_common.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Splits every record on a separator and emits each piece as its own record,
+// e.g. a log line into its fields, or a multi-record batch into single records
+static char   g_sep[64] = " ";
+static size_t g_sep_len = 1;
+static int    g_keep_empty; // emit empty pieces too (default: skip them)
+
+const char* plugin_split(const char* input, plugin_emitter_t* out) {
+    if (!input) return NULL;
+    const char* p = input;
+    for (;;) {
+        const char* hit = strstr(p, g_sep);
+        size_t len = hit ? (size_t)(hit - p) : strlen(p);
+        if (len || g_keep_empty) {
+            const char* err = common_plugin_emit(out, p, len);
+            if (err) return err;
+        }
+        if (!hit) return NULL;
+        p = hit + g_sep_len;
+    }
+}
+
+const char* plugin_init(int queue_size) {
+    const char* sep  = common_plugin_option("sep");
+    const char* keep = common_plugin_option("keep_empty");
+    memcpy(g_sep, " ", 2);
+    g_sep_len = 1;
+    if (sep) {
+        size_t n = strlen(sep);
+        if (n == 0 || n >= sizeof(g_sep)) return "invalid sep";
+        memcpy(g_sep, sep, n + 1);
+        g_sep_len = n;
+    }
+    g_keep_empty = 0;
+    if (keep) {
+        if (strcmp(keep, "1") == 0)      g_keep_empty = 1;
+        else if (strcmp(keep, "0") != 0) return "invalid keep_empty (use 1 or 0)";
+    }
+    return common_plugin_init_emit(plugin_split, "splitter", queue_size, PLUGIN_FLAG_PURE);
+}
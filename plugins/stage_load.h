@@ -0,0 +1,21 @@
+#ifndef STAGE_LOAD_H
+#define STAGE_LOAD_H
+
+#include <stdint.h>
+
+/**
+* Load counters of a stage, read by the host's autoscaler through the
+* optional plugin_sample_load entry point. The times only grow: the host
+* compares two samples to get the share of an interval.
+*/
+typedef struct stage_load
+{
+    int      queued;      /* items waiting in the input queue */
+    int      capacity;    /* item limit of the queue, 0 = none */
+    uint64_t blocked_ns;  /* producers' total time waiting for space in the queue */
+    uint64_t busy_ns;     /* consumer threads' total time in the transform, not handing off */
+    int      threads;     /* consumer threads the stage runs on */
+    int      max_threads; /* 1 when the stage cannot be replicated */
+} stage_load_t;
+
+#endif // STAGE_LOAD_H
@@ -0,0 +1,54 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+* Column batch: several records parsed into fields once, carried through a
+* queue as a single item flagged CP_ITEM_COLUMNS. One allocation holds the
+* header, then (all uint32_t)
+*   row_off[rows + 1]   record r is the NUL-terminated string at data + row_off[r]
+*   off[cols][rows]     field c of record r starts at data + off[c][r]
+*   len[cols][rows]     and is len[c][r] bytes long, CP_COLUMNS_ABSENT if
+*                       record r has fewer than c + 1 fields
+* then the records' bytes. The per-field arrays are stored column by column,
+* so a stage reading one field walks two contiguous arrays.
+*/
+typedef struct cp_columns
+{
+    uint32_t bytes; /* size of the whole block */
+    uint32_t rows;  /* records in the batch */
+    uint32_t cols;  /* fields of the widest record */
+    uint32_t data;  /* offset of the records' bytes from the start of the block */
+} cp_columns_t;
+
+#define CP_COLUMNS_ABSENT 0xFFFFFFFFu
+
+static inline const uint32_t* cp_columns_row_offsets(const cp_columns_t* b) {
+    return (const uint32_t*)(b + 1);
+}
+
+static inline const uint32_t* cp_columns_offsets(const cp_columns_t* b, uint32_t col) {
+    return cp_columns_row_offsets(b) + b->rows + 1 + (size_t)col * b->rows;
+}
+
+static inline const uint32_t* cp_columns_lengths(const cp_columns_t* b, uint32_t col) {
+    return cp_columns_row_offsets(b) + b->rows + 1 + ((size_t)b->cols + col) * b->rows;
+}
+
+static inline const char* cp_columns_data(const cp_columns_t* b) {
+    return (const char*)b + b->data;
+}
+
+// Record row as a NUL-terminated string inside the block
+static inline const char* cp_columns_row(const cp_columns_t* b, uint32_t row) {
+    return cp_columns_data(b) + cp_columns_row_offsets(b)[row];
+}
+
+// Size of a block for rows records, cols columns and data_len bytes of records
+static inline size_t cp_columns_size(uint32_t rows, uint32_t cols, size_t data_len) {
+    return sizeof(cp_columns_t) + ((size_t)rows + 1 + 2 * (size_t)cols * rows) * sizeof(uint32_t) + data_len;
+}
+
+#endif // COLUMNS_H
@@ -4,11 +4,19 @@
 #include <pthread.h>
 #include <stdlib.h>   /* calloc, free */
 #include <stdint.h>   /* SIZE_MAX     */
+#include <string.h>   /* strlen, strcmp */
+#include <time.h>     /* clock_gettime for traced items */
+
+// Shedding is record-granular: the overflow policy decides on a record's
+// first fragment, its continuations (CP_ITEM_CONT) follow that decision
+#define CP_FRAG_NONE 0 // no record is open
+#define CP_FRAG_KEEP 1 // the first fragment was queued: the rest wait for space
+#define CP_FRAG_SHED 2 // the first fragment was shed: the rest are shed too
 
 const char* consumer_producer_init(consumer_producer_t* queue, int capacity) {
     // validate input
     if (queue == NULL)  return "queue is NULL";
-    if (capacity <= 0)  return "capacity must be > 0";
+    if (capacity < 0)   return "capacity must be >= 0";
 
     // [Double init guard] 
     // only treat it as already initialized if both
@@ -23,7 +31,9 @@ const char* consumer_producer_init(consumer_producer_t* queue, int capacity) {
     queue->not_empty_monitor = (monitor_t){0};
     queue->finished_monitor  = (monitor_t){0};
 
-    // Circular buffer initialization
+    // Circular buffer initialization (0 = no item limit, start small and grow)
+    queue->max_items      = capacity;
+    if (capacity == 0) capacity = CP_INITIAL_SLOTS;
     queue->capacity       = capacity;
     queue->count          = 0;
     queue->head           = 0;
@@ -31,14 +41,40 @@ const char* consumer_producer_init(consumer_producer_t* queue, int capacity) {
     queue->finished       = 0;
     queue->is_initialized = 0;   // flipped at the very end on success
 
+    // Overflow handling defaults to today's blocking behavior
+    queue->policy            = CP_OVERFLOW_BLOCK;
+    queue->sample_every      = 1;
+    queue->sample_seq        = 0;
+    queue->frag_state        = CP_FRAG_NONE;
+    queue->byte_budget       = 0;
+    queue->bytes             = 0;
+    queue->shared            = NULL;
+    queue->blocked_producers = 0;
+    queue->control           = 0;
+    queue->discarding        = 0;
+    queue->spill             = NULL;
+    queue->spill_in          = 0;
+    queue->spill_out         = 0;
+    queue->inline_mode       = 0;
+    queue->next_seq          = 0;
+    queue->latency_mode      = 0;
+    queue->serving           = 0;
+    queue->claimed           = 0;
+    queue->stats             = (cp_stats_t){0};
+
     if ((size_t)capacity > SIZE_MAX / sizeof(char*)) {
         queue->capacity = 0;
         return "capacity is too large";
     }
 
-    // Items array (zeroed)
+    // Items array and its metadata (zeroed)
     queue->items = (char**)calloc((size_t)capacity, sizeof(char*));
-    if (!queue->items) {
+    queue->metas = (cp_item_meta_t*)calloc((size_t)capacity, sizeof(cp_item_meta_t));
+    if (!queue->items || !queue->metas) {
+        free(queue->items);
+        free(queue->metas);
+        queue->items = NULL;
+        queue->metas = NULL;
         queue->capacity = 0;
         return "calloc failed";
     }
@@ -46,7 +82,9 @@ const char* consumer_producer_init(consumer_producer_t* queue, int capacity) {
     // Queue mutex
     if (pthread_mutex_init(&queue->lock, NULL) != 0) {
         free(queue->items);
+        free(queue->metas);
         queue->items    = NULL;
+        queue->metas    = NULL;
         queue->capacity = 0;
         return "pthread_mutex_init(lock) failed";
     }
@@ -55,12 +93,14 @@ const char* consumer_producer_init(consumer_producer_t* queue, int capacity) {
     if (monitor_init(&queue->not_full_monitor) != 0) {
         pthread_mutex_destroy(&queue->lock);
         free(queue->items); queue->items = NULL; queue->capacity = 0;
+        free(queue->metas); queue->metas = NULL;
         return "monitor_init(not_full) failed";
     }
     if (monitor_init(&queue->not_empty_monitor) != 0) {
         monitor_destroy(&queue->not_full_monitor);
         pthread_mutex_destroy(&queue->lock);
         free(queue->items); queue->items = NULL; queue->capacity = 0;
+        free(queue->metas); queue->metas = NULL;
         return "monitor_init(not_empty) failed";
     }
     if (monitor_init(&queue->finished_monitor) != 0) {
@@ -68,6 +108,7 @@ const char* consumer_producer_init(consumer_producer_t* queue, int capacity) {
         monitor_destroy(&queue->not_full_monitor);
         pthread_mutex_destroy(&queue->lock);
         free(queue->items); queue->items = NULL; queue->capacity = 0;
+        free(queue->metas); queue->metas = NULL;
         return "monitor_init(finished) failed";
     }
 
@@ -82,6 +123,7 @@ void consumer_producer_destroy(consumer_producer_t* queue) {
     if (!queue->is_initialized) return;
 
     // Free any leftover items still owned by the queue
+    if (queue->shared && queue->bytes) mem_budget_release(queue->shared, queue->bytes);
     if (queue->items) {
         for (int i = 0; i < queue->capacity; ++i) {
             if (queue->items[i]) {
@@ -92,6 +134,10 @@ void consumer_producer_destroy(consumer_producer_t* queue) {
         free(queue->items);
         queue->items = NULL;
     }
+    free(queue->metas);
+    queue->metas = NULL;
+    spill_destroy(queue->spill);
+    queue->spill = NULL;
 
     monitor_destroy(&queue->finished_monitor);
     monitor_destroy(&queue->not_empty_monitor);
@@ -104,6 +150,7 @@ void consumer_producer_destroy(consumer_producer_t* queue) {
     queue->head      = 0;
     queue->tail      = 0;
     queue->finished  = 0;
+    queue->bytes     = 0;
 
     // clear monitor flags (their internals were already destroyed)
     queue->not_full_monitor.is_initialized  = 0;
@@ -117,73 +164,507 @@ void consumer_producer_destroy(consumer_producer_t* queue) {
     queue->magic = 0;  
 }
 
-const char* consumer_producer_put(consumer_producer_t* queue, const char* item) {
-    if (queue == NULL)      return "queue is NULL";
+const char* consumer_producer_set_overflow(consumer_producer_t* queue, cp_overflow_policy_t policy,
+                                           unsigned sample_every, size_t byte_budget) {
+    if (queue == NULL)          return "queue is NULL";
+    if (!queue->is_initialized) return "queue is not initialized";
+    if (policy < CP_OVERFLOW_BLOCK || policy > CP_OVERFLOW_SAMPLE) return "invalid overflow policy";
+    if (policy == CP_OVERFLOW_SAMPLE && sample_every == 0) return "sample rate must be > 0";
+
+    pthread_mutex_lock(&queue->lock);
+    queue->policy       = policy;
+    queue->sample_every = (policy == CP_OVERFLOW_SAMPLE) ? sample_every : 1;
+    queue->sample_seq   = 0;
+    queue->byte_budget  = byte_budget;
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+const char* consumer_producer_set_shared_budget(consumer_producer_t* queue, mem_budget_t* shared) {
+    if (queue == NULL)          return "queue is NULL";
+    if (!queue->is_initialized) return "queue is not initialized";
+
+    pthread_mutex_lock(&queue->lock);
+    queue->shared = shared;
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+const char* consumer_producer_set_spill(consumer_producer_t* queue, spill_t* spill) {
+    if (queue == NULL)          return "queue is NULL";
     if (!queue->is_initialized) return "queue is not initialized";
-    if (item == NULL)           return "item is NULL";
 
     pthread_mutex_lock(&queue->lock);
+    spill_destroy(queue->spill);
+    queue->spill = spill;
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+const char* consumer_producer_set_inline(consumer_producer_t* queue) {
+    if (queue == NULL)          return "queue is NULL";
+    if (!queue->is_initialized) return "queue is not initialized";
+    if (queue->spill || queue->policy != CP_OVERFLOW_BLOCK) return "inline queues neither spill nor shed";
+
+    pthread_mutex_lock(&queue->lock);
+    queue->inline_mode = 1;
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+const char* consumer_producer_set_latency(consumer_producer_t* queue) {
+    if (queue == NULL)          return "queue is NULL";
+    if (!queue->is_initialized) return "queue is not initialized";
+    if (queue->inline_mode)     return "inline queues have no consumer thread";
+
+    pthread_mutex_lock(&queue->lock);
+    queue->latency_mode = 1;
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+static int cp_at_item_limit(const consumer_producer_t* queue) {
+    return queue->max_items != 0 && queue->count == queue->max_items;
+}
+
+// Full by this queue's own limits: item limit, or (with a budget) no room for
+// `need` more bytes. An item larger than the whole budget is still admitted
+// into an empty queue.
+static int cp_is_full_local(const consumer_producer_t* queue, size_t need) {
+    if (cp_at_item_limit(queue)) return 1;
+    return queue->byte_budget != 0 && queue->count > 0
+        && queue->bytes + need > queue->byte_budget;
+}
+
+// Full because the pipeline-wide budget is exhausted (an empty queue always admits)
+static int cp_is_full_shared(const consumer_producer_t* queue, size_t need) {
+    return queue->shared != NULL && queue->count > 0 && !mem_budget_fits(queue->shared, need);
+}
+
+static int cp_is_full(const consumer_producer_t* queue, size_t need) {
+    return cp_is_full_local(queue, need) || cp_is_full_shared(queue, need);
+}
+
+// Double the slot array of a queue without an item limit (caller holds the lock)
+static int cp_grow(consumer_producer_t* queue) {
+    if (queue->capacity > INT32_MAX / 2) return -1;
+    int cap = queue->capacity * 2;
+    char** items = (char**)calloc((size_t)cap, sizeof(char*));
+    cp_item_meta_t* metas = (cp_item_meta_t*)calloc((size_t)cap, sizeof(cp_item_meta_t));
+    if (!items || !metas) {
+        free(items);
+        free(metas);
+        return -1;
+    }
+    for (int i = 0; i < queue->count; ++i) {
+        int from = (queue->head + i) % queue->capacity;
+        items[i] = queue->items[from];
+        metas[i] = queue->metas[from];
+    }
+    free(queue->items);
+    free(queue->metas);
+    queue->items    = items;
+    queue->metas    = metas;
+    queue->head     = 0;
+    queue->tail     = queue->count;
+    queue->capacity = cap;
+    return 0;
+}
+
+size_t consumer_producer_item_size(const char* item, const cp_item_meta_t* meta) {
+    if (meta && (meta->flags & CP_ITEM_COLUMNS)) return ((const cp_columns_t*)item)->bytes;
+    return strlen(item) + 1;
+}
+
+// Drop the head item to make room (caller holds the lock)
+static void cp_evict_head(consumer_producer_t* queue) {
+    char* victim = queue->items[queue->head];
+    size_t n = victim ? consumer_producer_item_size(victim, &queue->metas[queue->head]) : 0;
+    queue->items[queue->head] = NULL;
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    if (victim) {
+        queue->bytes -= n;
+        if (queue->shared) mem_budget_release(queue->shared, n);
+        free(victim);
+    }
+}
+
+// Drop the record at the head: a whole item, or a first fragment with its
+// continuations. Returns 0 when the head continues a record the consumer has
+// already started on, which cannot be dropped (caller holds the lock).
+static int cp_evict_record(consumer_producer_t* queue) {
+    if (queue->count == 0 || (queue->metas[queue->head].flags & CP_ITEM_CONT)) return 0;
+    cp_evict_head(queue);
+    while (queue->count > 0 && (queue->metas[queue->head].flags & CP_ITEM_CONT)) cp_evict_head(queue);
+    return 1;
+}
+
+static uint64_t cp_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Nothing queued in memory nor on disk
+static int cp_is_drained(const consumer_producer_t* queue) {
+    return queue->count == 0 && spill_count(queue->spill) == 0;
+}
+
+// Queue one item (caller holds the lock; waiting for space releases it).
+// On error the caller keeps ownership of item.
+static const char* cp_put_locked(consumer_producer_t* queue, const char* item, const cp_item_meta_t* meta,
+                                 int may_shed) {
+    size_t need = consumer_producer_item_size(item, meta);
+
+    // After an immediate stop items are accepted and thrown away, even once
+    // the consumer has finished, so upstream stages wind down without errors
+    if (queue->discarding) {
+        queue->stats.discarded++;
+        free((void*)item);
+        return NULL;
+    }
 
     // If the queue is already closed when we start, reject the put.
     // A put that *started before* finish is allowed to complete.
     if (queue->finished) {
-        pthread_mutex_unlock(&queue->lock);
         return "queue finished";
     }
 
+    // The rest of a shed record goes too; the rest of a queued one may not be
+    // shed, or the consumer would join what is left into a corrupted record
+    unsigned frag = meta ? meta->flags & (CP_ITEM_MORE | CP_ITEM_CONT) : 0;
+    if (frag & CP_ITEM_CONT) {
+        if (queue->frag_state == CP_FRAG_SHED) {
+            if (!(frag & CP_ITEM_MORE)) queue->frag_state = CP_FRAG_NONE;
+            free((void*)item);
+            return NULL;
+        }
+        may_shed = 0;
+    }
+
+    // Disk spill while memory is full. Puts go back to memory as soon as it
+    // has room; each memory item records how many items were spilled before
+    // it, so get replays those first and FIFO order holds across both.
+    if (queue->spill && cp_is_full(queue, need)) {
+        cp_item_meta_t m = meta ? *meta : (cp_item_meta_t){0};
+        if (m.trace_id) m.enqueued_ns = cp_now_ns();
+        if (spill_push(queue->spill, item, &m) == NULL) {
+            queue->frag_state = (frag & CP_ITEM_MORE) ? CP_FRAG_KEEP : CP_FRAG_NONE;
+            queue->spill_in++;
+            queue->stats.puts++;
+            queue->stats.spilled++;
+            if (spill_bytes(queue->spill) > queue->stats.peak_spill_bytes) {
+                queue->stats.peak_spill_bytes = spill_bytes(queue->spill);
+            }
+            if (queue->count == 0) monitor_signal(&queue->not_empty_monitor);
+            free((void*)item); // the spill keeps its own copy
+            return NULL;
+        }
+        // disk full or unwritable: block below until memory has room
+    }
+
+    // Load shedding: only consulted when full, blocking stays the fallback
+    if (may_shed && queue->policy != CP_OVERFLOW_BLOCK && cp_is_full(queue, need)) {
+        int by_budget = !cp_at_item_limit(queue);
+        int shed = 0;
+
+        switch (queue->policy) {
+        case CP_OVERFLOW_DROP_NEWEST:
+            queue->stats.dropped_newest++;
+            shed = 1;
+            break;
+        case CP_OVERFLOW_SAMPLE:
+            // admit every Nth arrival (it waits for space below), shed the others
+            if (++queue->sample_seq % queue->sample_every != 0) {
+                queue->stats.dropped_sampled++;
+                shed = 1;
+            }
+            break;
+        case CP_OVERFLOW_DROP_OLDEST:
+            // whole records only; blocks below if the head one is being served
+            while (cp_is_full(queue, need) && cp_evict_record(queue)) {
+                queue->stats.dropped_oldest++;
+                if (by_budget) queue->stats.budget_sheds++;
+            }
+            break;
+        default:
+            break;
+        }
+
+        if (shed) {
+            if (frag & CP_ITEM_MORE) queue->frag_state = CP_FRAG_SHED;
+            if (by_budget) queue->stats.budget_sheds++;
+            free((void*)item); // queue owns the item, shedding means freeing it
+            return NULL;
+        }
+    }
+
     // Block while full, release the lock while waiting
-    while (queue->count == queue->capacity) {
+    uint64_t blocked_from = 0;
+    while (!queue->discarding && cp_is_full(queue, need)) {
+        if (!blocked_from) blocked_from = cp_now_ns();
+        if (!cp_is_full_local(queue, need) && cp_is_full_shared(queue, need)) {
+            // only the shared budget is short: any queue's release wakes us,
+            // including our own consumer emptying this queue (registered
+            // before unlocking so that release cannot slip by)
+            unsigned long token = mem_budget_prepare_wait(queue->shared);
+            pthread_mutex_unlock(&queue->lock);
+            mem_budget_wait(queue->shared, need, token);
+            pthread_mutex_lock(&queue->lock);
+            continue;
+        }
+        // reset under the queue lock so a get that frees space after this
+        // point is guaranteed to leave the monitor signaled
+        monitor_reset(&queue->not_full_monitor);
+        queue->blocked_producers++;
         pthread_mutex_unlock(&queue->lock);
         (void)monitor_wait(&queue->not_full_monitor);
         pthread_mutex_lock(&queue->lock);
+        queue->blocked_producers--;
+    }
+    if (blocked_from) queue->stats.blocked_ns += cp_now_ns() - blocked_from;
+    if (queue->discarding) { // stopped while we waited
+        queue->stats.discarded++;
+        free((void*)item);
+        return NULL;
+    }
+
+    if (queue->count == queue->capacity && cp_grow(queue) != 0) {
+        return "queue grow failed";
     }
 
+    queue->frag_state = (frag & CP_ITEM_MORE) ? CP_FRAG_KEEP : CP_FRAG_NONE;
     int was_empty = (queue->count == 0);
     queue->items[queue->tail] = (char*)item;     
+    queue->metas[queue->tail] = meta ? *meta : (cp_item_meta_t){0};
+    if (meta && meta->trace_id) queue->metas[queue->tail].enqueued_ns = cp_now_ns();
+    queue->metas[queue->tail].spill_mark = queue->spill_in;
     queue->tail = (queue->tail + 1) % queue->capacity;
     queue->count++;
+    queue->bytes += need;
+    if (queue->shared) mem_budget_charge(queue->shared, need);
+
+    queue->stats.puts++;
+    if (queue->count > queue->stats.peak_count) queue->stats.peak_count = queue->count;
+    if (queue->bytes > queue->stats.peak_bytes) queue->stats.peak_bytes = queue->bytes;
 
     if (was_empty) {
         monitor_signal(&queue->not_empty_monitor);
     }
 
-    if (queue->count == queue->capacity) {
+    if (cp_at_item_limit(queue)) {
         monitor_reset(&queue->not_full_monitor);
     }
 
+    return NULL;
+}
+
+static const char* cp_put(consumer_producer_t* queue, const char* item, const cp_item_meta_t* meta,
+                          int may_shed) {
+    if (queue == NULL)      return "queue is NULL";
+    if (!queue->is_initialized) return "queue is not initialized";
+    if (item == NULL)           return "item is NULL";
+
+    pthread_mutex_lock(&queue->lock);
+    const char* err = cp_put_locked(queue, item, meta, may_shed);
+    pthread_mutex_unlock(&queue->lock);
+    return err;
+}
+
+const char* consumer_producer_put(consumer_producer_t* queue, const char* item) {
+    return cp_put(queue, item, NULL, 1);
+}
+
+const char* consumer_producer_put_meta(consumer_producer_t* queue, const char* item,
+                                       const cp_item_meta_t* meta) {
+    return cp_put(queue, item, meta, 1);
+}
+
+const char* consumer_producer_put_blocking(consumer_producer_t* queue, const char* item) {
+    return cp_put(queue, item, NULL, 0);
+}
+
+const char* consumer_producer_put_packed(consumer_producer_t* queue, const char* items, size_t count,
+                                         const cp_item_meta_t* meta) {
+    if (queue == NULL)          return "queue is NULL";
+    if (!queue->is_initialized) return "queue is not initialized";
+    if (items == NULL)          return "items is NULL";
+
+    // one lock round for the whole batch: the consumer, woken by the first
+    // item, gets the lock back once all of them are in (or a put waits)
+    const char* err = NULL;
+    pthread_mutex_lock(&queue->lock);
+    for (size_t i = 0; i < count && !err; ++i) {
+        size_t n = strlen(items) + 1;
+        char* copy = (char*)malloc(n);
+        if (!copy) {
+            err = "alloc failed";
+            break;
+        }
+        memcpy(copy, items, n);
+        err = cp_put_locked(queue, copy, meta, 1);
+        if (err) free(copy);
+        items += n;
+    }
     pthread_mutex_unlock(&queue->lock);
+    return err;
+}
+
+const char* consumer_producer_push_inline(consumer_producer_t* queue, char* item, const cp_item_meta_t* meta) {
+    if (queue == NULL || !queue->inline_mode) return "queue is not inline";
+    if (item == NULL)                         return "item is NULL";
+    if (queue->discarding) { // stopped: accept and throw away, like cp_put_locked
+        queue->stats.discarded++;
+        free(item);
+        return NULL;
+    }
+    if (queue->finished) return "queue finished";
+    if (queue->count == queue->capacity && cp_grow(queue) != 0) return "queue grow failed";
+
+    queue->items[queue->tail] = item;
+    queue->metas[queue->tail] = meta ? *meta : (cp_item_meta_t){0};
+    if (meta && meta->trace_id) queue->metas[queue->tail].enqueued_ns = cp_now_ns();
+    queue->tail = (queue->tail + 1) % queue->capacity;
+    queue->count++;
+    queue->bytes += consumer_producer_item_size(item, meta);
+
+    queue->stats.puts++;
+    if (queue->count > queue->stats.peak_count) queue->stats.peak_count = queue->count;
+    if (queue->bytes > queue->stats.peak_bytes) queue->stats.peak_bytes = queue->bytes;
     return NULL;
 }
 
+char* consumer_producer_pop_inline(consumer_producer_t* queue, cp_item_meta_t* meta, unsigned* ctl) {
+    *ctl = 0;
+    if (queue == NULL || !queue->inline_mode) return NULL;
+
+    // the control lane goes first; it is the one field other threads write
+    if (__atomic_load_n(&queue->control, __ATOMIC_RELAXED) != 0) {
+        *ctl = __atomic_exchange_n(&queue->control, 0u, __ATOMIC_ACQ_REL);
+        if ((*ctl & CP_CTL_STOP) && !queue->discarding) {
+            queue->discarding = 1;
+            while (queue->count > 0) {
+                cp_evict_head(queue);
+                queue->stats.discarded++;
+            }
+        }
+        if (*ctl) return NULL;
+    }
+    if (queue->count == 0) return NULL;
+
+    char* item = queue->items[queue->head];
+    queue->items[queue->head] = NULL;
+    queue->bytes -= consumer_producer_item_size(item, &queue->metas[queue->head]);
+    if (meta) *meta = queue->metas[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    queue->stats.gets++;
+    return item;
+}
+
 char* consumer_producer_get(consumer_producer_t* queue) {
+    return consumer_producer_get_meta(queue, NULL);
+}
+
+char* consumer_producer_get_meta(consumer_producer_t* queue, cp_item_meta_t* meta) {
+    return consumer_producer_get_ctl(queue, meta, NULL);
+}
+
+char* consumer_producer_get_ctl(consumer_producer_t* queue, cp_item_meta_t* meta, unsigned* ctl) {
+    return consumer_producer_get_seq(queue, meta, ctl, NULL);
+}
+
+char* consumer_producer_get_seq(consumer_producer_t* queue, cp_item_meta_t* meta, unsigned* ctl, uint64_t* seq) {
+    if (ctl) *ctl = 0;
     if (queue == NULL)  return NULL;
     if (!queue->is_initialized) return NULL;
 
     pthread_mutex_lock(&queue->lock);
 
-    while (queue->count == 0 && !queue->finished) {
-        pthread_mutex_unlock(&queue->lock);
-        (void)monitor_wait(&queue->not_empty_monitor);
-        pthread_mutex_lock(&queue->lock);
-    }
+    // back for more: the consumer is idle until it returns something, and a
+    // producer serving an item in its place goes first (latency mode)
+    queue->serving = 0;
+    for (;;) { // once more after a failed replay
+        while (queue->claimed || (cp_is_drained(queue) && !queue->finished && !(ctl && queue->control))) {
+            // reset under the lock: a put or post after this point re-signals
+            monitor_reset(&queue->not_empty_monitor);
+            pthread_mutex_unlock(&queue->lock);
+            (void)monitor_wait(&queue->not_empty_monitor);
+            pthread_mutex_lock(&queue->lock);
+        }
 
-    if (queue->count == 0 && queue->finished) {
-        pthread_mutex_unlock(&queue->lock);
-        return NULL;
+        // the control lane goes first
+        if (ctl && queue->control) {
+            *ctl = queue->control;
+            queue->control = 0;
+            queue->serving = queue->latency_mode;
+            pthread_mutex_unlock(&queue->lock);
+            return NULL;
+        }
+
+        if (cp_is_drained(queue) && queue->finished) {
+            pthread_mutex_unlock(&queue->lock);
+            return NULL;
+        }
+
+        // replay from disk while the oldest item is there: memory is empty, or
+        // its head was queued after items that are still spilled
+        if (queue->count == 0 ||
+            (spill_count(queue->spill) > 0 && queue->metas[queue->head].spill_mark > queue->spill_out)) {
+            const char* serr = NULL;
+            char* spilled = spill_pop(queue->spill, meta, &serr);
+            if (serr) {
+                // the item stays spilled: report it, or wait and try again
+                if (ctl) {
+                    *ctl = CP_CTL_SPILL_ERROR;
+                    pthread_mutex_unlock(&queue->lock);
+                    return NULL;
+                }
+                // the lock is free while waiting, then everything is checked again
+                pthread_mutex_unlock(&queue->lock);
+                struct timespec ts = { 0, 10 * 1000000L };
+                nanosleep(&ts, NULL);
+                pthread_mutex_lock(&queue->lock);
+                continue;
+            }
+            if (spilled) {
+                queue->spill_out++;
+                queue->stats.gets++;
+                if (seq) *seq = queue->next_seq;
+                queue->next_seq++;
+                queue->serving = queue->latency_mode;
+            }
+            if (cp_is_drained(queue)) {
+                monitor_reset(&queue->not_empty_monitor);
+                if (queue->finished) monitor_signal(&queue->finished_monitor);
+            }
+            pthread_mutex_unlock(&queue->lock);
+            return spilled;
+        }
+        break;
     }
 
-    int was_full = (queue->count == queue->capacity);
+    int was_full = cp_at_item_limit(queue);
     char* item = queue->items[queue->head];
     queue->items[queue->head] = NULL;  
+    size_t n = consumer_producer_item_size(item, &queue->metas[queue->head]);
+    if (meta) *meta = queue->metas[queue->head];
     queue->head = (queue->head + 1) % queue->capacity;
     queue->count--;
-
-    
-    if (was_full) {
+    queue->bytes -= n;
+    if (queue->shared) mem_budget_release(queue->shared, n);
+    queue->stats.gets++;
+    queue->serving = queue->latency_mode;
+    if (seq) *seq = queue->next_seq;
+    queue->next_seq++;
+
+    // wake producers blocked on the item limit or on the byte budget
+    if (was_full || queue->blocked_producers > 0) {
         monitor_signal(&queue->not_full_monitor);
     }
     
-    if (queue->count == 0) {
+    if (cp_is_drained(queue)) {
         monitor_reset(&queue->not_empty_monitor);
         if (queue->finished) {
             monitor_signal(&queue->finished_monitor);
@@ -194,6 +675,63 @@ char* consumer_producer_get(consumer_producer_t* queue) {
     return item;
 }
 
+int consumer_producer_try_claim(consumer_producer_t* queue, size_t count) {
+    if (queue == NULL || !queue->is_initialized || !queue->latency_mode) return 0;
+    // unlocked first look, the common answer under load (checked again below)
+    if (__atomic_load_n(&queue->count, __ATOMIC_RELAXED) || __atomic_load_n(&queue->serving, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    int ok = !queue->serving && !queue->claimed && !queue->finished && !queue->discarding &&
+             !queue->control && cp_is_drained(queue);
+    if (ok) {
+        queue->claimed = 1;
+        queue->stats.puts += count;
+        queue->stats.gets += count;
+        queue->stats.direct += count;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return ok;
+}
+
+void consumer_producer_release_claim(consumer_producer_t* queue) {
+    if (queue == NULL || !queue->is_initialized) return;
+
+    pthread_mutex_lock(&queue->lock);
+    queue->claimed = 0;
+    if (!cp_is_drained(queue) || queue->finished || queue->control) {
+        monitor_signal(&queue->not_empty_monitor); // the consumer waited for the claim to end
+    }
+    pthread_mutex_unlock(&queue->lock);
+}
+
+const char* consumer_producer_post_control(consumer_producer_t* queue, unsigned ctl) {
+    if (queue == NULL)          return "queue is NULL";
+    if (!queue->is_initialized) return "queue is not initialized";
+    if (queue->inline_mode) { // the owner thread takes it between items
+        __atomic_fetch_or(&queue->control, ctl, __ATOMIC_ACQ_REL);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    queue->control |= ctl;
+    if ((ctl & CP_CTL_STOP) && !queue->discarding) {
+        queue->discarding = 1;
+        while (queue->count > 0) {
+            cp_evict_head(queue);
+            queue->stats.discarded++;
+        }
+        queue->stats.discarded += spill_count(queue->spill);
+        spill_clear(queue->spill);
+        queue->spill_out = queue->spill_in;
+        monitor_signal(&queue->not_full_monitor); // blocked producers drop their item
+    }
+    monitor_signal(&queue->not_empty_monitor);
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
 void consumer_producer_signal_finished(consumer_producer_t* queue) {
     // validate input
     if (queue == NULL) return;
@@ -206,7 +744,7 @@ void consumer_producer_signal_finished(consumer_producer_t* queue) {
         monitor_signal(&queue->not_empty_monitor);// consumers blocked on empty
         monitor_signal(&queue->not_full_monitor); // producers blocked on full
 
-        if (queue->count == 0) { 
+        if (cp_is_drained(queue)) {
             monitor_signal(&queue->finished_monitor); 
         }
     }
@@ -224,3 +762,31 @@ int consumer_producer_wait_finished(consumer_producer_t* queue) {
     (void)monitor_wait(&queue->finished_monitor);
     return 0;
 }
+
+void consumer_producer_get_stats(consumer_producer_t* queue, cp_stats_t* out) {
+    if (out == NULL) return;
+    *out = (cp_stats_t){0};
+    if (queue == NULL || !queue->is_initialized) return;
+
+    pthread_mutex_lock(&queue->lock);
+    *out = queue->stats;
+    pthread_mutex_unlock(&queue->lock);
+}
+
+int consumer_producer_count(consumer_producer_t* queue) {
+    if (queue == NULL || !queue->is_initialized) return 0;
+    if (queue->inline_mode) return queue->count; // only its own thread asks
+    pthread_mutex_lock(&queue->lock);
+    int n = queue->count + (int)spill_count(queue->spill);
+    pthread_mutex_unlock(&queue->lock);
+    return n;
+}
+
+int consumer_producer_parse_policy(const char* name, cp_overflow_policy_t* out) {
+    if (name == NULL || out == NULL) return -1;
+    if (strcmp(name, "block") == 0)       { *out = CP_OVERFLOW_BLOCK;       return 0; }
+    if (strcmp(name, "drop-newest") == 0) { *out = CP_OVERFLOW_DROP_NEWEST; return 0; }
+    if (strcmp(name, "drop-oldest") == 0) { *out = CP_OVERFLOW_DROP_OLDEST; return 0; }
+    if (strcmp(name, "sample") == 0)      { *out = CP_OVERFLOW_SAMPLE;      return 0; }
+    return -1;
+}
@@ -2,8 +2,71 @@
 #define CONSUMER_PRODUCER_H
 
 #include "monitor.h"
+#include "mem_budget.h"
+#include "spill.h"
+#include "columns.h"
+#include <stddef.h>
 #include <stdint.h>
 #define CP_MAGIC 0xC0DEC0DEu
+#define CP_INITIAL_SLOTS 64 /* starting size of a queue without an item limit */
+
+/**
+* What a producer does when the queue is full (item limit or byte budget reached)
+*/
+typedef enum
+{
+    CP_OVERFLOW_BLOCK = 0,   /* wait for space (default) */
+    CP_OVERFLOW_DROP_NEWEST, /* discard the incoming item */
+    CP_OVERFLOW_DROP_OLDEST, /* evict items from the head until the new one fits */
+    CP_OVERFLOW_SAMPLE       /* while full, admit 1 in N items (blocking) and drop the rest */
+} cp_overflow_policy_t;
+
+// Control-lane requests (consumer_producer_post_control), served before queued data.
+// Drain-then-stop needs no control message: it is <END> on the data lane.
+#define CP_CTL_STATS 0x1u /* report counters now */
+#define CP_CTL_FLUSH 0x2u /* flush buffered output */
+#define CP_CTL_STOP  0x4u /* immediate stop: discard queued and future items, then end */
+#define CP_CTL_SPILL_ERROR 0x8u /* returned by get only: replaying a spilled item failed, it stays queued */
+
+/**
+* Queue counters, snapshot with consumer_producer_get_stats
+*/
+typedef struct
+{
+    uint64_t puts;            /* items accepted into the queue */
+    uint64_t gets;            /* items handed to the consumer */
+    uint64_t dropped_newest;  /* incoming items shed by drop-newest */
+    uint64_t dropped_oldest;  /* queued items evicted by drop-oldest */
+    uint64_t dropped_sampled; /* incoming items shed by sample 1-in-N */
+    uint64_t budget_sheds;    /* sheds caused by the byte budget rather than the item limit */
+    uint64_t discarded;       /* items thrown away by an immediate stop */
+    uint64_t spilled;         /* items written to the disk spill instead of blocking */
+    uint64_t direct;          /* items the producer served itself (latency mode), also in puts and gets */
+    uint64_t blocked_ns;      /* total time producers spent waiting for space */
+    int      peak_count;      /* highest number of queued items seen */
+    size_t   peak_bytes;      /* highest number of queued payload bytes seen */
+    uint64_t peak_spill_bytes; /* highest number of bytes held in the spill */
+} cp_stats_t;
+
+// cp_item_meta_t.flags: an item that is a fragment of a larger record
+#define CP_ITEM_MORE 0x1u /* more fragments of this record follow */
+#define CP_ITEM_CONT 0x2u /* continues the previous fragment (not the record's first) */
+// cp_item_meta_t.flags: the payload is a cp_columns_t block, not a string
+#define CP_ITEM_COLUMNS 0x4u
+// cp_item_meta_t.flags: a record produced inside the chain (emitted, or a
+// row of a column batch); it is data even when it reads "<END>"
+#define CP_ITEM_DATA 0x8u
+
+/**
+* Per-item metadata carried alongside the payload (all zero = a whole, untraced record)
+*/
+typedef struct cp_item_meta
+{
+    unsigned flags;       /* CP_ITEM_* */
+    uint64_t trace_id;    /* sampled trace id, 0 = not traced */
+    uint64_t enqueued_ns; /* CLOCK_MONOTONIC ns when queued, stamped by put for traced items */
+    uint64_t spill_mark;  /* queue-internal: items spilled before this one was queued, stamped by put */
+} cp_item_meta_t;
 
 
 /**
@@ -13,7 +76,9 @@
 typedef struct
 {
     char** items; /* Array of string pointers */
-    int capacity; /* Maximum number of items */
+    cp_item_meta_t* metas; /* Metadata, parallel to items */
+    int capacity; /* Allocated slots (the item limit, unless max_items is 0) */
+    int max_items; /* Item limit, 0 = none (the queue grows; bound it with a byte budget) */
     int count; /* Current number of items */
     int head; /* Index of first item */
     int tail; /* Index of next insertion point */
@@ -25,12 +90,32 @@ typedef struct
     int finished; // flag to indicate if processing is finished (0 = not finished, 1 = finished)
     uint32_t magic; // magic cookie for strong init detection
 
+    // overflow handling (see consumer_producer_set_overflow)
+    cp_overflow_policy_t policy; // what put does when full
+    unsigned sample_every;       // N for CP_OVERFLOW_SAMPLE
+    unsigned sample_seq;         // arrivals seen while full (sample policy)
+    int frag_state;              // CP_FRAG_*: the shedding decision for the record being put in fragments
+    size_t byte_budget;          // max queued payload bytes, 0 = unlimited
+    size_t bytes;                // queued payload bytes (strlen + 1 per item)
+    mem_budget_t* shared;        // pipeline-wide budget charged alongside bytes, or NULL
+    int blocked_producers;       // producers waiting for space
+    unsigned control;            // pending CP_CTL_* requests (control lane)
+    int discarding;              // CP_CTL_STOP seen: puts are dropped
+    spill_t* spill;              // disk overflow taking puts while full, or NULL (owned)
+    uint64_t spill_in, spill_out; // items spilled and replayed so far: order between memory and disk
+    int inline_mode;             // one thread puts and gets: plain ring, no lock (see set_inline)
+    int latency_mode;            // producers may serve an idle consumer's items (see try_claim)
+    int serving;                 // latency mode: the consumer is handling what get returned (not in get)
+    int claimed;                 // latency mode: a producer is serving an item in its place
+    uint64_t next_seq;           // sequence number of the next item handed out (see get_seq)
+    cp_stats_t stats;            // counters, protected by lock
+
 } consumer_producer_t;
 
 /**
 * Initialize a consumer-producer queue
 * @param queue Pointer to queue structure
-* @param capacity Maximum number of items
+* @param capacity Maximum number of items, 0 for no item limit (give the queue a byte budget)
 * @return NULL on success, error message on failure
 */
 const char* consumer_producer_init(consumer_producer_t* queue, int capacity);
@@ -41,15 +126,139 @@ const char* consumer_producer_init(consumer_producer_t* queue, int capacity);
  */
 void consumer_producer_destroy(consumer_producer_t* queue);
 
+/**
+* Select the overflow policy and byte budget (call before the queue is in use)
+* @param queue Pointer to queue structure
+* @param policy What put does when the queue is full
+* @param sample_every N for CP_OVERFLOW_SAMPLE (ignored otherwise, must be > 0 for sample)
+* @param byte_budget Max queued payload bytes, 0 = unlimited
+* @return NULL on success, error message on failure
+*/
+const char* consumer_producer_set_overflow(consumer_producer_t* queue, cp_overflow_policy_t policy,
+                                           unsigned sample_every, size_t byte_budget);
+
+/**
+* Also charge queued bytes to a budget shared with other queues (call before
+* the queue is in use). The queue counts as full while the shared budget is
+* exhausted, unless it is empty.
+* @param queue Pointer to queue structure
+* @param shared Shared budget (must outlive the queue), NULL to detach
+* @return NULL on success, error message on failure
+*/
+const char* consumer_producer_set_shared_budget(consumer_producer_t* queue, mem_budget_t* shared);
+
+/**
+* Spill to disk instead of blocking or shedding (call before the queue is in
+* use). While the queue is full, and until everything spilled has been
+* replayed, puts go to the spill; gets drain memory first, then the spill,
+* so order is kept. If the disk refuses an item the put falls back to
+* blocking until the spill is drained.
+* @param queue Pointer to queue structure
+* @param spill Spill created with spill_create, owned by the queue from now on
+* @return NULL on success, error message on failure
+*/
+const char* consumer_producer_set_spill(consumer_producer_t* queue, spill_t* spill);
+
+/**
+* Switch to single-thread use (call before the queue is in use): the owner
+* thread puts with consumer_producer_push_inline and gets with
+* consumer_producer_pop_inline, which take no lock and never block. Only
+* consumer_producer_post_control may still be called from other threads.
+* Overflow policies, byte budgets and the spill do not apply.
+* @param queue Pointer to queue structure
+* @return NULL on success, error message on failure
+*/
+const char* consumer_producer_set_inline(consumer_producer_t* queue);
+
+/**
+* Append an item to an inline queue. The ring grows rather than refuse an
+* item: the caller runs the consumer when it wants the queue drained.
+* @param item String to add (queue takes ownership)
+* @param meta Copied into the queue, NULL for none
+* @return NULL on success, error message on failure (caller keeps item)
+*/
+const char* consumer_producer_push_inline(consumer_producer_t* queue, char* item, const cp_item_meta_t* meta);
+
+/**
+* Take the oldest item of an inline queue, or pending control requests first
+* (a CP_CTL_STOP discards what is queued at this point)
+* @param meta Receives the item's metadata
+* @param ctl Receives the CP_CTL_* bits taken (then the return value is NULL), 0 otherwise
+* @return String item, NULL for a control request or when empty
+*/
+char* consumer_producer_pop_inline(consumer_producer_t* queue, cp_item_meta_t* meta, unsigned* ctl);
+
+/**
+* Enable direct handoff (call before the queue is in use): while the queue is
+* empty and its consumer idle, a producer may claim the consumer's role for
+* one item instead of queueing it. The consumer counts as idle while it waits
+* in get, and waits for a claim to end before taking anything, so order is kept.
+* @param queue Pointer to queue structure
+* @return NULL on success, error message on failure
+*/
+const char* consumer_producer_set_latency(consumer_producer_t* queue);
+
+/**
+* Try to serve items in the consumer's place (latency mode). Succeeds only
+* when nothing is queued or spilled, no control request is pending and the
+* consumer is neither handling an item nor finished. On success the items
+* count as put and got; the caller serves them, then calls
+* consumer_producer_release_claim.
+* @param queue Pointer to queue structure
+* @param count Number of items the caller is about to serve
+* @return 1 if claimed, 0 if the items must be queued as usual
+*/
+int consumer_producer_try_claim(consumer_producer_t* queue, size_t count);
+
+/**
+* End a claim taken with consumer_producer_try_claim, letting the consumer
+* take queued items again
+* @param queue Pointer to queue structure
+*/
+void consumer_producer_release_claim(consumer_producer_t* queue);
+
 /**
 * Add an item to the queue (producer).
-* Blocks if queue is full.
+* When full, follows the queue's overflow policy: blocks by default, or sheds
+* an item (the queue frees it and still returns NULL).
 * @param queue Pointer to queue structure
 * @param item String to add (queue takes ownership)
 * @return NULL on success, error message on failure
 */
 const char* consumer_producer_put(consumer_producer_t* queue, const char* item);
 
+/**
+* Add an item to the queue, always blocking while full regardless of policy.
+* Used for items that must never be shed, such as the <END> sentinel.
+* @param queue Pointer to queue structure
+* @param item String to add (queue takes ownership)
+* @return NULL on success, error message on failure
+*/
+const char* consumer_producer_put_blocking(consumer_producer_t* queue, const char* item);
+
+/**
+* Like consumer_producer_put, with metadata that travels with the item
+* @param meta Copied into the queue, NULL for none
+*/
+const char* consumer_producer_put_meta(consumer_producer_t* queue, const char* item,
+                                       const cp_item_meta_t* meta);
+
+/**
+* Add several items in one lock round, with one consumer wakeup. Each item
+* is copied, and each follows the overflow policy like consumer_producer_put.
+* @param items count NUL-terminated strings stored back to back
+* @param meta Copied into every item, NULL for none
+* @return NULL on success, error message on failure (earlier items stay queued)
+*/
+const char* consumer_producer_put_packed(consumer_producer_t* queue, const char* items, size_t count,
+                                         const cp_item_meta_t* meta);
+
+/**
+* Payload size of an item: the block size of a column batch, strlen + 1 for a string
+* @param meta The item's metadata, NULL for a plain string
+*/
+size_t consumer_producer_item_size(const char* item, const cp_item_meta_t* meta);
+
 /**
 * Remove an item from the queue (consumer) and returns it.
 * Blocks if queue is empty.
@@ -58,6 +267,38 @@ const char* consumer_producer_put(consumer_producer_t* queue, const char* item);
 */
 char* consumer_producer_get(consumer_producer_t* queue);
 
+/**
+* Like consumer_producer_get, also returning the item's metadata
+* @param meta Receives the metadata (zeroed for items put without any)
+*/
+char* consumer_producer_get_meta(consumer_producer_t* queue, cp_item_meta_t* meta);
+
+/**
+* Like consumer_producer_get_meta, but also returns for control requests:
+* pending requests are taken before any queued item.
+* @param ctl Receives the CP_CTL_* bits taken (then the return value is NULL), 0 otherwise
+* @return String item, or NULL for a control request or when finished and empty
+*/
+char* consumer_producer_get_ctl(consumer_producer_t* queue, cp_item_meta_t* meta, unsigned* ctl);
+
+/**
+* Like consumer_producer_get_ctl, also numbering the items handed out: 0, 1,
+* 2, ... in queue order. Several consumers use the numbers to pass results
+* on in the order the items were queued.
+* @param seq Receives the item's sequence number (unchanged for control requests)
+*/
+char* consumer_producer_get_seq(consumer_producer_t* queue, cp_item_meta_t* meta, unsigned* ctl, uint64_t* seq);
+
+/**
+* Post control requests for the consumer, ahead of all queued data. Requests
+* of the same kind that are still pending coalesce. CP_CTL_STOP also discards
+* what is queued right away and makes later puts drop their item.
+* @param queue Pointer to queue structure
+* @param ctl CP_CTL_* bits
+* @return NULL on success, error message on failure
+*/
+const char* consumer_producer_post_control(consumer_producer_t* queue, unsigned ctl);
+
 /**
 * Signal that processing is finished
 * @param queue Pointer to queue structure
@@ -71,4 +312,24 @@ void consumer_producer_signal_finished(consumer_producer_t* queue);
 */
 int consumer_producer_wait_finished(consumer_producer_t* queue);
 
+/**
+* Copy the queue counters
+* @param queue Pointer to queue structure
+* @param out Receives the snapshot
+*/
+void consumer_producer_get_stats(consumer_producer_t* queue, cp_stats_t* out);
+
+/**
+* Number of items currently queued, spilled ones included
+* @param queue Pointer to queue structure
+* @return Item count, 0 for an uninitialized queue
+*/
+int consumer_producer_count(consumer_producer_t* queue);
+
+/**
+* Parse an overflow policy name (block, drop-newest, drop-oldest, sample)
+* @return 0 on success, -1 if the name is unknown
+*/
+int consumer_producer_parse_policy(const char* name, cp_overflow_policy_t* out);
+
 #endif // CONSUMER_PRODUCER_H
\ No newline at end of file
@@ -0,0 +1,87 @@
+// mem_budget.c
+
+#include "mem_budget.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const char* mem_budget_init(mem_budget_t* budget, size_t limit) {
+    if (budget == NULL) return "budget is NULL";
+    if (limit == 0)     return "limit must be > 0";
+
+    budget->limit       = limit;
+    budget->release_seq = 0;
+    atomic_init(&budget->used, 0);
+    atomic_init(&budget->peak, 0);
+    atomic_init(&budget->waiters, 0);
+
+    if (pthread_mutex_init(&budget->lock, NULL) != 0) return "pthread_mutex_init failed";
+    if (pthread_cond_init(&budget->released, NULL) != 0) {
+        pthread_mutex_destroy(&budget->lock);
+        return "pthread_cond_init failed";
+    }
+    return NULL;
+}
+
+void mem_budget_destroy(mem_budget_t* budget) {
+    if (budget == NULL) return;
+    pthread_cond_destroy(&budget->released);
+    pthread_mutex_destroy(&budget->lock);
+}
+
+int mem_budget_fits(mem_budget_t* budget, size_t n) {
+    return atomic_load(&budget->used) + n <= budget->limit;
+}
+
+void mem_budget_charge(mem_budget_t* budget, size_t n) {
+    size_t now  = atomic_fetch_add(&budget->used, n) + n;
+    size_t peak = atomic_load(&budget->peak);
+    while (now > peak && !atomic_compare_exchange_weak(&budget->peak, &peak, now)) {
+        // peak was reloaded, retry
+    }
+}
+
+void mem_budget_release(mem_budget_t* budget, size_t n) {
+    atomic_fetch_sub(&budget->used, n);
+    // a waiter registers before re-checking `used`, so either it sees this
+    // release or we see it waiting
+    if (atomic_load(&budget->waiters) > 0) {
+        pthread_mutex_lock(&budget->lock);
+        budget->release_seq++;
+        pthread_cond_broadcast(&budget->released);
+        pthread_mutex_unlock(&budget->lock);
+    }
+}
+
+unsigned long mem_budget_prepare_wait(mem_budget_t* budget) {
+    pthread_mutex_lock(&budget->lock);
+    atomic_fetch_add(&budget->waiters, 1);
+    unsigned long seq = budget->release_seq;
+    pthread_mutex_unlock(&budget->lock);
+    return seq;
+}
+
+void mem_budget_wait(mem_budget_t* budget, size_t n, unsigned long token) {
+    pthread_mutex_lock(&budget->lock);
+    while (!mem_budget_fits(budget, n) && token == budget->release_seq) {
+        pthread_cond_wait(&budget->released, &budget->lock);
+    }
+    atomic_fetch_sub(&budget->waiters, 1);
+    pthread_mutex_unlock(&budget->lock);
+}
+
+int mem_budget_parse_size(const char* s, size_t* out) {
+    if (!s || !*s || s[0] == '-') return -1;
+    errno = 0;
+    char* endp = NULL;
+    unsigned long long v = strtoull(s, &endp, 10);
+    if (endp == s || errno == ERANGE) return -1;
+    unsigned shift = 0;
+    if (*endp == 'K' || *endp == 'k')      { shift = 10; endp++; }
+    else if (*endp == 'M' || *endp == 'm') { shift = 20; endp++; }
+    else if (*endp == 'G' || *endp == 'g') { shift = 30; endp++; }
+    if (*endp != '\0' || v == 0 || v > (SIZE_MAX >> shift)) return -1;
+    *out = (size_t)(v << shift);
+    return 0;
+}
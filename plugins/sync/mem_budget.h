@@ -0,0 +1,79 @@
+#ifndef MEM_BUDGET_H
+#define MEM_BUDGET_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+/**
+* Byte budget shared by every queue of a pipeline (--memory-budget).
+* Queues charge an item's payload bytes when it is queued and release them
+* when it leaves. A queue that is empty may always admit one item, so the
+* chain keeps moving even when upstream queues hold the whole budget; the
+* budget can therefore be exceeded by at most one item per stage.
+*/
+typedef struct
+{
+    size_t          limit;   /* bytes */
+    _Atomic size_t  used;    /* bytes currently charged */
+    _Atomic size_t  peak;    /* highest value of used */
+    _Atomic int     waiters; /* producers sleeping in mem_budget_wait */
+    unsigned long   release_seq; /* bumped under lock when waiters are woken */
+    pthread_mutex_t lock;
+    pthread_cond_t  released;
+} mem_budget_t;
+
+/**
+* Initialize a shared budget
+* @param budget Pointer to budget structure
+* @param limit Maximum bytes (> 0)
+* @return NULL on success, error message on failure
+*/
+const char* mem_budget_init(mem_budget_t* budget, size_t limit);
+
+/**
+* Destroy a shared budget (no queue may still use it)
+* @param budget Pointer to budget structure
+*/
+void mem_budget_destroy(mem_budget_t* budget);
+
+/**
+* Check whether n more bytes fit right now
+* @return 1 if they fit, 0 otherwise
+*/
+int mem_budget_fits(mem_budget_t* budget, size_t n);
+
+/**
+* Charge n bytes (unconditionally, call after deciding to admit)
+*/
+void mem_budget_charge(mem_budget_t* budget, size_t n);
+
+/**
+* Release n bytes and wake producers waiting for room
+*/
+void mem_budget_release(mem_budget_t* budget, size_t n);
+
+/**
+* Register as a waiter. Call while still holding the lock that protects the
+* caller's own condition, so a release made after dropping it is not missed.
+* @return Token for mem_budget_wait
+*/
+unsigned long mem_budget_prepare_wait(mem_budget_t* budget);
+
+/**
+* Sleep until n bytes fit or some bytes were released since
+* mem_budget_prepare_wait, whichever comes first, then unregister.
+* Callers re-check their own conditions afterwards.
+*/
+void mem_budget_wait(mem_budget_t* budget, size_t n, unsigned long token);
+
+/**
+* Parse a byte count: a positive number with an optional K, M or G suffix
+* (powers of 1024). Used for every byte-size option, host and stage alike.
+* @param s Text to parse
+* @param out Receives the count on success
+* @return 0 on success, -1 if s is not a positive byte count or overflows
+*/
+int mem_budget_parse_size(const char* s, size_t* out);
+
+#endif // MEM_BUDGET_H
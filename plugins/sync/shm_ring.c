@@ -0,0 +1,301 @@
+// shm_ring.c
+
+#include "shm_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHM_RING_MAGIC     0x474e4952u // "RING"
+#define SHM_RING_HDR_BYTES 4096u       // header page, the data area starts after it
+#define SHM_RING_WRAP      0xffffffffu // record length: continue at the start of the data area
+#define SHM_RING_POLL_MS   100         // liveness check interval of a blocked writer
+#define SHM_RING_OPEN_MS   2000        // how long to wait for a concurrent creator
+
+typedef struct
+{
+    _Atomic uint32_t magic;          /* stored last by the creator */
+    uint32_t         unused;
+    uint64_t         capacity;       /* data bytes, power of two */
+    _Atomic int32_t  pid[2];         /* writer, reader; 0 until attached */
+    _Atomic uint32_t writer_done;    /* SHM_RING_END was written */
+
+    _Alignas(64) _Atomic uint64_t head; /* bytes consumed, reader-owned */
+    _Atomic uint32_t space_seq;      /* futex word, bumped for a waiting writer */
+    _Atomic uint32_t writer_waiting;
+
+    _Alignas(64) _Atomic uint64_t tail; /* bytes produced, writer-owned */
+    _Atomic uint32_t data_seq;       /* futex word, bumped for a waiting reader */
+    _Atomic uint32_t reader_waiting;
+} shm_ring_hdr_t;
+
+struct shm_ring
+{
+    shm_ring_hdr_t* hdr;
+    char*           data;
+    size_t          map_bytes;
+    uint64_t        mask;
+    int             role;
+    uint64_t        cached_head;     /* writer: last head seen */
+    uint64_t        cached_tail;     /* reader: last tail seen */
+    uint64_t        peek_bytes;      /* reader: size of the record being peeked */
+    char            path[NAME_MAX + 2];
+};
+
+static long futex_wait(_Atomic uint32_t* word, uint32_t expected, int timeout_ms) {
+    struct timespec ts = { timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L };
+    return syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, expected, &ts, NULL, 0);
+}
+
+static void futex_wake(_Atomic uint32_t* word) {
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static int pid_alive(int32_t pid) {
+    return pid == 0 || kill((pid_t)pid, 0) == 0 || errno == EPERM;
+}
+
+static uint64_t record_bytes(uint32_t len) {
+    return 8u + (((uint64_t)len + 7u) & ~(uint64_t)7u); // {len, flags} header, payload padded to 8
+}
+
+static int valid_name(const char* name) {
+    size_t n = name ? strlen(name) : 0;
+    if (n == 0 || n > NAME_MAX) return 0;
+    for (const char* p = name; *p; ++p) {
+        char c = *p;
+        int ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                 c == '-' || c == '_' || c == '.';
+        if (!ok) return 0;
+    }
+    return 1;
+}
+
+static void sleep_ms(int ms) {
+    struct timespec ts = { 0, (long)ms * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+// Map an existing segment once its creator has published the header
+static shm_ring_hdr_t* map_existing(int fd, size_t* map_bytes) {
+    struct stat st;
+    for (int waited = 0;; waited += 10) {
+        if (fstat(fd, &st) != 0) return NULL;
+        if ((size_t)st.st_size > SHM_RING_HDR_BYTES) break;
+        if (waited >= SHM_RING_OPEN_MS) return NULL;
+        sleep_ms(10);
+    }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return NULL;
+    shm_ring_hdr_t* hdr = (shm_ring_hdr_t*)p;
+    for (int waited = 0; atomic_load_explicit(&hdr->magic, memory_order_acquire) != SHM_RING_MAGIC; waited += 10) {
+        if (waited >= SHM_RING_OPEN_MS) {
+            munmap(p, (size_t)st.st_size);
+            return NULL;
+        }
+        sleep_ms(10);
+    }
+    if (SHM_RING_HDR_BYTES + hdr->capacity != (uint64_t)st.st_size) {
+        munmap(p, (size_t)st.st_size);
+        return NULL;
+    }
+    *map_bytes = (size_t)st.st_size;
+    return hdr;
+}
+
+shm_ring_t* shm_ring_attach(const char* name, size_t bytes, int role, const char** err) {
+    *err = NULL;
+    if (!valid_name(name)) { *err = "invalid ring name"; return NULL; }
+    if (role != SHM_RING_WRITER && role != SHM_RING_READER) { *err = "invalid ring role"; return NULL; }
+
+    uint64_t cap = 4096;
+    if (bytes == 0) bytes = SHM_RING_DEFAULT_BYTES;
+    while (cap < bytes && cap < ((uint64_t)1 << 40)) cap <<= 1;
+
+    shm_ring_t* r = (shm_ring_t*)calloc(1, sizeof(*r));
+    if (!r) { *err = "alloc failed"; return NULL; }
+    snprintf(r->path, sizeof(r->path), "/%s", name);
+    r->role = role;
+
+    // a second round only after removing a segment left by a dead process
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        int created = 1;
+        int fd = shm_open(r->path, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 && errno == EEXIST) {
+            created = 0;
+            fd = shm_open(r->path, O_RDWR, 0);
+        }
+        if (fd < 0) { *err = "shm_open failed"; break; }
+
+        shm_ring_hdr_t* hdr = NULL;
+        if (created) {
+            r->map_bytes = SHM_RING_HDR_BYTES + cap;
+            void* p = (ftruncate(fd, (off_t)r->map_bytes) == 0)
+                    ? mmap(NULL, r->map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+            if (p != MAP_FAILED) {
+                hdr = (shm_ring_hdr_t*)p; // fresh segments are zero-filled
+                hdr->capacity = cap;
+                atomic_store_explicit(&hdr->magic, SHM_RING_MAGIC, memory_order_release);
+            } else {
+                shm_unlink(r->path);
+            }
+        } else {
+            hdr = map_existing(fd, &r->map_bytes);
+        }
+        close(fd);
+        if (!hdr) { *err = created ? "cannot size shared memory" : "ring segment not ready or corrupt"; break; }
+
+        int32_t none = 0;
+        if (atomic_compare_exchange_strong(&hdr->pid[role], &none, (int32_t)getpid())) {
+            r->hdr = hdr;
+            r->data = (char*)hdr + SHM_RING_HDR_BYTES;
+            r->mask = hdr->capacity - 1;
+            r->cached_head = atomic_load(&hdr->head);
+            r->cached_tail = atomic_load(&hdr->tail);
+            return r;
+        }
+        munmap(hdr, r->map_bytes);
+        if (pid_alive(none)) {
+            *err = (role == SHM_RING_WRITER) ? "ring already has a writer" : "ring already has a reader";
+            break;
+        }
+        shm_unlink(r->path); // stale, from a run that crashed
+    }
+    if (!*err) *err = "ring already in use";
+    free(r);
+    return NULL;
+}
+
+void shm_ring_detach(shm_ring_t* ring) {
+    if (!ring) return;
+    // the reader owns the name: a writer that finishes first must leave the
+    // records for a reader that has not attached yet
+    if (ring->role == SHM_RING_READER) shm_unlink(ring->path);
+    munmap(ring->hdr, ring->map_bytes);
+    free(ring);
+}
+
+size_t shm_ring_max_record(const shm_ring_t* ring) {
+    uint64_t half = ring->hdr->capacity / 2; // a multiple of 8, as record_bytes pads
+    uint64_t n = half - 8 - 1;               // header and NUL
+    return n >= UINT32_MAX ? UINT32_MAX - 1 : (size_t)n;
+}
+
+const char* shm_ring_write(shm_ring_t* ring, const char* s, uint32_t flags) {
+    shm_ring_hdr_t* hdr = ring->hdr;
+    uint64_t cap  = hdr->capacity;
+    uint32_t len  = (uint32_t)strlen(s) + 1;
+    uint64_t need = record_bytes(len);
+    if (strlen(s) >= UINT32_MAX || need > cap / 2) return "record larger than half the ring";
+
+    uint64_t tail   = atomic_load_explicit(&hdr->tail, memory_order_relaxed);
+    uint64_t pos    = tail & ring->mask;
+    uint64_t contig = cap - pos;
+    uint64_t total  = need + (contig < need ? contig : 0); // a record never wraps
+
+    while (cap - (tail - ring->cached_head) < total) {
+        ring->cached_head = atomic_load_explicit(&hdr->head, memory_order_acquire);
+        if (cap - (tail - ring->cached_head) >= total) break;
+
+        // full: sleep until the reader frees space (or the poll interval passes)
+        uint32_t seq = atomic_load(&hdr->space_seq);
+        atomic_store(&hdr->writer_waiting, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        ring->cached_head = atomic_load_explicit(&hdr->head, memory_order_acquire);
+        if (cap - (tail - ring->cached_head) < total) {
+            if (!pid_alive(atomic_load(&hdr->pid[SHM_RING_READER]))) {
+                atomic_store(&hdr->writer_waiting, 0);
+                return "ring reader exited";
+            }
+            (void)futex_wait(&hdr->space_seq, seq, SHM_RING_POLL_MS);
+        }
+        atomic_store(&hdr->writer_waiting, 0);
+    }
+
+    if (contig < need) {
+        *(uint32_t*)(ring->data + pos) = SHM_RING_WRAP;
+        tail += contig;
+        pos = 0;
+    }
+    uint32_t* rec = (uint32_t*)(ring->data + pos);
+    rec[0] = len;
+    rec[1] = flags;
+    memcpy(ring->data + pos + 8, s, len);
+    atomic_store_explicit(&hdr->tail, tail + need, memory_order_release);
+    if (flags & SHM_RING_END) atomic_store(&hdr->writer_done, 1);
+
+    // only enter the kernel when the reader sleeps
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&hdr->reader_waiting, memory_order_relaxed)) {
+        atomic_fetch_add(&hdr->data_seq, 1);
+        futex_wake(&hdr->data_seq);
+    }
+    return NULL;
+}
+
+// Reader: give n bytes back to the writer
+static void advance_head(shm_ring_t* ring, uint64_t n) {
+    shm_ring_hdr_t* hdr = ring->hdr;
+    uint64_t head = atomic_load_explicit(&hdr->head, memory_order_relaxed) + n;
+    atomic_store_explicit(&hdr->head, head, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&hdr->writer_waiting, memory_order_relaxed)) {
+        atomic_fetch_add(&hdr->space_seq, 1);
+        futex_wake(&hdr->space_seq);
+    }
+}
+
+int shm_ring_peek(shm_ring_t* ring, const char** s, uint32_t* flags, int timeout_ms) {
+    shm_ring_hdr_t* hdr = ring->hdr;
+    int waited = 0;
+    for (;;) {
+        uint64_t head = atomic_load_explicit(&hdr->head, memory_order_relaxed);
+        if (head == ring->cached_tail) {
+            ring->cached_tail = atomic_load_explicit(&hdr->tail, memory_order_acquire);
+        }
+        if (head != ring->cached_tail) {
+            uint64_t pos = head & ring->mask;
+            const uint32_t* rec = (const uint32_t*)(ring->data + pos);
+            if (rec[0] == SHM_RING_WRAP) {
+                advance_head(ring, hdr->capacity - pos);
+                continue;
+            }
+            *s = ring->data + pos + 8;
+            *flags = rec[1];
+            ring->peek_bytes = record_bytes(rec[0]);
+            return 1;
+        }
+        if (waited) return 0;
+
+        uint32_t seq = atomic_load(&hdr->data_seq);
+        atomic_store(&hdr->reader_waiting, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        ring->cached_tail = atomic_load_explicit(&hdr->tail, memory_order_acquire);
+        if (head == ring->cached_tail) {
+            if (!atomic_load(&hdr->writer_done) && !pid_alive(atomic_load(&hdr->pid[SHM_RING_WRITER]))) {
+                atomic_store(&hdr->reader_waiting, 0);
+                return -1;
+            }
+            (void)futex_wait(&hdr->data_seq, seq, timeout_ms); // EINTR counts as a timeout
+            waited = 1;
+        }
+        atomic_store(&hdr->reader_waiting, 0);
+    }
+}
+
+void shm_ring_release(shm_ring_t* ring) {
+    if (ring->peek_bytes == 0) return;
+    advance_head(ring, ring->peek_bytes);
+    ring->peek_bytes = 0;
+}
@@ -0,0 +1,66 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+* Single-producer single-consumer record ring in POSIX shared memory, the
+* stage boundary between two analyzer processes (shmout plugin on one side,
+* --input=shm:NAME on the other).
+* Records are written in place and read in place, and a side only enters
+* the kernel (futex) when the other one is asleep waiting for it. Both sides
+* record their pid, so a peer that died is noticed within one poll interval.
+*/
+
+#define SHM_RING_DEFAULT_BYTES (1u << 20)
+#define SHM_RING_END 0x80000000u // record flag: the writer's <END>
+
+#define SHM_RING_WRITER 0
+#define SHM_RING_READER 1
+
+typedef struct shm_ring shm_ring_t;
+
+/**
+* Attach to the ring called name as writer or reader, creating it if it does
+* not exist yet. Whichever side comes first decides the size.
+* @param name Segment name (letters, digits, '-', '_', '.'; without '/')
+* @param bytes Data capacity when creating, rounded up to a power of two
+* @param role SHM_RING_WRITER or SHM_RING_READER
+* @param err Set to a static error message on failure
+* @return Ring handle, NULL on failure
+*/
+shm_ring_t* shm_ring_attach(const char* name, size_t bytes, int role, const char** err);
+
+/**
+* Unmap the ring and remove its name (the other side keeps its mapping)
+*/
+void shm_ring_detach(shm_ring_t* ring);
+
+/**
+* Writer: copy one NUL-terminated record in, blocking while the ring is full
+* @param flags CP_ITEM_* bits, or SHM_RING_END for the last record
+* @return NULL on success, error message if the reader is gone or the record
+*         can never fit
+*/
+const char* shm_ring_write(shm_ring_t* ring, const char* s, uint32_t flags);
+
+/**
+* Longest record (without its NUL) that shm_ring_write accepts for this ring
+*/
+size_t shm_ring_max_record(const shm_ring_t* ring);
+
+/**
+* Reader: wait up to timeout_ms for the next record and expose it in place.
+* The record stays valid until shm_ring_release.
+* @return 1 with *s and *flags set, 0 on timeout, -1 if the writer died
+*         without writing SHM_RING_END
+*/
+int shm_ring_peek(shm_ring_t* ring, const char** s, uint32_t* flags, int timeout_ms);
+
+/**
+* Reader: drop the record returned by the last shm_ring_peek
+*/
+void shm_ring_release(shm_ring_t* ring);
+
+#endif // SHM_RING_H
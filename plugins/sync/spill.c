@@ -0,0 +1,182 @@
+// spill.c
+
+#include "spill.h"
+#include "consumer_producer.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SPILL_RECORD_HEADER 24u // u32 payload bytes (a string with its NUL), u32 flags, u64 trace_id, u64 enqueued_ns
+
+typedef struct spill_segment
+{
+    struct spill_segment* next;
+    char*  base;   /* mapping of the whole (unlinked) file */
+    size_t size;
+    size_t wpos;   /* append offset */
+    size_t rpos;   /* replay offset */
+} spill_segment_t;
+
+struct spill
+{
+    char path[PATH_MAX];     /* mkstemp template for new segments */
+    spill_segment_t* head;   /* oldest segment, replayed first */
+    spill_segment_t* tail;   /* segment being appended to */
+    uint64_t count;
+    uint64_t bytes;
+};
+
+static size_t record_bytes(size_t len) {
+    return SPILL_RECORD_HEADER + ((len + 7u) & ~(size_t)7u);
+}
+
+spill_t* spill_create(const char* dir, const char** err) {
+    *err = NULL;
+    spill_t* s = (spill_t*)calloc(1, sizeof(*s));
+    if (!s) { *err = "alloc failed"; return NULL; }
+    int n = snprintf(s->path, sizeof(s->path), "%s/analyzer-spill-XXXXXX", dir);
+    if (n <= 0 || (size_t)n >= sizeof(s->path)) {
+        free(s);
+        *err = "spill directory path too long";
+        return NULL;
+    }
+    // probe now, so a bad directory is an init error rather than a surprise under load
+    char probe[PATH_MAX];
+    memcpy(probe, s->path, (size_t)n + 1);
+    int fd = mkstemp(probe);
+    if (fd < 0) {
+        free(s);
+        *err = "cannot create files in spill directory";
+        return NULL;
+    }
+    unlink(probe);
+    close(fd);
+    return s;
+}
+
+static void free_segment(spill_segment_t* seg) {
+    munmap(seg->base, seg->size);
+    free(seg);
+}
+
+void spill_clear(spill_t* spill) {
+    if (!spill) return;
+    for (spill_segment_t* seg = spill->head; seg;) {
+        spill_segment_t* next = seg->next;
+        free_segment(seg);
+        seg = next;
+    }
+    spill->head = spill->tail = NULL;
+    spill->count = 0;
+    spill->bytes = 0;
+}
+
+void spill_destroy(spill_t* spill) {
+    if (!spill) return;
+    spill_clear(spill);
+    free(spill);
+}
+
+// Reserve the blocks up front: writing into a hole of a full disk through a
+// mapping would raise SIGBUS instead of returning an error
+static spill_segment_t* new_segment(spill_t* spill, size_t min_size) {
+    size_t size = SPILL_SEGMENT_BYTES;
+    while (size < min_size) size *= 2;
+
+    char path[PATH_MAX];
+    memcpy(path, spill->path, sizeof(path));
+    int fd = mkstemp(path);
+    if (fd < 0) return NULL;
+    unlink(path); // lives as long as the mapping
+    void* base = (posix_fallocate(fd, 0, (off_t)size) == 0)
+               ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    spill_segment_t* seg = (spill_segment_t*)calloc(1, sizeof(*seg));
+    if (!seg) {
+        munmap(base, size);
+        return NULL;
+    }
+    seg->base = (char*)base;
+    seg->size = size;
+    return seg;
+}
+
+const char* spill_push(spill_t* spill, const char* item, const cp_item_meta_t* meta) {
+    size_t len = consumer_producer_item_size(item, meta); // with the string's NUL
+    if (len > UINT32_MAX) return "item too large to spill";
+    size_t need = record_bytes(len);
+
+    spill_segment_t* seg = spill->tail;
+    if (!seg || seg->wpos + need > seg->size) {
+        seg = new_segment(spill, need);
+        if (!seg) return "cannot extend spill file";
+        if (spill->tail) spill->tail->next = seg;
+        else spill->head = seg;
+        spill->tail = seg;
+    }
+
+    char* rec = seg->base + seg->wpos;
+    uint32_t hdr[2] = { (uint32_t)len, meta ? meta->flags : 0u };
+    uint64_t trace[2] = { meta ? meta->trace_id : 0, meta ? meta->enqueued_ns : 0 };
+    memcpy(rec, hdr, sizeof(hdr));
+    memcpy(rec + 8, trace, sizeof(trace));
+    memcpy(rec + SPILL_RECORD_HEADER, item, len);
+    seg->wpos += need;
+    spill->count++;
+    spill->bytes += need;
+    return NULL;
+}
+
+char* spill_pop(spill_t* spill, cp_item_meta_t* meta, const char** err) {
+    *err = NULL;
+    spill_segment_t* seg = spill ? spill->head : NULL;
+    if (!seg || spill->count == 0) return NULL;
+    if (seg->rpos == seg->wpos) {
+        // replayed a finished segment: drop it (a non-empty spill has a next one)
+        spill->head = seg->next;
+        free_segment(seg);
+        seg = spill->head;
+    }
+
+    const char* rec = seg->base + seg->rpos;
+    uint32_t hdr[2];
+    uint64_t trace[2];
+    memcpy(hdr, rec, sizeof(hdr));
+    memcpy(trace, rec + 8, sizeof(trace));
+    char* item = (char*)malloc(hdr[0]);
+    if (!item) {
+        *err = "out of memory replaying a spilled item";
+        return NULL;
+    }
+    memcpy(item, rec + SPILL_RECORD_HEADER, hdr[0]);
+    if (meta) {
+        *meta = (cp_item_meta_t){0};
+        meta->flags = hdr[1];
+        meta->trace_id = trace[0];
+        meta->enqueued_ns = trace[1];
+    }
+
+    size_t used = record_bytes(hdr[0]);
+    seg->rpos += used;
+    spill->count--;
+    spill->bytes -= used;
+    if (seg->rpos == seg->wpos && seg == spill->tail) {
+        seg->rpos = seg->wpos = 0; // empty again: keep appending to the same mapping
+    }
+    return item;
+}
+
+uint64_t spill_count(const spill_t* spill) {
+    return spill ? spill->count : 0;
+}
+
+uint64_t spill_bytes(const spill_t* spill) {
+    return spill ? spill->bytes : 0;
+}
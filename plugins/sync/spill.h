@@ -0,0 +1,61 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct cp_item_meta;
+
+/**
+* Disk overflow for a queue: a FIFO of items appended to memory-mapped
+* segment files. Segments are unlinked as soon as they are created, so
+* nothing is left on disk after a crash, and a segment is unmapped once
+* fully replayed. Not thread safe: the owning queue calls it under its lock.
+*/
+typedef struct spill spill_t;
+
+#define SPILL_SEGMENT_BYTES (8u << 20)
+
+/**
+* Create an empty spill in directory dir
+* @param err Set to a static message on failure
+* @return Spill handle, NULL on failure
+*/
+spill_t* spill_create(const char* dir, const char** err);
+
+/**
+* Unmap and close every segment, dropping items not replayed yet
+*/
+void spill_destroy(spill_t* spill);
+
+/**
+* Drop every item, unmapping all segments (the spill stays usable)
+*/
+void spill_clear(spill_t* spill);
+
+/**
+* Append a copy of item (and its metadata) at the tail
+* @return NULL on success, error message on failure (disk full, ...)
+*/
+const char* spill_push(spill_t* spill, const char* item, const struct cp_item_meta* meta);
+
+/**
+* Take the oldest item
+* @param meta Receives its metadata (may be NULL)
+* @param err Set to a static message if the item could not be copied out;
+*        it then stays the oldest item
+* @return Heap copy of the item (caller frees), NULL when empty or on error
+*/
+char* spill_pop(spill_t* spill, struct cp_item_meta* meta, const char** err);
+
+/**
+* Items currently spilled
+*/
+uint64_t spill_count(const spill_t* spill);
+
+/**
+* Bytes currently held in segments (payload and record headers)
+*/
+uint64_t spill_bytes(const spill_t* spill);
+
+#endif // SPILL_H
@@ -0,0 +1,269 @@
+#include "plugin_common.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Splits records into fields once and hands them on as column batches
+// (columns.h): the records' bytes plus, for every field, an offset and a
+// length array. Stages that declare PLUGIN_FLAG_COLUMNS (cut) read the
+// fields from the arrays without scanning again; any other stage sees the
+// records one by one, unchanged.
+//
+// sep=STR is a single byte, e.g. sep=, for CSV: a field that starts with a
+// double quote runs to the closing quote and may contain the separator, the
+// quotes are not part of it and "" inside stands for one quote. Without sep,
+// fields are runs of bytes other than space and tab.
+// Records are gathered until batch=N of them are held, TOK_BATCH_BYTES of
+// record bytes are held, or the stage's queue runs dry.
+
+#define TOK_BATCH_DEFAULT 256
+#define TOK_BATCH_MAX     65536
+#define TOK_BATCH_BYTES   (1u << 20)
+
+typedef struct
+{
+    uint32_t off; // from the start of the batch's bytes
+    uint32_t len;
+} tok_field_t;
+
+static char     g_sep;       // 0 = runs of space and tab
+static uint32_t g_batch_rows = TOK_BATCH_DEFAULT;
+
+// The batch being gathered
+static char*        g_data;
+static size_t       g_data_len, g_data_cap;
+static uint32_t*    g_row_off;   // where each row starts in g_data
+static uint32_t*    g_row_field; // index of each row's first field in g_fields, rows + 1 entries
+static size_t       g_row_off_cap, g_row_field_cap;
+static uint32_t     g_rows;
+static tok_field_t* g_fields;
+static size_t       g_fields_len, g_fields_cap;
+static uint32_t     g_cols;
+
+static int grow(void** p, size_t* cap, size_t need, size_t elem) {
+    if (need <= *cap) return 0;
+    size_t n = *cap ? *cap : 64;
+    while (n < need) n *= 2;
+    void* q = realloc(*p, n * elem);
+    if (!q) return -1;
+    *p = q;
+    *cap = n;
+    return 0;
+}
+
+static int add_field(size_t off, size_t len) {
+    if (grow((void**)&g_fields, &g_fields_cap, g_fields_len + 1, sizeof(tok_field_t))) return -1;
+    g_fields[g_fields_len].off = (uint32_t)off;
+    g_fields[g_fields_len].len = (uint32_t)len;
+    g_fields_len++;
+    return 0;
+}
+
+// ---------------------------------------------------------------- scanning
+
+// Fields are the runs between spaces and tabs. 16 bytes at a time: a bit per
+// delimiter byte, and a field boundary wherever that bit flips.
+static int split_blank(size_t base, const char* s, size_t len) {
+    size_t i = 0, start = 0;
+    int in_field = 0;
+#ifdef __SSE2__
+    const __m128i sp = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    unsigned prev = 1; // "before the record" counts as a delimiter
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        unsigned delim = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, tab)));
+        unsigned flips = (delim ^ ((delim << 1) | prev)) & 0xFFFFu;
+        prev = delim >> 15;
+        while (flips) {
+            unsigned bit = (unsigned)__builtin_ctz(flips);
+            if (in_field) {
+                if (add_field(base + start, i + bit - start)) return -1;
+            } else {
+                start = i + bit;
+            }
+            in_field = !in_field;
+            flips &= flips - 1;
+        }
+    }
+#endif
+    for (; i < len; ++i) {
+        int delim = s[i] == ' ' || s[i] == '\t';
+        if (in_field && delim) {
+            if (add_field(base + start, i - start)) return -1;
+            in_field = 0;
+        } else if (!in_field && !delim) {
+            start = i;
+            in_field = 1;
+        }
+    }
+    if (in_field && add_field(base + start, len - start)) return -1;
+    return 0;
+}
+
+// First byte at or after p equal to a or b, or end
+static const char* find2(const char* p, const char* end, char a, char b) {
+#ifdef __SSE2__
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    for (; p + 16 <= end; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+#endif
+    for (; p < end; ++p)
+        if (*p == a || *p == b) return p;
+    return end;
+}
+
+// Fields separated by g_sep, double-quoted fields as in CSV. A quoted field
+// with "" in it is stored unquoted after the record (g_data grows), the
+// others point into the record itself.
+static int split_sep(size_t base, size_t len) {
+    size_t i = 0;
+    for (;;) {
+        const char* s = g_data + base; // g_data may move as unquoted fields are added
+        const char* end = s + len;
+        if (i < len && s[i] == '"') {
+            size_t open = i + 1, close = open;
+            int doubled = 0;
+            for (;;) {
+                close = (size_t)(find2(s + close, end, '"', '"') - s);
+                if (close + 1 < len && s[close + 1] == '"') {
+                    doubled = 1;
+                    close += 2;
+                    continue;
+                }
+                break; // closing quote, or an unterminated field running to the end
+            }
+            if (!doubled) {
+                if (add_field(base + open, close - open)) return -1;
+            } else {
+                size_t at = g_data_len, n = 0;
+                if (grow((void**)&g_data, &g_data_cap, g_data_len + (close - open), 1)) return -1;
+                s = g_data + base;
+                for (size_t k = open; k < close; ++k) {
+                    g_data[at + n++] = s[k];
+                    if (s[k] == '"') ++k; // "" -> "
+                }
+                g_data_len += n;
+                if (add_field(at, n)) return -1;
+                s = g_data + base;
+                end = s + len;
+            }
+            i = close < len ? close + 1 : len;
+            i = (size_t)(find2(s + i, end, g_sep, g_sep) - s); // bytes after the quote are dropped
+        } else {
+            size_t next = (size_t)(find2(s + i, end, g_sep, g_sep) - s);
+            if (add_field(base + i, next - i)) return -1;
+            i = next;
+        }
+        if (i >= len) return 0;
+        ++i; // past the separator; a trailing one leaves an empty last field
+        if (i == len) return add_field(base + len, 0);
+    }
+}
+
+// ---------------------------------------------------------------- batches
+
+static void reset_batch(void) {
+    g_data_len = 0;
+    g_rows = 0;
+    g_fields_len = 0;
+    g_cols = 0;
+}
+
+static const char* add_row(const char* input) {
+    size_t len = strlen(input);
+    if (g_data_len + len + 1 > UINT32_MAX / 2) return "record too long for a column batch";
+    if (grow((void**)&g_data, &g_data_cap, g_data_len + len + 1, 1)) return "alloc failed";
+    if (grow((void**)&g_row_off, &g_row_off_cap, g_rows + 1, sizeof(uint32_t))) return "alloc failed";
+    if (grow((void**)&g_row_field, &g_row_field_cap, g_rows + 2, sizeof(uint32_t))) return "alloc failed";
+    size_t base = g_data_len;
+    memcpy(g_data + base, input, len + 1);
+    g_data_len += len + 1;
+    g_row_off[g_rows] = (uint32_t)base;
+    g_row_field[g_rows] = (uint32_t)g_fields_len;
+    int rc = g_sep ? split_sep(base, len) : split_blank(base, g_data + base, len);
+    if (rc) { // the rows held so far stay
+        g_data_len = base;
+        g_fields_len = g_row_field[g_rows];
+        return "alloc failed";
+    }
+    uint32_t n = (uint32_t)(g_fields_len - g_row_field[g_rows]);
+    if (n > g_cols) g_cols = n;
+    g_rows++;
+    g_row_field[g_rows] = (uint32_t)g_fields_len;
+    return NULL;
+}
+
+// Lay the gathered rows out as one block, fields column by column
+static const char* flush(plugin_emitter_t* out) {
+    if (g_rows == 0) return NULL;
+    size_t size = cp_columns_size(g_rows, g_cols, g_data_len);
+    if (size > UINT32_MAX) {
+        reset_batch();
+        return "column batch too large";
+    }
+    cp_columns_t* b = (cp_columns_t*)malloc(size);
+    if (!b) {
+        reset_batch();
+        return "alloc failed";
+    }
+    b->bytes = (uint32_t)size;
+    b->rows = g_rows;
+    b->cols = g_cols;
+    b->data = (uint32_t)(size - g_data_len);
+    uint32_t* row_off = (uint32_t*)(b + 1);
+    memcpy(row_off, g_row_off, (size_t)g_rows * sizeof(uint32_t));
+    row_off[g_rows] = (uint32_t)g_data_len;
+    for (uint32_t c = 0; c < g_cols; ++c) {
+        uint32_t* off = (uint32_t*)cp_columns_offsets(b, c);
+        uint32_t* len = (uint32_t*)cp_columns_lengths(b, c);
+        for (uint32_t r = 0; r < g_rows; ++r) {
+            uint32_t f = g_row_field[r] + c;
+            if (f < g_row_field[r + 1]) {
+                off[r] = g_fields[f].off;
+                len[r] = g_fields[f].len;
+            } else {
+                off[r] = 0;
+                len[r] = CP_COLUMNS_ABSENT;
+            }
+        }
+    }
+    memcpy((char*)b + b->data, g_data, g_data_len);
+    reset_batch();
+    return common_plugin_emit_columns(out, b);
+}
+
+const char* plugin_tokenize(const char* input, plugin_emitter_t* out) {
+    if (!input) return flush(out); // <END>: what is held goes first
+    const char* err = add_row(input);
+    if (err) return err;
+    if (g_rows >= g_batch_rows || g_data_len >= TOK_BATCH_BYTES || common_plugin_backlog() == 0)
+        return flush(out);
+    return NULL;
+}
+
+const char* plugin_init(int queue_size) {
+    const char* sep   = common_plugin_option("sep");
+    const char* batch = common_plugin_option("batch");
+    g_sep = 0;
+    if (sep) {
+        if (strlen(sep) != 1 || sep[0] == '"') return "invalid sep (one byte, not a quote)";
+        g_sep = sep[0];
+    }
+    g_batch_rows = TOK_BATCH_DEFAULT;
+    if (batch) {
+        char* endp = NULL;
+        unsigned long n = strtoul(batch, &endp, 10);
+        if (endp == batch || *endp || n == 0 || n > TOK_BATCH_MAX) return "invalid batch (1..65536)";
+        g_batch_rows = (uint32_t)n;
+    }
+    reset_batch();
+    return common_plugin_init_emit(plugin_tokenize, "tokenizer", queue_size, 0);
+}
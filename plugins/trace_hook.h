@@ -0,0 +1,28 @@
+#ifndef TRACE_HOOK_H
+#define TRACE_HOOK_H
+
+#include <stdint.h>
+
+/**
+* Tracing callbacks provided by the host (see trace.c) and handed to plugins
+* through the optional plugin_set_tracer entry point. The host owns all state,
+* so every stage records into the same trace. Trace id 0 means "not sampled":
+* plugins skip all timing work for such items.
+*/
+typedef struct
+{
+    uint64_t (*now_ns)(void);                  /* monotonic clock, nanoseconds */
+    uint64_t (*current)(void);                 /* trace id of the item this thread is handing off */
+    void     (*set_current)(uint64_t trace_id);
+    void     (*name_thread)(const char* name); /* label the calling thread's track */
+
+    /* a span on the calling thread's track */
+    void (*span)(const char* stage, const char* what, uint64_t trace_id,
+                 uint64_t start_ns, uint64_t end_ns);
+
+    /* a span not tied to a thread, e.g. time spent queued */
+    void (*async_span)(const char* stage, const char* what, uint64_t trace_id,
+                       uint64_t start_ns, uint64_t end_ns);
+} trace_hook_t;
+
+#endif // TRACE_HOOK_H
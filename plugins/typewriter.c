@@ -11,6 +11,8 @@ const char* plugin_transform(const char* input) {
     if (!input || is_end_token(input)) return input;
 
     const char* prefix = "[typewriter] ";
+    char frame[4];
+    fwrite(frame, 1, common_plugin_frame_head(strlen(prefix) + strlen(input), frame), stdout);
 
     for (const char* p = prefix; *p; ++p) {
         fputc(*p, stdout);
@@ -22,7 +24,7 @@ const char* plugin_transform(const char* input) {
         fflush(stdout);
         usleep(100000); // 100ms 
     }
-    fputc('\n', stdout);
+    fwrite(frame, 1, common_plugin_frame_tail(frame), stdout);
     fflush(stdout);
 
     return input; 
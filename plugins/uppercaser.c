@@ -32,5 +32,6 @@ const char* plugin_transform(const char* input) {
 }
 
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(plugin_transform, "uppercaser", queue_size);
+    return common_plugin_init_ex(plugin_transform, "uppercaser", queue_size,
+                                 PLUGIN_FLAG_PURE | PLUGIN_FLAG_CHUNKS | PLUGIN_FLAG_REENTRANT);
 }
@@ -0,0 +1,41 @@
+#include "zstd_shim.h"
+
+#include <dlfcn.h>
+#include <pthread.h>
+
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static zstd_api_t g_api;
+static const char* g_err; // why loading failed, NULL once g_api is usable
+
+static void load(void) {
+    void* lib = dlopen("libzstd.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (!lib) {
+        g_err = "zstd needs libzstd.so.1, which was not found";
+        return;
+    }
+    zstd_api_t* a = &g_api;
+    *(void**)&a->create_cs  = dlsym(lib, "ZSTD_createCStream");
+    *(void**)&a->init_cs    = dlsym(lib, "ZSTD_initCStream");
+    *(void**)&a->compress   = dlsym(lib, "ZSTD_compressStream");
+    *(void**)&a->end        = dlsym(lib, "ZSTD_endStream");
+    *(void**)&a->free_cs    = dlsym(lib, "ZSTD_freeCStream");
+    *(void**)&a->create_ds  = dlsym(lib, "ZSTD_createDStream");
+    *(void**)&a->init_ds    = dlsym(lib, "ZSTD_initDStream");
+    *(void**)&a->decompress = dlsym(lib, "ZSTD_decompressStream");
+    *(void**)&a->is_error   = dlsym(lib, "ZSTD_isError");
+    *(void**)&a->error_name = dlsym(lib, "ZSTD_getErrorName");
+    if (!a->create_cs || !a->init_cs || !a->compress || !a->end || !a->free_cs ||
+        !a->create_ds || !a->init_ds || !a->decompress || !a->is_error || !a->error_name) {
+        dlclose(lib);
+        g_err = "libzstd.so.1 lacks the streaming API";
+    }
+}
+
+const zstd_api_t* zstd_shim_load(const char** err) {
+    pthread_once(&g_once, load);
+    if (g_err) {
+        *err = g_err;
+        return NULL;
+    }
+    return &g_api;
+}
@@ -0,0 +1,35 @@
+#ifndef ZSTD_SHIM_H
+#define ZSTD_SHIM_H
+
+#include <stddef.h>
+
+/**
+* The part of the libzstd streaming API used by filesink (compression) and
+* the input decompressor, resolved with dlsym from libzstd.so.1 so that
+* building does not need the zstd headers.
+*/
+
+typedef struct { const void* src; size_t size; size_t pos; } zstd_in_t;
+typedef struct { void* dst; size_t size; size_t pos; } zstd_out_t;
+
+typedef struct {
+    void*       (*create_cs)(void);
+    size_t      (*init_cs)(void* cs, int level);
+    size_t      (*compress)(void* cs, zstd_out_t* out, zstd_in_t* in);
+    size_t      (*end)(void* cs, zstd_out_t* out);
+    size_t      (*free_cs)(void* cs);
+    void*       (*create_ds)(void);
+    size_t      (*init_ds)(void* ds);
+    size_t      (*decompress)(void* ds, zstd_out_t* out, zstd_in_t* in);
+    unsigned    (*is_error)(size_t code);
+    const char* (*error_name)(size_t code);
+} zstd_api_t;
+
+/**
+* Load libzstd.so.1 on first use (thread-safe), later calls return the same table
+* @param err Set to a static message on failure
+* @return The API table, NULL if the library is missing or too old
+*/
+const zstd_api_t* zstd_shim_load(const char** err);
+
+#endif // ZSTD_SHIM_H
@@ -0,0 +1,141 @@
+#include "signals.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define KICK_INTERVAL_MS 50
+
+static int g_pipe[2] = { -1, -1 };     // self-pipe: handlers and requests -> watcher
+static volatile sig_atomic_t g_interrupts;
+static _Atomic int g_level;             // SIGNALS_*
+static _Atomic int g_acked;             // the input thread has seen g_level
+static pthread_t g_input_thread;
+static pipeline_t* g_pl;
+
+// Small strdup to avoid non-portable prototypes
+static char* dup_cstr(const char* s) {
+    if (!s) return NULL;
+    size_t n = strlen(s);
+    char* p = (char*)malloc(n + 1);
+    if (!p) return NULL;
+    memcpy(p, s, n + 1);
+    return p;
+}
+
+static void fill_set(sigset_t* set) {
+    sigemptyset(set);
+    sigaddset(set, SIGINT);
+    sigaddset(set, SIGTERM);
+    sigaddset(set, SIGUSR1);
+    sigaddset(set, SIGUSR2);
+}
+
+// Async-signal-safe: only write() to the pipe
+static void on_signal(int signo) {
+    int saved = errno;
+    char cmd = 0;
+    if (signo == SIGUSR1) cmd = 's';
+    else if (signo == SIGTERM) cmd = 'd';
+    else if (signo == SIGINT) cmd = (g_interrupts++ == 0) ? 'd' : 'x';
+    // SIGUSR2 only interrupts a blocking read in the input thread
+    if (cmd) (void)!write(g_pipe[1], &cmd, 1);
+    errno = saved;
+}
+
+static void raise_level(int level) {
+    int cur = atomic_load(&g_level);
+    while (cur < level && !atomic_compare_exchange_weak(&g_level, &cur, level)) { }
+}
+
+static void* watcher_thread(void* arg) {
+    (void)arg;
+    for (;;) {
+        // until the input thread notices a shutdown request, keep kicking it
+        // out of blocking reads: a single signal may land just before it
+        // enters read() and be lost
+        int kick = atomic_load(&g_level) != SIGNALS_RUN && !atomic_load(&g_acked);
+        struct pollfd pfd = { .fd = g_pipe[0], .events = POLLIN, .revents = 0 };
+        int n = poll(&pfd, 1, kick ? KICK_INTERVAL_MS : -1);
+        if (n < 0 && errno != EINTR) break;
+        if (n <= 0) {
+            if (kick) pthread_kill(g_input_thread, SIGUSR2);
+            continue;
+        }
+
+        char cmd;
+        if (read(g_pipe[0], &cmd, 1) != 1) continue;
+        switch (cmd) {
+        case 's': pipeline_post_control(g_pl, CP_CTL_STATS); break;
+        case 'f': pipeline_post_control(g_pl, CP_CTL_FLUSH); break;
+        case 'd': raise_level(SIGNALS_DRAIN); break;
+        case 'x':
+            raise_level(SIGNALS_STOP);
+            pipeline_post_control(g_pl, CP_CTL_STOP);
+            break;
+        default: break;
+        }
+        if (cmd == 'd' || cmd == 'x') pthread_kill(g_input_thread, SIGUSR2);
+    }
+    return NULL;
+}
+
+void signals_block(void) {
+    sigset_t set;
+    fill_set(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+}
+
+int signals_start(pipeline_t* pl, char** failed_msg) {
+    *failed_msg = NULL;
+    if (pipe(g_pipe) != 0) {
+        *failed_msg = dup_cstr(strerror(errno));
+        return -1;
+    }
+    for (int i = 0; i < 2; ++i) fcntl(g_pipe[i], F_SETFD, FD_CLOEXEC);
+    fcntl(g_pipe[1], F_SETFL, O_NONBLOCK); // a flood of signals must never block a handler
+
+    g_pl = pl;
+    g_input_thread = pthread_self();
+
+    // no SA_RESTART: a blocking read of stdin returns EINTR
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    int signos[] = { SIGINT, SIGTERM, SIGUSR1, SIGUSR2 };
+    for (size_t i = 0; i < sizeof(signos) / sizeof(signos[0]); ++i) {
+        if (sigaction(signos[i], &sa, NULL) != 0) {
+            *failed_msg = dup_cstr(strerror(errno));
+            return -1;
+        }
+    }
+
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, watcher_thread, NULL) != 0) {
+        *failed_msg = dup_cstr("pthread_create failed");
+        return -1;
+    }
+    pthread_detach(tid);
+
+    sigset_t set;
+    fill_set(&set);
+    pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+    return 0;
+}
+
+void signals_request(char cmd) {
+    if (g_pipe[1] >= 0) (void)!write(g_pipe[1], &cmd, 1);
+}
+
+int signals_stop_requested(void) {
+    int level = atomic_load(&g_level);
+    if (level != SIGNALS_RUN) atomic_store(&g_acked, 1);
+    return level;
+}
@@ -0,0 +1,33 @@
+#ifndef SIGNALS_H
+#define SIGNALS_H
+
+#include "plugin_runtime.h"
+
+// Shutdown levels reported by signals_stop_requested
+#define SIGNALS_RUN   0
+#define SIGNALS_DRAIN 1 // stop reading input, let queued items finish
+#define SIGNALS_STOP  2 // discard queued items, end every stage now
+
+// Block SIGINT, SIGTERM, SIGUSR1 and SIGUSR2 in the calling thread. Call in
+// main before any thread exists so that every thread inherits the mask and
+// only the input thread ever runs the handlers.
+void signals_block(void);
+
+// Start the watcher thread for pl and unblock the signals in the calling
+// (input) thread:
+//   SIGUSR1           per-stage stats snapshot on stderr
+//   SIGTERM, SIGINT   drain: stop reading input, finish what is queued
+//   second SIGINT     immediate stop: queued items are discarded
+// On success: return 0
+// On failure: return -1 and set *failed_msg to a heap-allocated error string (caller frees)
+int signals_start(pipeline_t* pl, char** failed_msg);
+
+// Ask for an action as if a signal had arrived, from any thread:
+// 's' stats, 'f' flush, 'd' drain, 'x' immediate stop
+void signals_request(char cmd);
+
+// Polled by the input loop; returns SIGNALS_RUN, SIGNALS_DRAIN or SIGNALS_STOP.
+// A non-zero answer also stops the watcher from interrupting the input thread.
+int signals_stop_requested(void);
+
+#endif // SIGNALS_H
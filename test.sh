@@ -110,11 +110,296 @@ main() {
   [[ "$(grep -c '^\[logger\]' <<<"$OUT" || true)" -eq 30 ]] || red "sink count != 30"
   last_is "Pipeline shutdown complete"; e_empty; green "stress q=2"
 
-  # ---- no <END>: should wait (use timeout if present) ----
+  # ---- stage options / overflow policies ----
+  run "bad option" "" "$A 8 logger:nosuch=1";    rc 2; hase "unknown option 'nosuch'";           green "bad option"
+  run "bad policy" "" "$A 8 logger:overflow=x";  rc 2; hase "invalid overflow policy";           green "bad policy"
+  run "bad opt fmt" "" "$A 8 logger:overflow";   rc 2; hase "malformed option";                  green "bad opt fmt"
+  run "bad flag" "" "$A --nosuch 8 logger";      rc 1; haso "Usage:"; hase "unknown option";     green "bad flag"
+  run "bad budget" "" "$A 8 logger:budget=0";    rc 2; hase "invalid byte budget";               green "bad budget"
+
+  # typewriter holds 'a' for ~1.4s: 'b' waits in the queue, 'c' and 'd' evict it in turn
+  run "drop-oldest" "" "( echo a; sleep 0.2; printf 'b\\nc\\nd\\n<END>\\n' ) | $A --stats 1 typewriter:overflow=drop-oldest"
+  rc 0; haso "[typewriter] a"; haso "[typewriter] d"; ! grep -Fq "[typewriter] b" <<<"$OUT" || red "b not shed"
+  hase "dropped_oldest=2"; last_is "Pipeline shutdown complete"; green "drop-oldest"
+
+  run "stats block" $'x\ny\n<END>\n' "$A --stats 1 uppercaser logger:budget=4K"
+  rc 0; haso "[logger] Y"; hase "[INFO][logger] - queue: puts=3 gets=3 dropped_newest=0"
+  [[ "$(grep -o '^\[INFO\]\[[a-z]*\] - queue:' <<<"$ERR" | tr -d '\n')" == "[INFO][uppercaser] - queue:[INFO][logger] - queue:" ]] \
+    || red "stats block: stages out of pipeline order"; green "stats block"
+
+  # ---- byte-bounded queues ----
+  run "queue-bytes" "$many" "$A --stats --queue-bytes=16 0 flipper logger"
+  rc 0; [[ "$(grep -c '^\[logger\]' <<<"$OUT" || true)" -eq 30 ]] || red "sink count != 30"
+  hase "peak_bytes=1"; green "queue-bytes"
+  run "memory budget" "" "$A --stats --generate=count=3000,len=8-40 --memory-budget=256 0 uppercaser flipper nullsink"
+  rc 0; haso "[nullsink] items=3000 "; hase "memory budget: limit=256 used=0"; green "memory budget"
+  run "q0 w/o budget" "" "$A 0 logger";  rc 1; hase "invalid queue size '0'"; green "q0 w/o budget"
+
+  # ---- grep filter: dropped lines never reach the next stage ----
+  run "grep" $'foo bar\nbaz\nabc123\nxabcx\n<END>\n' "$A --stats 8 'grep:pattern=a(b|x)c|^ba' logger"
+  rc 0; haso "[logger] baz"; haso "[logger] abc123"; haso "[logger] xabcx"
+  ! grep -Fq "foo bar" <<<"$OUT" || red "grep: non-matching line passed"
+  hase "[INFO][grep] - filter: dropped=1"; hase "[INFO][logger] - queue: puts=4"; green "grep"
+  run "grep classes" $'abc123\nABC\nxyz\n<END>\n' "$A 8 'grep:pattern=\d$|Y,invert=1,icase=1' logger"
+  rc 0; haso "[logger] ABC"; ! grep -Fq "abc123" <<<"$OUT" || red "grep: invert failed"
+  ! grep -Fq "xyz" <<<"$OUT" || red "grep: icase failed"; green "grep classes"
+  run "bad grep" "" "$A 8 'grep:pattern=(a' logger"; rc 2; hase "invalid pattern: missing )"; green "bad grep"
+
+  # ---- one-to-many: every piece is its own record, in order ----
+  run "splitter" $'a b  c\nx;y;;z\n<END>\n' "$A --stats 1 splitter uppercaser logger"
+  rc 0; [[ "$(grep -c '^\[logger\]' <<<"$OUT" || true)" -eq 4 ]] || red "splitter: want 4 records"
+  [[ "$OUT" == $'[logger] A\n[logger] B\n[logger] C\n[logger] X;Y;;Z\n'* ]] || red "splitter: wrong records"; hase "[INFO][logger] - queue: puts=5"; green "splitter"
+  run "splitter sep" $'x;y;;z\n<END>\n' "$A 8 'splitter:sep=;,keep_empty=1' logger"
+  rc 0; [[ "$OUT" == $'[logger] x\n[logger] y\n[logger] \n[logger] z\n'* ]] || red "splitter: wrong pieces"; green "splitter sep"
+  run "splitter end piece" $'a <END> b\nc d\n<END>\n' "$A 8 splitter logger"
+  rc 0; [[ "$OUT" == $'[logger] a\n[logger] <END>\n[logger] b\n[logger] c\n[logger] d\n'* ]] || red "splitter: an emitted <END> ended the stream"; [[ "$(tail -n1 <<<"$OUT")" == "Pipeline shutdown complete" ]] || red "splitter end piece: no shutdown"; green "splitter end piece"
+
+  # ---- column batches: cut reads fields from them, other stages get the records ----
+  run "columns" $'a b  c\n  x\ty z w\nsolo\n<END>\n' "$A 8 tokenizer 'cut:fields=3\\,2' logger"
+  rc 0; [[ "$OUT" == $'[logger] c b\n[logger] z y\n[logger] \n'* ]] || red "columns: wrong fields"; green "columns"
+  run "columns csv" $'"q,1",2,"he said ""hi""",\n<END>\n' "$A 8 'tokenizer:sep=\\,' 'cut:fields=3\\,1\\,4,sep=|' logger"
+  rc 0; haso '[logger] he said "hi"|q,1|'; green "columns csv"
+  # repeated fields, rows of different shape in one batch: each row's slot must fit its own output
+  c24="cccccccccccccccccccccccc"; rows=""; dups=""
+  for i in $(seq 20); do rows+="$c24 d"$'\nab x\nz\n'; dups+="[logger] $c24--$c24--$c24--d"$'\n[logger] ab--ab--ab--x\n[logger] z--z--z\n'; done
+  for pre in tokenizer ""; do
+    run "cut repeated $pre" "$rows<END>" "$A 64 $pre 'cut:fields=1\\,1\\,1\\,2,sep=--' logger"
+    rc 0; [[ "$OUT" == "$dups"* ]] || red "cut: repeated fields wrong after '$pre'"; green "cut repeated fields ${pre:-text}"
+  done
+  want="$($A --generate=count=3000,len=1-60 8 logger)"
+  run "columns passthrough" "" "$A --generate=count=3000,len=1-60 8 tokenizer:batch=7 logger"
+  rc 0; [[ "$OUT" == "$want" ]] || red "columns: records changed"; green "columns passthrough"
+  sdir="$(mktemp -d)"
+  run "columns spill" "" "$A --generate=count=3000 1 tokenizer:batch=5 cut:fields=1,spill=$sdir nullsink"
+  rc 0; haso "[nullsink] items=3000 "; rm -rf "$sdir"; green "columns spill"
+  run "bad cut" "" "$A 8 tokenizer cut:fields=0 logger"; rc 2; hase "invalid fields"; green "bad cut"
+
+  # ---- JSON projection: nested paths, escapes, predicate, invalid lines dropped ----
+  j=$'{"id": 1, "user": {"name": "a\\"b", "tags": ["x"]}, "status": 200}\n{"status":500,"id":2,"user":{"name":"c"}}\n{"id":3}\nnot json\n<END>\n'
+  run "jsonpick" "$j" "$A 8 'jsonpick:fields=id\\,user.name' logger"
+  rc 0; [[ "$OUT" == $'[logger] {"id":1,"user.name":"a\\"b"}\n[logger] {"id":2,"user.name":"c"}\n[logger] {"id":3,"user.name":null}\n'* ]] || red "jsonpick: wrong records"
+  hase "[jsonpick] not JSON objects: 1"; green "jsonpick"
+  run "jsonpick where" "$j" "$A 8 'jsonpick:fields=user\\,id,where=status>300,format=tsv' logger"
+  rc 0; [[ "$OUT" == $'[logger] {"name":"c"}\t2\n'* ]] || red "jsonpick: wrong filter"; green "jsonpick where"
+  run "bad jsonpick" "" "$A 8 'jsonpick:fields=a,where=a<x' logger"; rc 2; hase "need a number"; green "bad jsonpick"
+
+  # ---- aggregation: exact counts for few keys, sketches beyond exact=N ----
+  run "aggregate" $'GET /a\nPOST /b\nGET /c\nx\n<END>\n' "$A 8 aggregate:field=2,sep=/ logger"
+  rc 0; haso '[logger] {"items":4,"missing":1,"distinct":3,"exact":true,"top":[["a",1],["b",1],["c",1]]}'
+  [[ "$(grep -c '^\[logger\]' <<<"$OUT" || true)" -eq 1 ]] || red "aggregate: want one summary"; green "aggregate"
+  run "aggregate sketch" "" "$A --generate=count=5000,repeat=0.5,pool=3 8 aggregate:exact=8,topk=3,every=2500 logger"
+  rc 0; [[ "$(grep -c '"exact":false' <<<"$OUT" || true)" -eq 2 ]] || red "aggregate: want 2 sketch summaries"
+  haso '[logger] {"items":5000,'; green "aggregate sketch"
+
+  # ---- compressed input and output: detected from the magic bytes, text may follow ----
+  run "gzip input" "" "{ printf 'one\\ntwo\\n' | gzip -c; printf 'three\\n<END>\\n'; } | $A --stats 8 uppercaser logger"
+  rc 0; [[ "$OUT" == $'[logger] ONE\n[logger] TWO\n[logger] THREE\n'* ]] || red "gzip input: wrong records"
+  hase "input: gzip compressed="; green "gzip input"
+  if command -v zstd >/dev/null 2>&1; then
+    run "zstd input" "" "{ printf 'a\\n' | zstd -qc; printf 'b\\n' | gzip -c; printf '<END>\\n'; } | $A 8 logger"
+    rc 0; [[ "$OUT" == $'[logger] a\n[logger] b\n'* ]] || red "zstd input: wrong records"; green "zstd input"
+  fi
+  gz="$(mktemp)"
+  run "filesink" "$many" "$A 8 flipper filesink:path=$gz"
+  rc 0; last_is "Pipeline shutdown complete"; e_empty
+  [[ "$(gzip -dc "$gz" | sed -n '1p;30p' | tr '\n' ' ')" == "1m 03m " ]] || red "filesink: wrong file contents"
+  run "filesink read back" "" "{ cat $gz; echo '<END>'; } | $A 8 flipper nullsink"
+  rm -f "$gz"
+  rc 0; haso "[nullsink] items=30 "; green "filesink"
+  run "bad filesink" "" "$A 8 filesink:path=/nonexistent/x.gz"; rc 2; hase "cannot open"; green "bad filesink"
+
+  # ---- disk spill: same lines in the same order as a blocking run ----
+  sdir="$(mktemp -d)"; want="$($A --generate=count=20000 1 logger)"
+  run "spill" "" "$A --stats --generate=count=20000 1 logger:spill=$sdir"
+  rc 0; [[ "$OUT" == "$want" ]] || red "spill: output differs from blocking run"
+  hase "[INFO][logger] - spill: spilled="; ! grep -Fq "spilled=0 " <<<"$ERR" || red "spill: nothing spilled"
+  [[ -z "$(ls -A "$sdir")" ]] || red "spill: files left behind"; rmdir "$sdir"; green "spill"
+  run "bad spill" "" "$A 1 logger:spill=/nonexistent/dir"; rc 2; hase "spill: cannot create files"; green "bad spill"
+
+  # ---- synthetic source and counting sinks ----
+  run "generate→nullsink" "" "$A --generate=count=5000,len=8-64,repeat=0.5 16 uppercaser nullsink"
+  rc 0; haso "[nullsink] items=5000 "; last_is "Pipeline shutdown complete"; e_empty; green "generate→nullsink"
+  run "countsink" "" "$A --generate=count=200,rate=2000,len=10 8 countsink:interval=0.02"
+  rc 0; haso "rate="; haso "[countsink] total items=200 bytes=2000"; e_empty; green "countsink"
+  run "bad generate" "" "$A --generate=len=9-3 8 nullsink"; rc 1; hase "invalid value for generator option 'len'"; green "bad generate"
+
+  # ---- chain compiler: fused runs must match the stage-by-stage chain ----
+  mix=$'\na\nab\nabc\nHello World\n<END\nx <y> z\n'"$(head -c 300 </dev/zero | tr '\0' 'q')"$'\n<END>\n'
+  for chain in "flipper expander rotator uppercaser" "rotator expander uppercaser flipper" "expander uppercaser"; do
+    run "fused $chain" "$mix" "$A --fuse --stats 8 $chain logger"; fused_out="$OUT"
+    hase "[INFO][${chain// /+}]"
+    run "unfused $chain" "$mix" "$A --stats 8 $chain logger"
+    ! grep -Fq "[INFO][${chain// /+}]" <<<"$ERR" || red "fused without --fuse: $chain"
+    [[ "$fused_out" == "$OUT" ]] || red "fused output differs for: $chain"
+    green "fuse $chain"
+  done
+
+  # ---- inline engine: every stage on the input thread, same output ----
+  for chain in "uppercaser rotator logger" "splitter flipper grep:pattern=[a-z] logger" "expander uppercaser:cache=8 logger"; do
+    run "threads $chain" "$mix" "$A --no-fuse 8 $chain"; threads_out="$OUT"
+    run "inline $chain" "$mix" "$A --no-fuse --engine=inline 8 $chain"
+    rc 0; e_empty; [[ "$threads_out" == "$OUT" ]] || red "inline output differs for: $chain"
+    green "inline $chain"
+  done
+  run "bad engine" "" "$A --engine=fibers 8 logger";                    rc 1; hase "invalid engine";         green "bad engine"
+  run "inline control" "" "$A --engine=inline --control=/tmp/x 8 logger"; rc 1; hase "needs --engine=threads"; green "inline control"
+  run "inline overflow" "" "$A --engine=inline 8 logger:overflow=drop-newest"; rc 2; hase "threaded engine"; green "inline overflow"
+
+  # ---- latency mode: direct handoff while stages are idle, same output ----
+  for chain in "uppercaser rotator logger" "splitter flipper grep:pattern=[a-z] logger"; do
+    run "queued $chain" "$mix" "$A --no-fuse 8 $chain"; queued_out="$OUT"
+    run "latency $chain" "$mix" "$A --no-fuse --latency 8 $chain"
+    rc 0; e_empty; [[ "$queued_out" == "$OUT" ]] || red "latency output differs for: $chain"
+    green "latency $chain"
+  done
+  run "latency direct" "" "( echo one; sleep 0.2; echo two; sleep 0.2; echo '<END>' ) | $A --no-fuse --latency --stats 8 uppercaser logger"
+  rc 0; haso "[logger] TWO"; hase "[INFO][logger] - latency: direct=3 queued=0"; green "latency direct"
+  run "latency inline" "" "$A --engine=inline --latency 8 logger"; rc 1; hase "latency needs --engine=threads"; green "latency inline"
+
+  # ---- autoscale: replicas of the bottleneck stage keep the output order ----
+  # (long lines: busy time counts only the transforms, which must outweigh the handoffs)
+  gen="--generate=count=2000,len=10000-30000,seed=9"
+  run "one thread" "" "{ $A --no-fuse $gen 16 uppercaser expander rotator logger | cksum; }"; single_out="$OUT"
+  run "autoscale" "" "{ $A --no-fuse --stats --autoscale=cores=2,interval=10 $gen 16 uppercaser expander rotator logger | cksum; }"
+  rc 0; [[ "$single_out" == "$OUT" ]] || red "autoscale output differs"
+  hase "1 -> 2 threads (bottleneck"; hase "threads: now="; green "autoscale"
+  run "autoscale spec" "" "$A --autoscale=cores=x 8 logger";       rc 1; hase "invalid value for autoscale option 'cores'"; green "autoscale spec"
+  run "autoscale latency" "" "$A --latency --autoscale 8 logger";  rc 1; hase "cannot be combined";                           green "autoscale latency"
+
+  # ---- framing: NUL-terminated and length-prefixed records may hold newlines ----
+  run "nul framing" "" "printf 'a\nb\0c\0<END>\0' | $A --framing=nul 8 uppercaser logger | tr '\0' '|'"
+  rc 0; [[ "$OUT" == $'[logger] A\nB|[logger] C|' ]] || red "nul framing: got '$OUT'"; green "nul framing"
+  run "len32 framing" "" "printf '\0\0\0\013hello\nworld\0\0\0\005<END>' | $A --framing=len32 8 flipper logger | od -An -c | tr -s ' \n' ' '"
+  rc 0; haso '\0 \0 \0 024 [ l o g g e r ] d l r o w \n o l l e h'; green "len32 framing"
+  run "len32 NUL" "" "printf '\0\0\0\003a\0b\0\0\0\002ok\0\0\0\005<END>' | $A --framing=len32 8 nullsink"
+  rc 0; o_empty; hase "[nullsink] items=1 "; hase "record contains a NUL byte"; green "len32 NUL"
+  run "len32 oversized" "" "{ printf '\\5\\0\\0\\0'; head -c 83886080 /dev/zero; printf '\\0\\0\\0\\002ok\\0\\0\\0\\005<END>'; } | $A --framing=len32 8 nullsink"
+  rc 0; o_empty; hase "[nullsink] items=1 "; hase "record of 83886080 bytes is over the 67108864 byte limit"; green "len32 oversized"
+  run "nul oversized" "" "{ head -c 67108870 </dev/zero | tr '\\0' a; printf '\\0ok\\0<END>\\0'; } | $A --framing=nul 8 nullsink"
+  rc 0; hase "record of 67108870 bytes is over the 67108864 byte limit"; hase "[nullsink] items=1 bytes=2"; green "nul oversized"
+  run "bad framing" "" "$A --framing=crlf 8 logger"; rc 1; hase "invalid framing 'crlf'"; green "bad framing"
+
+  # ---- chunked records: fragments must give the same output as whole lines ----
+  long="$(head -c 100 </dev/zero | tr '\0' 'a')"
+  recs=$'short\n'"$long"$'\n<END>'"$long"$'\nx\n<END>\n'
+  for chain in "uppercaser expander logger" "flipper logger" "expander rotator nullsink"; do
+    run "whole $chain" "$recs" "$A --no-fuse 4 $chain"; whole_out="$OUT"
+    run "chunked $chain" "$recs" "$A --no-fuse --chunk=16 4 $chain"
+    rc 0; [[ "$whole_out" == "$OUT" ]] || red "chunked output differs for: $chain"
+    green "chunk $chain"
+  done
+  # shedding drops whole records: no survivor may be a fragment or two records glued together
+  lines="$(for i in $(seq 300); do head -c 200 </dev/zero | tr '\0' a; echo; done)"
+  for policy in drop-newest drop-oldest "sample,sample=3"; do
+    run "chunk shed $policy" "$lines"$'\n<END>\n' "$A --no-fuse --chunk=16 2 uppercaser 'rotator:overflow=$policy' logger"
+    rc 0; bad="$(grep '^\[logger\]' <<<"$OUT" | awk 'length($0) != 209' | head -n1)"
+    [[ -z "$bad" ]] || red "chunk shed $policy: corrupted record of ${#bad} bytes"; green "chunk shed $policy"
+  done
+  run "bad chunk" "" "$A --chunk=4 8 logger"; rc 1; hase "invalid chunk size"; green "bad chunk"
+
+  # ---- result cache for pure stages ----
+  reps="$( (for i in 1 2 3 4 5 6; do echo ping; echo pong; done); echo '<END>' )"
+  run "cache" "$reps" "$A --stats 4 uppercaser:cache=16 rotator logger"
+  rc 0; [[ "$(grep -c '^\[logger\] GPIN$' <<<"$OUT" || true)" -eq 6 ]] || red "cached output mismatch"
+  hase "cache: hits=10 misses=2"; green "cache"
+  run "cache impure" "" "$A 4 logger:cache=16";  rc 2; hase "cache requires a pure plugin";      green "cache impure"
+
+  # ---- per-item tracing ----
+  tr="$(mktemp)"
+  run "trace" $'a\nb\nc\nd\n<END>\n' "$A --no-fuse --trace=$tr,sample=2 4 uppercaser flipper logger"
+  rc 0; haso "[logger] D"; hase "trace: 22 spans for 2 items"
+  if command -v python3 >/dev/null 2>&1; then
+    python3 -c 'import json,sys; json.load(open(sys.argv[1]))' "$tr" || red "trace is not valid JSON"
+  fi
+  grep -Fq '"name":"flipper transform"' "$tr" || red "trace lacks flipper spans"
+  rm -f "$tr"; green "trace"
+  run "bad trace" "" "$A --trace=x,every=2 8 logger"; rc 1; hase "invalid --trace option"; green "bad trace"
+
+  # ---- live rewiring through the control FIFO ----
+  ctl="$(mktemp -u)"
+  run "live rewire" "" "( echo one; sleep 0.3; echo 'insert 1 flipper' >$ctl; sleep 0.3; echo two;
+                          echo 'swap uppercaser' >$ctl; sleep 0.3; echo three;
+                          echo 'remove flipper' >$ctl; sleep 0.3; echo four; echo '<END>' ) | $A --control=$ctl 4 uppercaser logger"
+  [ ! -e "$ctl" ] || { rm -f "$ctl"; red "live rewire: FIFO left behind"; }
+  rc 0; haso "[logger] ONE"; haso "[logger] OWT"; haso "[logger] EERHT"; haso "[logger] FOUR"
+  hase "control: insert done"; hase "control: swap done"; hase "control: remove done"
+  last_is "Pipeline shutdown complete"; green "live rewire"
+
+  # ---- control lane: signals and immediate stop ----
+  run "sigterm drain" "" "{ $A 4 uppercaser logger < <(echo hi; sleep 2) & p=\$!;
+                          sleep 0.4; kill -USR1 \$p; sleep 0.2; kill -TERM \$p; wait \$p; }"
+  rc 0; haso "[logger] HI"; hase "[INFO][logger] - queue: puts=1"
+  last_is "Pipeline shutdown complete"; green "sigterm drain"
+  ctl="$(mktemp -u)"
+  run "stop lane" "" "{ timeout 10s $A --stats --control=$ctl 500 typewriter logger < <(seq 1 200; sleep 3) & p=\$!;
+                      sleep 0.4; echo stop >$ctl; wait \$p; }"
+  rm -f "$ctl"
+  rc 0; hase "control: stop requested"; hase "[INFO][typewriter] - queue: puts=200"; hase "discarded="
+  last_is "Pipeline shutdown complete"; green "stop lane"
+
+  # ---- daemon: streams run in forks of one preloaded process ----
+  sock="$(mktemp -u)"
+  $A --daemon=$sock uppercaser logger 2>/dev/null & dpid=$!
+  for _ in 1 2 3 4 5 6 7 8 9 10; do [[ -S $sock ]] && break; sleep 0.1; done
+  [[ "$(stat -c %a "$sock")" == 600 ]] || red "daemon socket is not owner-only"
+  run "daemon stream" $'hello\n<END>\n' "$A --connect=$sock 8 uppercaser rotator logger"
+  rc 0; haso "[logger] OHELL"; last_is "Pipeline shutdown complete"; e_empty; green "daemon stream"
+  run "daemon rc" "" "$A --connect=$sock 0 logger";  rc 1; haso "Usage:"; hase "invalid queue"; green "daemon rc"
+  kill $dpid; wait $dpid || true
+  run "no daemon" "" "$A --connect=$sock 8 logger";  rc 1; hase "error: daemon";              green "no daemon"
+
+  # ---- shared-memory stage boundary between two processes ----
+  ring="analyzer-test-$$"; rout="$(mktemp)"
+  $A --input=shm:$ring 8 rotator logger >"$rout" 2>&1 & rpid=$!
+  run "shm split" $'hello\nworld\n<END>\n' "$A 8 uppercaser shmout:name=$ring"
+  rc 0; last_is "Pipeline shutdown complete"; e_empty
+  wait $rpid || red "shm reader failed"
+  OUT="$(cat "$rout")"; rm -f "$rout"
+  haso "[logger] OHELL"; haso "[logger] DWORL"; last_is "Pipeline shutdown complete"; green "shm split"
+  # expander makes a 2047-byte record, more than half of a 4K ring: it crosses as fragments
+  long="$(head -c 1024 </dev/zero | tr '\0' 'q')"; rout="$(mktemp)"
+  $A --input=shm:$ring 8 logger >"$rout" 2>&1 & rpid=$!
+  run "shm fragments" "$long"$'\nok\n<END>\n' "$A 8 expander shmout:name=$ring,size=4K"
+  rc 0; e_empty; wait $rpid || red "shm reader failed"
+  OUT="$(cat "$rout")"; rm -f "$rout"
+  long="${long//q/q }"; haso "[logger] ${long% }"; haso "[logger] o k"; last_is "Pipeline shutdown complete"; green "shm fragments"
+  run "bad input" "" "$A --input=udp:1 8 logger";     rc 1; hase "invalid --input";            green "bad input"
+
+  # ---- TCP stage boundary, a small credit window forces backpressure ----
+  rout="$(mktemp)"; port=""
+  $A --input=tcp:[::1]:0,window=2 2 rotator logger >"$rout" 2>&1 & rpid=$!
+  for _ in $(seq 50); do port="$(sed -n 's/^tcp input: listening on port //p' "$rout")"; [[ -n $port ]] && break; sleep 0.1; done
+  [[ -n $port ]] || red "tcp receiver did not report its port"
+  run "tcp split" $'one\ntwo\nthree\nfour\nfive\n<END>\n' "$A 8 uppercaser netsend:host=::1,port=$port,batch=2"
+  rc 0; last_is "Pipeline shutdown complete"; e_empty
+  wait $rpid || red "tcp receiver failed"
+  OUT="$(cat "$rout")"; rm -f "$rout"
+  haso "[logger] EON"; haso "[logger] EFIV"; last_is "Pipeline shutdown complete"; green "tcp split"
+
+  # ---- queue microbenchmark: one JSON report ----
+  run "bench_queue" "" "./output/bench_queue --items=2000 --rounds=200 --capacities=1,64 --waiters=2"
+  rc 0; haso '"items_per_sec"'; haso '"hop_ns_p50"'; haso '"wake_all_ns_p50"'; last_is "}"; green "bench_queue"
+  run "bad bench_queue" "" "./output/bench_queue --only=nope"; rc 1; hase "invalid value in '--only=nope'"; green "bad bench_queue"
+
+  # ---- plugin log path: duplicates collapse, a burst past the rate limit is counted ----
+  run "bench_log" "" "./output/bench_log --messages=1000"
+  rc 0; haso '"duplicate_ns_per_call"'; last_is "}"
+  hase "[INFO][bench_log] - (previous message repeated 999 more times)"
+  hase "log messages suppressed (rate limit)"; green "bench_log"
+  # the writer prints pending counts while the process still runs
+  lerr="$(mktemp)"
+  ./output/bench_log --messages=1000 --hold=4000 >/dev/null 2>"$lerr" & lpid=$!
+  sleep 2.5
+  kill -0 $lpid 2>/dev/null || red "bench_log hold: exited early"
+  grep -Fq "log messages suppressed (rate limit)" "$lerr" || red "bench_log hold: pending count not printed"
+  wait $lpid || red "bench_log hold failed"; rm -f "$lerr"; green "log counts flushed periodically"
+
+  # ---- no <END>: should wait (use timeout if present), its SIGTERM drains ----
   if command -v timeout >/dev/null 2>&1; then
     run "waits w/o END" "" "timeout 1s $A 8 uppercaser logger < /dev/null"
     [[ $RC -eq 124 ]] || red "expected timeout rc=124"
-    o_empty; e_empty; green "waits w/o END"
+    [[ "$OUT" == "Pipeline shutdown complete" ]] || red "$NAME: unexpected stdout"
+    e_empty; green "waits w/o END"
   fi
 
   green "all good"
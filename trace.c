@@ -0,0 +1,239 @@
+#include "trace.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TRACE_MAX_EVENTS (1u << 20) // caps memory at roughly 100 MB
+#define TRACE_MAX_THREADS 256
+
+typedef struct {
+    char     stage[48];
+    char     what[16];
+    char     async;   // 1 = not tied to a thread track
+    int      tid;
+    uint64_t id;
+    uint64_t start_ns;
+    uint64_t end_ns;
+} trace_event_t;
+
+static int             g_active;
+static char*           g_path;
+static unsigned long   g_sample = 100;
+static unsigned long   g_seq;       // lines seen by trace_begin_item (ingestion thread only)
+static uint64_t        g_next_id;
+static uint64_t        g_origin_ns; // timestamps are written relative to this
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER; // events and thread names
+static trace_event_t*  g_events;
+static size_t          g_count, g_cap;
+static unsigned long   g_dropped;
+static char*           g_thread_names[TRACE_MAX_THREADS];
+static int             g_thread_count;
+
+static __thread int      t_tid; // 1-based track id, 0 = not assigned yet
+static __thread uint64_t t_current;
+
+static char* dup_cstr(const char* s) {
+    if (!s) return NULL;
+    size_t n = strlen(s);
+    char* p = (char*)malloc(n + 1);
+    if (!p) return NULL;
+    memcpy(p, s, n + 1);
+    return p;
+}
+
+static uint64_t now_ns(void) {
+    // same clock the queues stamp enqueue times with
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t current(void) {
+    return t_current;
+}
+
+static void set_current(uint64_t id) {
+    t_current = id;
+}
+
+// Assign (and optionally name) the calling thread's track, caller holds g_lock
+static int thread_track(const char* name) {
+    if (t_tid == 0 && g_thread_count < TRACE_MAX_THREADS) {
+        g_thread_names[g_thread_count] = dup_cstr(name ? name : "thread");
+        t_tid = ++g_thread_count;
+    } else if (t_tid != 0 && name) {
+        free(g_thread_names[t_tid - 1]);
+        g_thread_names[t_tid - 1] = dup_cstr(name);
+    }
+    return t_tid;
+}
+
+static void name_thread(const char* name) {
+    pthread_mutex_lock(&g_lock);
+    (void)thread_track(name);
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void record(const char* stage, const char* what, uint64_t id,
+                   uint64_t start_ns, uint64_t end_ns, int async) {
+    pthread_mutex_lock(&g_lock);
+    if (g_count == g_cap) {
+        size_t cap = g_cap ? g_cap * 2 : 4096;
+        trace_event_t* grown = (cap <= TRACE_MAX_EVENTS)
+                             ? (trace_event_t*)realloc(g_events, cap * sizeof(*grown)) : NULL;
+        if (!grown) {
+            g_dropped++;
+            pthread_mutex_unlock(&g_lock);
+            return;
+        }
+        g_events = grown;
+        g_cap = cap;
+    }
+    trace_event_t* e = &g_events[g_count++];
+    snprintf(e->stage, sizeof(e->stage), "%s", stage ? stage : "unknown");
+    snprintf(e->what, sizeof(e->what), "%s", what ? what : "span");
+    e->async    = (char)async;
+    e->tid      = async ? 0 : thread_track(NULL);
+    e->id       = id;
+    e->start_ns = start_ns;
+    e->end_ns   = end_ns < start_ns ? start_ns : end_ns;
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void span(const char* stage, const char* what, uint64_t id, uint64_t start_ns, uint64_t end_ns) {
+    record(stage, what, id, start_ns, end_ns, 0);
+}
+
+static void async_span(const char* stage, const char* what, uint64_t id, uint64_t start_ns, uint64_t end_ns) {
+    record(stage, what, id, start_ns, end_ns, 1);
+}
+
+static const trace_hook_t k_hook = {
+    .now_ns      = now_ns,
+    .current     = current,
+    .set_current = set_current,
+    .name_thread = name_thread,
+    .span        = span,
+    .async_span  = async_span,
+};
+
+int trace_open(const char* spec, char** failed_msg) {
+    *failed_msg = NULL;
+    char* buf = dup_cstr(spec ? spec : "");
+    if (!buf) { *failed_msg = dup_cstr("alloc failed"); return -1; }
+
+    // FILE[,sample=N]
+    char* opt = strchr(buf, ',');
+    if (opt) *opt++ = '\0';
+    if (*buf == '\0') {
+        *failed_msg = dup_cstr("--trace needs a file name");
+        free(buf);
+        return -1;
+    }
+    if (opt) {
+        char* endp = NULL;
+        errno = 0;
+        unsigned long n = (strncmp(opt, "sample=", 7) == 0) ? strtoul(opt + 7, &endp, 10) : 0;
+        if (!endp || endp == opt + 7 || *endp != '\0' || errno == ERANGE || n == 0) {
+            *failed_msg = dup_cstr("invalid --trace option (expected sample=N)");
+            free(buf);
+            return -1;
+        }
+        g_sample = n;
+    }
+
+    g_path      = buf;
+    g_origin_ns = now_ns();
+    g_active    = 1;
+    name_thread("main");
+    return 0;
+}
+
+const trace_hook_t* trace_hook(void) {
+    return g_active ? &k_hook : NULL;
+}
+
+void trace_begin_item(void) {
+    if (!g_active) return;
+    t_current = (g_seq++ % g_sample == 0) ? ++g_next_id : 0;
+}
+
+static void write_json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c < 0x20)         fprintf(f, "\\u%04x", c);
+        else                       fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static double rel_us(uint64_t ns, uint64_t origin) {
+    return ns > origin ? (double)(ns - origin) / 1000.0 : 0.0;
+}
+
+void trace_close(void) {
+    if (!g_active) return;
+    g_active = 0;
+
+    FILE* f = fopen(g_path, "w");
+    if (!f) {
+        fprintf(stderr, "error: cannot write trace '%s': %s\n", g_path, strerror(errno));
+    } else {
+        fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+        for (int t = 0; t < g_thread_count; ++t) {
+            fprintf(f, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", t + 1);
+            write_json_string(f, g_thread_names[t] ? g_thread_names[t] : "thread");
+            fputs("}},\n", f);
+        }
+        for (size_t i = 0; i < g_count; ++i) {
+            const trace_event_t* e = &g_events[i];
+            char name[80];
+            snprintf(name, sizeof(name), "%s %s", e->stage, e->what);
+            double ts = rel_us(e->start_ns, g_origin_ns);
+            double te = rel_us(e->end_ns, g_origin_ns);
+            if (e->async) {
+                // a begin/end pair keyed by trace id, drawn on its own track
+                fputs("{\"ph\":\"b\",\"name\":", f);
+                write_json_string(f, name);
+                fprintf(f, ",\"cat\":\"%s\",\"id\":%llu,\"pid\":1,\"ts\":%.3f,\"args\":{\"item\":%llu}},\n",
+                        e->what, (unsigned long long)e->id, ts, (unsigned long long)e->id);
+                fputs("{\"ph\":\"e\",\"name\":", f);
+                write_json_string(f, name);
+                fprintf(f, ",\"cat\":\"%s\",\"id\":%llu,\"pid\":1,\"ts\":%.3f},\n",
+                        e->what, (unsigned long long)e->id, te);
+            } else {
+                fputs("{\"ph\":\"X\",\"name\":", f);
+                write_json_string(f, name);
+                fprintf(f, ",\"cat\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"item\":%llu}},\n",
+                        e->what, e->tid, ts, te - ts, (unsigned long long)e->id);
+            }
+        }
+        // metadata last so every event line above can end with a comma
+        fprintf(f, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"analyzer\"}}\n]}\n");
+        fclose(f);
+        fprintf(stderr, "trace: %zu spans for %llu items written to %s", g_count,
+                (unsigned long long)g_next_id, g_path);
+        if (g_dropped) fprintf(stderr, " (%lu dropped)", g_dropped);
+        fputc('\n', stderr);
+    }
+
+    pthread_mutex_lock(&g_lock);
+    free(g_events);
+    g_events = NULL;
+    g_count = g_cap = 0;
+    for (int t = 0; t < g_thread_count; ++t) {
+        free(g_thread_names[t]);
+        g_thread_names[t] = NULL;
+    }
+    g_thread_count = 0;
+    pthread_mutex_unlock(&g_lock);
+    free(g_path);
+    g_path = NULL;
+}
@@ -0,0 +1,25 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "plugins/trace_hook.h"
+
+// Sampled per-item tracing (--trace=FILE[,sample=N]). Spans from every stage
+// are collected in memory and written as Chrome trace-event JSON at shutdown
+// (open in chrome://tracing or ui.perfetto.dev), one track per thread.
+
+// Parse the spec and start collecting. Every Nth ingested line is traced (default 100).
+// On success: return 0
+// On failure: return -1 and set *failed_msg to a heap-allocated error string (caller frees)
+int trace_open(const char* spec, char** failed_msg);
+
+// Callbacks for plugins, NULL when tracing is off
+const trace_hook_t* trace_hook(void);
+
+// Called for each line entering the pipeline: picks the trace id (or 0) that
+// the first stage's place_work will see on this thread
+void trace_begin_item(void);
+
+// Write the trace file and release everything (no-op when tracing is off)
+void trace_close(void);
+
+#endif // TRACE_H